@@ -0,0 +1,111 @@
+"""
+@file ccm.py
+@author Xhovani Mali (xxm202)
+@brief PlatformIO extra script for the embedded sentry project: links the
+core-coupled memory sections of scripts/ccm.ld and reports, after every
+firmware link, how much of CCM, SRAM, SDRAM and flash is used and which
+objects ended up in each. The summary is printed; the full symbol list is
+written to memory_report.txt in the build directory.
+@version 0.1
+@date 2026-10-14
+
+@group Members:
+- Xhovani Mali
+- Shruti Pangare
+- Temira Koenig
+"""
+
+import os
+import re
+import subprocess
+
+Import("env")  # noqa: F821 (provided by PlatformIO)
+
+# name, start, size
+REGIONS = [
+    ("ccm", 0x10000000, 64 * 1024),
+    ("sram", 0x20000000, 192 * 1024),
+    ("sdram", 0xD0000000, 8 * 1024 * 1024),
+    ("flash", 0x08000000, 2 * 1024 * 1024),
+]
+TOP_SYMBOLS = 10  # largest objects printed per RAM region, the file has them all
+
+SECTION = re.compile(r"^\s*\d+\s+(\S+)\s+([0-9a-f]+)\s+([0-9a-f]+)\s+([0-9a-f]+)")
+
+
+def region_of(address):
+    for name, start, size in REGIONS:
+        if start <= address < start + size:
+            return name
+    return None
+
+
+def tool(env, name):
+    # arm-none-eabi-gcc -> arm-none-eabi-objdump / -nm
+    return re.sub(r"gcc$", name, env.subst("$CC"))
+
+
+def sections(env, elf):
+    """Allocated sections as (name, vma, size, loaded)"""
+    out = subprocess.run([tool(env, "objdump"), "-h", elf], capture_output=True, text=True).stdout
+    lines = out.splitlines()
+    result = []
+    for i, line in enumerate(lines):
+        match = SECTION.match(line)
+        if match is None or i + 1 >= len(lines) or "ALLOC" not in lines[i + 1]:
+            continue
+        name, size, vma = match.group(1), int(match.group(2), 16), int(match.group(3), 16)
+        result.append((name, vma, size, "LOAD" in lines[i + 1]))
+    return result
+
+
+def symbols(env, elf):
+    """Data objects as (region, size, name), largest first"""
+    out = subprocess.run([tool(env, "nm"), "-S", "-C", "--size-sort", "-r", elf],
+                         capture_output=True, text=True).stdout
+    result = []
+    for line in out.splitlines():
+        fields = line.split(None, 3)
+        if len(fields) < 4 or fields[2] not in "bBdD":
+            continue
+        region = region_of(int(fields[0], 16))
+        if region is not None:
+            result.append((region, int(fields[1], 16), fields[3]))
+    return result
+
+
+def report(target, source, env):
+    elf = str(target[0])
+    used = {name: 0 for name, _, _ in REGIONS}
+    lines = ["sections:"]
+    for name, vma, size, loaded in sections(env, elf):
+        region = region_of(vma)
+        if region is None:
+            continue
+        used[region] += size
+        if loaded and region != "flash":
+            used["flash"] += size  # the load image
+        lines.append("  %-20s %-6s 0x%08x %8d" % (name, region, vma, size))
+
+    summary = []
+    for name, _, size in REGIONS:
+        summary.append("%s: %d of %d bytes (%.1f%%)" % (name, used[name], size, 100.0 * used[name] / size))
+
+    objects = symbols(env, elf)
+    for name, _, _ in REGIONS[:3]:
+        placed = [s for s in objects if s[0] == name]
+        lines.append("%s objects:" % name)
+        lines.extend("  %8d %s" % (size, symbol) for _, size, symbol in placed)
+        summary.append("%s, largest objects:" % name)
+        summary.extend("  %8d %s" % (size, symbol) for _, size, symbol in placed[:TOP_SYMBOLS])
+
+    path = os.path.join(env.subst("$BUILD_DIR"), "memory_report.txt")
+    with open(path, "w") as file:
+        file.write("\n".join(summary[:len(REGIONS)] + lines) + "\n")
+    print("memory report (%s):" % path)
+    print("\n".join(summary))
+
+
+# Appended after the mbed linker script, which must come first (see ccm.ld)
+env.Append(LINKFLAGS=["-T", os.path.join(env.subst("$PROJECT_DIR"), "scripts", "ccm.ld")])
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", report)
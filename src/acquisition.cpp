@@ -0,0 +1,194 @@
+/**
+ * @file acquisition.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Interrupt-driven gyroscope acquisition into a lock-free sample ring
+ * for the embedded sentry project.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "acquisition.h"
+
+GyroSampleRing gyro_ring CCM_DATA;
+
+static InterruptIn *int2_pin = nullptr;
+static EventFlags *ready_flags = nullptr;
+static uint32_t ready_mask = 0;
+static EventQueue *burst_queue = nullptr; // high-priority thread that starts SPI bursts
+
+static volatile bool running = false;
+static volatile uint32_t burst_time_us = 0; // ticker value when the burst was requested
+static volatile uint32_t sample_count = 0;
+static volatile uint32_t burst_count = 0;
+static volatile uint32_t missed_bursts = 0;
+
+static const uint32_t sample_period_us = 1000000 / GYRO_ODR_HZ;
+
+#if GYRO_HW_MOTION
+static InterruptIn *int1_pin = nullptr;
+static Timeout motion_hold;
+static volatile bool motion = false; // INT1 up, or fell less than GYRO_MOTION_HOLD_MS ago
+static volatile uint32_t motion_count = 0;
+#else
+static const bool motion = true;     // no gate, every watermark is read
+#endif
+
+static void StartBurst();
+
+// SPI completion (interrupt context): timestamp the burst and publish it.
+// The newest sample arrived when the watermark fired, older ones one ODR
+// period apart before it.
+static void OnBurstDone(const Gyroscope_RawData *samples, size_t count)
+{
+    if (!running)
+        return; // stopped while the burst was on the bus; the ring may be resetting
+    uint32_t timestamp = burst_time_us - (count - 1) * sample_period_us;
+    for (size_t i = 0; i < count; i++, timestamp += sample_period_us)
+    {
+        Gyroscope_Sample sample = {timestamp, samples[i]};
+        gyro_ring.push(sample);
+    }
+    sample_count += count;
+    burst_count++;
+    ready_flags->set(ready_mask);
+
+    // The FIFO refilled past the watermark during the transfer, so no new
+    // rising edge will come: queue the next burst right away
+    if (running && motion && int2_pin->read() == 1)
+    {
+        burst_time_us = us_ticker_read();
+        burst_queue->call(StartBurst);
+    }
+}
+
+// Runs on the high-priority event thread
+static void StartBurst()
+{
+    if (!running)
+        return;
+    if (!StartGyroReadAsync(GYRO_FIFO_WATERMARK, callback(OnBurstDone)))
+        missed_bursts++;
+}
+
+// INT2 watermark rising edge (interrupt context)
+static void OnWatermark()
+{
+    if (!running || !motion)
+        return;
+    burst_time_us = us_ticker_read();
+    burst_queue->call(StartBurst);
+}
+
+#if GYRO_HW_MOTION
+// Runs on the high-priority event thread. The FIFO kept streaming while the
+// gate was closed; whatever it holds now leads into the motion. Every burst
+// is started from this thread, so the bus is free unless one is in flight.
+static void StartPreRoll()
+{
+    if (!running)
+        return;
+    size_t level = GyroReadBusy() ? 0 : GetFifoLevel();
+    if (level > 0 && !StartGyroReadAsync(level, callback(OnBurstDone)))
+        missed_bursts++;
+}
+
+static void OnHoldExpired()
+{
+    motion = false;
+}
+
+// INT1 edges (interrupt context): open the gate at once, close it only after
+// the rate stayed below the threshold for the hold time
+static void OnMotionStart()
+{
+    motion_hold.detach();
+    if (motion)
+        return;
+    motion = true;
+    motion_count++;
+    if (running)
+    {
+        burst_time_us = us_ticker_read();
+        burst_queue->call(StartPreRoll);
+    }
+}
+
+static void OnMotionEnd()
+{
+    motion_hold.attach(callback(OnHoldExpired), std::chrono::milliseconds(GYRO_MOTION_HOLD_MS));
+}
+
+void AcquisitionGateOnMotion(InterruptIn &int1)
+{
+    int1_pin = &int1;
+    int1.rise(callback(OnMotionStart));
+    int1.fall(callback(OnMotionEnd));
+}
+#endif
+
+void AcquisitionInit(InterruptIn &int2, EventFlags &flags, uint32_t ready_flag)
+{
+    int2_pin = &int2;
+    ready_flags = &flags;
+    ready_mask = ready_flag;
+
+    // Created here, in thread context; the shared queue is not ISR-safe to construct
+    burst_queue = mbed_highprio_event_queue();
+    int2.rise(callback(OnWatermark));
+}
+
+// Stop starting bursts and let the one on the bus, if any, complete. The ring
+// is only reset and the SPI bus only reused once no producer is left.
+static void StopProducer()
+{
+    running = false;
+#if GYRO_HW_MOTION
+    motion_hold.detach();
+#endif
+    while (GyroReadBusy())
+        ThisThread::sleep_for(std::chrono::milliseconds(1));
+}
+
+void AcquisitionStart()
+{
+    StopProducer();
+    gyro_ring.reset();
+    sample_count = 0;
+    burst_count = 0;
+    missed_bursts = 0;
+#if GYRO_HW_MOTION
+    motion_count = 0;
+    motion = int1_pin != nullptr && int1_pin->read() == 1;
+#endif
+
+    FlushFifo();
+    running = true;
+}
+
+void AcquisitionStop()
+{
+    StopProducer();
+}
+
+Acquisition_Stats GetAcquisitionStats()
+{
+    Acquisition_Stats stats = {
+        sample_count,
+        gyro_ring.overruns(),
+        gyro_ring.high_water(),
+        burst_count,
+        missed_bursts,
+#if GYRO_HW_MOTION
+        motion_count
+#else
+        0
+#endif
+    };
+    return stats;
+}
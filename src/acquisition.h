@@ -0,0 +1,75 @@
+/**
+ * @file acquisition.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Interrupt-driven gyroscope acquisition into a lock-free sample ring
+ * for the embedded sentry project.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef ACQUISITION_H
+#define ACQUISITION_H
+
+#include <mbed.h>
+
+#include "gyro.h"
+#include "sample_ring.h"
+#include "system_config.h"
+
+typedef SampleRing<Gyroscope_Sample, SAMPLE_RING_SIZE> GyroSampleRing;
+
+// Acquisition counters, cumulative since the last AcquisitionStart()
+typedef struct {
+  uint32_t samples;        // samples pushed into the ring
+  uint32_t overruns;       // samples dropped because the ring was full
+  uint32_t high_water;     // peak ring fill level
+  uint32_t bursts;         // FIFO bursts completed
+  uint32_t missed_bursts;  // watermarks that found the SPI still busy
+  uint32_t motion_events;  // times the INT1 motion gate opened (GYRO_HW_MOTION)
+} Acquisition_Stats;
+
+// Samples produced by the watermark ISR / SPI completion, consumed by one thread
+extern GyroSampleRing gyro_ring;
+
+/**
+ * @brief Hook acquisition to the gyroscope INT2 (watermark) line
+ * @param int2: interrupt pin wired to the L3GD20 INT2/DRDY output
+ * @param flags: event flags signalled when new samples are in the ring
+ * @param ready_flag: flag bit to set
+ */
+void AcquisitionInit(InterruptIn &int2, EventFlags &flags, uint32_t ready_flag);
+
+#if GYRO_HW_MOTION
+/**
+ * @brief Read the FIFO only while the gyroscope's INT1 motion interrupt is
+ * up (and GYRO_MOTION_HOLD_MS after), see GYRO_HW_MOTION
+ * @param int1: interrupt pin wired to the L3GD20 INT1 output
+ */
+void AcquisitionGateOnMotion(InterruptIn &int1);
+#endif
+
+/**
+ * @brief Flush the sensor FIFO and the ring, then start filling the ring.
+ * The gyroscope must already be initialized in FIFO stream mode.
+ */
+void AcquisitionStart();
+
+/**
+ * @brief Stop producing samples. Returns once a burst already on the bus has
+ * completed, so the ring can be reset and the SPI bus used again; that
+ * burst's samples are dropped.
+ */
+void AcquisitionStop();
+
+/**
+ * @brief Snapshot of the acquisition counters
+ */
+Acquisition_Stats GetAcquisitionStats();
+
+#endif  // ACQUISITION_H
@@ -0,0 +1,359 @@
+/**
+ * @file archive.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief SDRAM ring archive of recent unlock attempts for the embedded
+ * sentry project.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "archive.h"
+
+#if ARCHIVE_ENABLE
+#include <cmath>
+#include <cstring>
+
+#include "telemetry.h"
+#include "drivers/stm32f429i_discovery_sdram.h"
+
+static_assert(ARCHIVE_STAGE_BYTES % 4 == 0, "the SDRAM DMA writes whole words");
+static_assert(ARCHIVE_MAX_RECORD_BYTES % 4 == 0 && ARCHIVE_MAX_RECORD_BYTES <= ARCHIVE_SDRAM_SIZE,
+              "a record must fit the archive region");
+static_assert(ARCHIVE_SDRAM_OFFSET % 4 == 0 && ARCHIVE_SDRAM_OFFSET + ARCHIVE_SDRAM_SIZE <= SDRAM_DEVICE_SIZE,
+              "archive region outside the SDRAM");
+
+static const uint32_t archive_base = SDRAM_DEVICE_ADDR + ARCHIVE_SDRAM_OFFSET;
+
+static const size_t max_coded_sample = 4 * 5;  // four 32-bit varints
+static const size_t record_frame_bytes = 4 + 4 + 4 + 1 + 2 + 4;
+static const size_t data_header_bytes = 4 + 4;
+
+typedef struct {
+    uint32_t sequence;
+    uint32_t timestamp_us;     // first sample
+    uint32_t offset;           // from archive_base
+    uint32_t length;           // coded bytes
+    volatile uint32_t written; // bytes the DMA has finished, updated from its interrupt
+    uint16_t samples;          // at least four coded bytes each, so they fit
+    float score;
+    uint8_t flags;
+    bool closed;               // ArchiveEnd() has filled in the outcome
+} Archive_Entry;
+
+// Records with sequence numbers from first_sequence up to next_sequence are
+// indexed, entry sequence % ARCHIVE_MAX_RECORDS
+static Archive_Entry entries[ARCHIVE_MAX_RECORDS];
+static volatile uint32_t first_sequence = 0;
+static volatile uint32_t next_sequence = 0;
+static uint32_t write_offset = 0; // where the next record starts
+
+// Record being coded, recording thread only
+static Archive_Entry *current = nullptr;
+static uint32_t record_bytes = 0;
+static bool truncated = false;
+static bool coding_started = false;
+static uint32_t previous_timestamp = 0;
+static int32_t previous_delta = 0;
+static int16_t previous_axis[3];
+
+// Staging halves; busy from submission until their DMA transfer completes
+alignas(4) static uint8_t stage[2][ARCHIVE_STAGE_BYTES];
+static volatile bool stage_busy[2] = {false, false};
+static uint32_t stage_address[2];
+static uint32_t stage_bytes[2];
+static Archive_Entry *stage_entry[2];
+static volatile int dma_stage = -1; // half being written, -1 when the DMA is idle
+static int fill_stage = 0;
+static size_t fill_bytes = 0;
+
+static Archive_Stats stats;
+
+static Archive_Entry &Entry(uint32_t sequence)
+{
+    return entries[sequence % ARCHIVE_MAX_RECORDS];
+}
+
+// The record is still indexed, its bytes not overwritten yet
+static bool Alive(uint32_t sequence)
+{
+    return (int32_t)(sequence - first_sequence) >= 0 && (int32_t)(next_sequence - sequence) > 0;
+}
+
+// With interrupts masked
+static void StartDma(int half)
+{
+    dma_stage = half;
+    if (BSP_SDRAM_WriteData_DMA(stage_address[half], (uint32_t *)stage[half], (stage_bytes[half] + 3) / 4) != SDRAM_OK)
+    {
+        // The record never reaches its length and is not exported
+        dma_stage = -1;
+        stage_busy[half] = false;
+    }
+}
+
+// Transfer completion (interrupt context): account for the bytes and start
+// the other half if it is waiting
+static void DmaDone(bool ok)
+{
+    int half = dma_stage;
+    if (half < 0)
+        return;
+    if (ok)
+        stage_entry[half]->written += stage_bytes[half];
+    stage_busy[half] = false;
+    dma_stage = -1;
+    if (stage_busy[half ^ 1])
+        StartDma(half ^ 1);
+}
+
+// Called by HAL_DMA_IRQHandler() for transfers started by HAL_SDRAM_Write_DMA()
+extern "C" void HAL_SDRAM_DMA_XferCpltCallback(DMA_HandleTypeDef *hdma)
+{
+    (void)hdma;
+    DmaDone(true);
+}
+
+extern "C" void HAL_SDRAM_DMA_XferErrorCallback(DMA_HandleTypeDef *hdma)
+{
+    (void)hdma;
+    DmaDone(false);
+}
+
+// Hand the filling half to the DMA and move on to the other one
+static void Submit()
+{
+    int half = fill_stage;
+    stage_address[half] = archive_base + current->offset + record_bytes - fill_bytes;
+    stage_bytes[half] = fill_bytes;
+    stage_entry[half] = current;
+    stats.bytes += fill_bytes;
+
+    core_util_critical_section_enter();
+    stage_busy[half] = true;
+    if (dma_stage < 0)
+        StartDma(half);
+    core_util_critical_section_exit();
+
+    fill_stage = half ^ 1;
+    fill_bytes = 0;
+}
+
+// Copy coded bytes into the staging halves; false if there is no room in
+// the record or both halves are still with the DMA
+static bool Append(const uint8_t *bytes, size_t length)
+{
+    size_t room = ARCHIVE_STAGE_BYTES - fill_bytes;
+    if (record_bytes + length > ARCHIVE_MAX_RECORD_BYTES || stage_busy[fill_stage] ||
+        (length > room && stage_busy[fill_stage ^ 1]))
+        return false;
+
+    size_t first = length < room ? length : room;
+    memcpy(&stage[fill_stage][fill_bytes], bytes, first);
+    fill_bytes += first;
+    record_bytes += first;
+    if (fill_bytes == ARCHIVE_STAGE_BYTES)
+    {
+        Submit();
+        memcpy(stage[fill_stage], bytes + first, length - first);
+        fill_bytes = length - first;
+        record_bytes += length - first;
+    }
+    return true;
+}
+
+static size_t PutVarint(uint8_t *out, int32_t value)
+{
+    uint32_t zigzag = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+    size_t n = 0;
+    while (zigzag >= 0x80)
+    {
+        out[n++] = (uint8_t)(zigzag | 0x80);
+        zigzag >>= 7;
+    }
+    out[n++] = (uint8_t)zigzag;
+    return n;
+}
+
+static size_t Put32(uint8_t *out, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        out[i] = (uint8_t)(value >> (8 * i));
+    return 4;
+}
+
+void ArchiveInit()
+{
+    // BSP_SDRAM_MspInit() enabled the interrupt but left the vector alone
+    NVIC_SetVector(SDRAM_DMAx_IRQn, (uint32_t)&BSP_SDRAM_DMA_IRQHandler);
+}
+
+void ArchiveBegin()
+{
+    if (current)
+        ArchiveEnd(false, NAN);
+
+    uint32_t start = write_offset;
+    if (start + ARCHIVE_MAX_RECORD_BYTES > ARCHIVE_SDRAM_SIZE)
+        start = 0;
+
+    // Records lie in the ring in sequence order, so whatever the new one may
+    // overwrite is at the old end of the index. Transfers run in order, so
+    // one still writing an old record finishes before the new one starts.
+    while (first_sequence != next_sequence)
+    {
+        const Archive_Entry &oldest = Entry(first_sequence);
+        uint32_t end = oldest.offset + ((oldest.length + 3) & ~3u);
+        bool overlaps = oldest.offset < start + ARCHIVE_MAX_RECORD_BYTES && start < end;
+        if (!overlaps && next_sequence - first_sequence < ARCHIVE_MAX_RECORDS)
+            break;
+        first_sequence = first_sequence + 1;
+    }
+
+    current = &Entry(next_sequence);
+    current->sequence = next_sequence;
+    current->timestamp_us = us_ticker_read();
+    current->offset = start;
+    current->length = 0;
+    current->written = 0;
+    current->samples = 0;
+    current->score = NAN;
+    current->flags = 0;
+    current->closed = false;
+    next_sequence = next_sequence + 1;
+
+    record_bytes = 0;
+    truncated = false;
+    coding_started = false;
+    previous_delta = 0;
+    previous_axis[0] = previous_axis[1] = previous_axis[2] = 0;
+}
+
+void ArchiveSamples(const Gyroscope_Sample *samples, size_t count)
+{
+    if (!current || truncated)
+        return;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const Gyroscope_Sample &s = samples[i];
+        if (!coding_started)
+        {
+            current->timestamp_us = s.timestamp_us;
+            previous_timestamp = s.timestamp_us;
+            coding_started = true;
+        }
+
+        int32_t delta = (int32_t)(s.timestamp_us - previous_timestamp);
+        int16_t axis[3] = {s.data.x_raw, s.data.y_raw, s.data.z_raw};
+        uint8_t coded[max_coded_sample];
+        size_t n = PutVarint(coded, delta - previous_delta);
+        for (int a = 0; a < 3; a++)
+            n += PutVarint(coded + n, (int32_t)axis[a] - previous_axis[a]);
+
+        if (!Append(coded, n))
+        {
+            truncated = true;
+            return;
+        }
+        previous_timestamp = s.timestamp_us;
+        previous_delta = delta;
+        memcpy(previous_axis, axis, sizeof(axis));
+        current->samples++;
+        stats.samples++;
+    }
+}
+
+void ArchiveEnd(bool accepted, float score)
+{
+    if (!current)
+        return;
+
+    // The half being filled is never busy once it holds bytes
+    if (fill_bytes > 0)
+        Submit();
+
+    core_util_critical_section_enter();
+    current->length = record_bytes;
+    current->score = score;
+    current->flags = (accepted ? ARCHIVE_FLAG_ACCEPTED : 0) | (truncated ? ARCHIVE_FLAG_TRUNCATED : 0);
+    current->closed = true;
+    core_util_critical_section_exit();
+
+    write_offset = current->offset + ((record_bytes + 3) & ~3u);
+    stats.records++;
+    if (truncated)
+        stats.truncated++;
+    current = nullptr;
+}
+
+void ArchiveExport()
+{
+    uint32_t end = next_sequence;
+    unsigned sent = 0, skipped = 0;
+    for (uint32_t sequence = first_sequence; sequence != end; sequence++)
+    {
+        core_util_critical_section_enter();
+        Archive_Entry entry = Entry(sequence);
+        bool alive = Alive(sequence);
+        core_util_critical_section_exit();
+        if (!alive || !entry.closed || entry.written != entry.length)
+        {
+            skipped++;
+            continue;
+        }
+
+        uint8_t record[record_frame_bytes];
+        size_t n = Put32(record, entry.sequence);
+        n += Put32(record + n, entry.timestamp_us);
+        memcpy(record + n, &entry.score, 4);
+        n += 4;
+        record[n++] = entry.flags;
+        record[n++] = (uint8_t)entry.samples;
+        record[n++] = (uint8_t)(entry.samples >> 8);
+        n += Put32(record + n, entry.length);
+        TelemetryFrame(TELEMETRY_FRAME_ARCHIVE_RECORD, record, n, true);
+
+        uint8_t data[data_header_bytes + ARCHIVE_EXPORT_CHUNK];
+        bool complete = true;
+        for (uint32_t offset = 0; offset < entry.length; offset += ARCHIVE_EXPORT_CHUNK)
+        {
+            size_t chunk = entry.length - offset < ARCHIVE_EXPORT_CHUNK ? entry.length - offset : ARCHIVE_EXPORT_CHUNK;
+            Put32(data, entry.sequence);
+            Put32(data + 4, offset);
+            memcpy(data + data_header_bytes, (const void *)(archive_base + entry.offset + offset), chunk);
+
+            // Dropped before the copy finished: a new attempt may have
+            // overwritten these bytes
+            if (!Alive(sequence))
+            {
+                complete = false;
+                break;
+            }
+            TelemetryFrame(TELEMETRY_FRAME_ARCHIVE_DATA, data, data_header_bytes + chunk, true);
+        }
+        if (complete)
+            sent++;
+        else
+            skipped++;
+    }
+
+    Archive_Stats s = GetArchiveStats();
+    printf("archive: %u records exported, %u skipped; %lu archived, %lu truncated, %lu samples in %lu bytes\n",
+           sent, skipped, (unsigned long)s.records, (unsigned long)s.truncated, (unsigned long)s.samples,
+           (unsigned long)s.bytes);
+}
+
+Archive_Stats GetArchiveStats()
+{
+    core_util_critical_section_enter();
+    Archive_Stats snapshot = stats;
+    core_util_critical_section_exit();
+    return snapshot;
+}
+#endif
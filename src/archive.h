@@ -0,0 +1,105 @@
+/**
+ * @file archive.h
+ * @author Xhovani Mali (xxm202)
+ * @brief SDRAM ring archive of recent unlock attempts for the embedded
+ * sentry project.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ *
+ * Each attempt keeps its full-rate trace as taken out of the sample ring,
+ * with the match score and the outcome. Samples are coded on the fly and go
+ * out through two SRAM staging halves: while the SDRAM DMA writes one, the
+ * other fills. The recording thread never waits for the DMA; if both halves
+ * are still busy the attempt is marked truncated and the rest is dropped.
+ * The coded region is a ring in SDRAM, newer attempts overwrite the oldest.
+ *
+ * Coding, per sample, each value a zigzag LEB128 varint:
+ *   timestamp delta minus the previous delta (the first delta is taken from
+ *   the record timestamp, the previous delta starts at 0), then x, y and z
+ *   minus the previous sample (starting at 0).
+ *
+ * Export frames (telemetry.h), little endian:
+ *   TELEMETRY_FRAME_ARCHIVE_RECORD: sequence (4) | timestamp_us (4) |
+ *       score (4, float) | flags (1) | samples (2) | length (4)
+ *   TELEMETRY_FRAME_ARCHIVE_DATA: sequence (4) | offset (4) | coded bytes
+ * A record frame is followed by the data frames of its length bytes.
+ */
+
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include <mbed.h>
+
+#include "gyro.h"
+#include "system_config.h"
+
+// Record flags
+#define ARCHIVE_FLAG_ACCEPTED 0x01   // the attempt unlocked
+#define ARCHIVE_FLAG_TRUNCATED 0x02  // out of space or DMA bandwidth, the trace is cut short
+
+// Archive counters, cumulative since ArchiveInit()
+typedef struct {
+  uint32_t records;    // attempts archived
+  uint32_t truncated;  // attempts cut short
+  uint32_t bytes;      // coded bytes written to SDRAM
+  uint32_t samples;    // samples coded
+} Archive_Stats;
+
+#if ARCHIVE_ENABLE
+
+/**
+ * @brief Route the SDRAM DMA interrupt to the archive. The SDRAM itself is
+ * brought up by the LCD driver, which must be initialized first.
+ */
+void ArchiveInit();
+
+/**
+ * @brief Start archiving a new attempt, dropping the oldest records it
+ * overwrites. Recording thread only, as are ArchiveSamples and ArchiveEnd.
+ */
+void ArchiveBegin();
+
+/**
+ * @brief Code samples into the current attempt. Never blocks.
+ * @param samples: samples as taken out of the sample ring
+ * @param count: number of samples
+ */
+void ArchiveSamples(const Gyroscope_Sample *samples, size_t count);
+
+/**
+ * @brief Close the current attempt and flush its last bytes to SDRAM
+ * @param accepted: the attempt unlocked
+ * @param score: match score of the best template, NaN if there was none
+ */
+void ArchiveEnd(bool accepted, float score);
+
+/**
+ * @brief Send every complete record, oldest first, over the telemetry link.
+ * Waits for room in the transmit buffer; runs on the console thread.
+ * Records overwritten while they are sent are skipped.
+ */
+void ArchiveExport();
+
+/**
+ * @brief Snapshot of the archive counters
+ */
+Archive_Stats GetArchiveStats();
+
+#else
+
+inline void ArchiveInit() {}
+inline void ArchiveBegin() {}
+inline void ArchiveSamples(const Gyroscope_Sample *, size_t) {}
+inline void ArchiveEnd(bool, float) {}
+inline void ArchiveExport() {}
+inline Archive_Stats GetArchiveStats() { return Archive_Stats(); }
+
+#endif
+
+#endif  // ARCHIVE_H
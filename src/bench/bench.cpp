@@ -0,0 +1,372 @@
+/**
+ * @file bench.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief On-target benchmark of the gesture kernels, SPI reads and LCD
+ * primitives for the embedded sentry project (env:disco_f429zi_bench).
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ *
+ * Replaces main.cpp and the UI thread: runs every kernel BENCH_PASSES
+ * times over fixed inputs and prints, per kernel and input, the DWT cycles
+ * per call (min/avg/max), cycles per item and the heap bytes and
+ * allocations made per call. The report goes out on the console like the
+ * application's log, so serial_dump.py shows it.
+ *
+ * Inputs: a synthetic gesture (the same shapes the host replay generates,
+ * with a fixed noise seed), one recording window captured from the
+ * gyroscope at boot, and with BENCH_RECORDED_TRACE 1 a trace compiled in
+ * from src/bench/recorded.inc, one "{timestamp_us, {x, y, z}}," per line as
+ * written by serial_dump.py --csv:
+ *
+ *   awk -F, 'NR > 1 {print "{" $1 ", {" $2 ", " $3 ", " $4 "}},"}' key.csv > src/bench/recorded.inc
+ *
+ * Build the variants to compare with the bench environments, or build_flags
+ * (GESTURE_USE_CMSIS_DSP, GESTURE_FIXED_POINT, LCD_DMA2D_ASYNC,
+ * GYRO_SPI_ASYNC); the active ones are printed first.
+ */
+
+#include <mbed.h>
+#include <cmath>
+
+#include "dsp_backend.h"
+#include "key_store.h"
+#include "pipeline.h"
+#include "gyro.h"
+#include "telemetry.h"
+#include "trace.h"
+#include "utilities.h"
+#include "system_config.h"
+#include "drivers/LCD_DISCO_F429ZI.h"
+
+#if !TRACE_ENABLE
+#error "The benchmark reads the DWT cycle counter, build it with TRACE_ENABLE 1"
+#endif
+
+/*******************************************************************************
+ * Kernels
+ * ****************************************************************************/
+typedef enum
+{
+    KERNEL_SPI,       // GetGyroValue(), one blocking 7-byte transaction
+    KERNEL_SPI_ASYNC, // StartGyroReadAsync() of one sample through completion
+    KERNEL_FILTER,    // decimate_sample() on one full-rate sample
+    KERNEL_TRIM,
+    KERNEL_NORMALIZE,
+    KERNEL_CORRELATE, // per-axis correlation of two normalized gestures (float pipeline)
+    KERNEL_MATCH,     // key_store.match() against one template, normalize included
+    KERNEL_LCD_FILL,  // FillRect() of a status strip, through DMA2D completion
+    KERNEL_LCD_TEXT,  // DisplayStringAt() of one line
+    KERNEL_LCD_CLEAR, // Clear() of the whole layer
+    KERNEL_COUNT
+} Bench_Kernel;
+
+typedef struct
+{
+    uint32_t calls;
+    uint32_t items;  // samples, pixels or characters the calls processed
+    uint64_t cycles;
+    uint32_t min;
+    uint32_t max;
+    uint32_t bytes;  // heap bytes allocated
+    uint32_t allocations;
+} Kernel_Stats;
+
+static const char *const kernel_names[KERNEL_COUNT] = {"spi",       "spi_async", "filter",   "trim",
+                                                       "normalize", "correlate", "match",    "lcd_fill",
+                                                       "lcd_text",  "lcd_clear"};
+static Kernel_Stats kernels[KERNEL_COUNT];
+
+static LCD_DISCO_F429ZI lcd(LCD_RGB565 ? LTDC_PIXEL_FORMAT_RGB565 : LTDC_PIXEL_FORMAT_ARGB8888);
+static KeyStore key_store;
+static GestureRecord record;
+static GestureRecord key_record;
+
+// Cumulative heap counters; zero without platform.heap-stats-enabled
+static void HeapCounters(uint32_t &bytes, uint32_t &allocations)
+{
+#ifdef MBED_HEAP_STATS_ENABLED
+    mbed_stats_heap_t heap;
+    mbed_stats_heap_get(&heap);
+    bytes = heap.total_size;
+    allocations = heap.alloc_cnt;
+#else
+    bytes = allocations = 0;
+#endif
+}
+
+// Time one kernel call and charge its allocations
+template <typename F>
+static void Measure(Bench_Kernel kernel, uint32_t items, F f)
+{
+    uint32_t bytes, allocations;
+    HeapCounters(bytes, allocations);
+    uint32_t start = TraceNow();
+    f();
+    uint32_t cycles = TraceNow() - start;
+
+    uint32_t bytes_after, allocations_after;
+    HeapCounters(bytes_after, allocations_after);
+    Kernel_Stats &s = kernels[kernel];
+    if (s.calls == 0 || cycles < s.min)
+        s.min = cycles;
+    if (cycles > s.max)
+        s.max = cycles;
+    s.calls++;
+    s.items += items;
+    s.cycles += cycles;
+    s.bytes += bytes_after - bytes;
+    s.allocations += allocations_after - allocations;
+}
+
+// Print and clear the statistics of every kernel that ran on this input.
+// Minimal printf has no field widths, so the fields are labelled instead.
+static void Report(const char *input)
+{
+    for (int k = 0; k < KERNEL_COUNT; k++)
+    {
+        Kernel_Stats &s = kernels[k];
+        if (s.calls == 0)
+            continue;
+        printf("bench: %s %s: %lu calls, %lu items/call, cycles %lu/%lu/%lu (min/avg/max), %lu cycles/item, "
+               "%lu bytes %lu allocs/call\n",
+               kernel_names[k], input, (unsigned long)s.calls, (unsigned long)(s.items / s.calls),
+               (unsigned long)s.min, (unsigned long)(s.cycles / s.calls), (unsigned long)s.max,
+               (unsigned long)(s.items ? s.cycles / s.items : 0), (unsigned long)(s.bytes / s.calls),
+               (unsigned long)(s.allocations / s.calls));
+        memset(&s, 0, sizeof(s));
+    }
+}
+
+/*******************************************************************************
+ * Inputs
+ * ****************************************************************************/
+// Full-rate samples of one input, synthetic or captured
+static const size_t input_capacity = GESTURE_RECORD_WINDOW_MS * GYRO_ODR_HZ / 1000;
+static Gyroscope_Sample input[input_capacity];
+#if BENCH_RECORDED_TRACE
+static const Gyroscope_Sample recorded[] = {
+#include "recorded.inc"
+};
+#endif
+
+// Fixed-seed noise, so every build sees the same synthetic input
+static uint32_t noise_state = 1234;
+static float Noise(float amplitude)
+{
+    noise_state ^= noise_state << 13;
+    noise_state ^= noise_state >> 17;
+    noise_state ^= noise_state << 5;
+    return amplitude * ((float)(noise_state & 0xffff) / 32768.0f - 1.0f);
+}
+
+// Sum of sinusoids per axis with silence around it, as in the host replay
+static size_t Synthesize(Gyroscope_Sample *out, size_t capacity, int shape, bool variation)
+{
+    const float silence = 0.3f, active = 2.0f;
+    float gain = variation ? 1.0f + Noise(0.1f) : 1.0f;
+    float shift = variation ? Noise(0.05f) : 0.0f;
+    uint32_t period_us = 1000000 / GYRO_ODR_HZ;
+    size_t count = (size_t)((2 * silence + active) * GYRO_ODR_HZ);
+    if (count > capacity)
+        count = capacity;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        float t = (float)i / GYRO_ODR_HZ - silence - shift;
+        int16_t axis[3] = {0, 0, 0};
+        if (t >= 0 && t < active)
+        {
+            for (int a = 0; a < 3; a++)
+            {
+                float f = 0.5f + 0.4f * ((shape * 7 + a * 3) % 5);
+                float v = 6000.0f * sinf(6.28318531f * f * t + shape + a) * sinf(3.14159265f * t / active);
+                axis[a] = (int16_t)(gain * v + (variation ? Noise(260.0f) : 0.0f));
+            }
+        }
+        out[i] = {(uint32_t)(i * period_us), {axis[0], axis[1], axis[2]}};
+    }
+    return count;
+}
+
+// Decimated, untrimmed samples of one input; records are rebuilt from them
+// before every measured call
+static GestureSample decimated[GESTURE_BUFFER_CAPACITY];
+static size_t decimated_count = 0;
+
+static void Rebuild(GestureRecord &target)
+{
+    target.clear();
+    for (size_t i = 0; i < decimated_count; i++)
+        target.push_back(decimated[i]);
+}
+
+/*******************************************************************************
+ * Benchmarks
+ * ****************************************************************************/
+static EventFlags async_flags;
+#define ASYNC_DONE_FLAG (1UL << 0)
+
+static void OnAsyncRead(const Gyroscope_RawData *, size_t)
+{
+    async_flags.set(ASYNC_DONE_FLAG);
+}
+
+static void BenchSpi()
+{
+    Gyroscope_RawData raw;
+    for (int i = 0; i < BENCH_SPI_READS; i++)
+        Measure(KERNEL_SPI, 1, [&] { GetGyroValue(&raw); });
+    for (int i = 0; i < BENCH_SPI_READS; i++)
+    {
+        Measure(KERNEL_SPI_ASYNC, 1, [&] {
+            if (StartGyroReadAsync(1, callback(OnAsyncRead)))
+                async_flags.wait_any(ASYNC_DONE_FLAG);
+        });
+    }
+    Report("sensor");
+}
+
+// Live input: calibrated samples paced at the ODR
+static size_t Capture()
+{
+    uint32_t period_us = 1000000 / GYRO_ODR_HZ;
+    for (size_t i = 0; i < input_capacity; i++)
+    {
+        input[i].timestamp_us = (uint32_t)(i * period_us);
+        GetCalibratedSample(&input[i].data);
+        wait_us(period_us);
+    }
+    return input_capacity;
+}
+
+// Run the filter chain over an input and keep the decimated samples
+static void Decimate(const Gyroscope_Sample *samples, size_t count, bool timed)
+{
+    size_t decimation_count = 0;
+    decimated_count = 0;
+    filter_reset();
+    for (size_t i = 0; i < count; i++)
+    {
+        GestureSample kept;
+        bool due = false;
+        if (timed)
+            Measure(KERNEL_FILTER, 1, [&] { due = decimate_sample(samples[i].data, decimation_count, kept); });
+        else
+            due = decimate_sample(samples[i].data, decimation_count, kept);
+        if (due && decimated_count < GESTURE_BUFFER_CAPACITY)
+            decimated[decimated_count++] = kept;
+    }
+}
+
+static void BenchGesture(const char *name, const Gyroscope_Sample *samples, size_t count)
+{
+    for (int pass = 0; pass < BENCH_PASSES; pass++)
+    {
+        Decimate(samples, count, true);
+        Rebuild(record);
+        Measure(KERNEL_TRIM, record.size(), [&] { trim_gyro_data(record); });
+        Measure(KERNEL_NORMALIZE, record.size(), [&] { normalize(record); });
+#if !GESTURE_FIXED_POINT
+        size_t n = std::min(record.size(), key_store.samples(0).size());
+#if GESTURE_USE_CMSIS_DSP
+        Measure(KERNEL_CORRELATE, n, [&] { correlationCmsis(record, key_store.samples(0), n); });
+#else
+        Measure(KERNEL_CORRELATE, n, [&] { correlationReference(record, key_store.samples(0), n); });
+#endif
+#endif
+
+        Rebuild(record);
+        trim_gyro_data(record);
+        Key_Match_Result match;
+        Measure(KERNEL_MATCH, record.size(), [&] { key_store.match(record, match); });
+    }
+    Report(name);
+
+#if !GESTURE_FIXED_POINT
+    // The selected backend against the scalar reference on the same input;
+    // zero unless GESTURE_USE_CMSIS_DSP
+    Dsp_Backend_Error error = compareDspBackend(record, key_store.samples(0));
+    printf("bench: %s backend deviation: correlation %f, normalize %f\n", name,
+           error.correlation_error, error.normalize_error);
+#endif
+}
+
+static void BenchLcd()
+{
+    static const char text[] = "EMBEDDED SENTRY";
+    uint32_t width = lcd.GetXSize(), height = lcd.GetYSize();
+    for (int pass = 0; pass < BENCH_PASSES; pass++)
+    {
+        lcd.SetTextColor(pass & 1 ? LCD_COLOR_RED : LCD_COLOR_BLUE);
+        Measure(KERNEL_LCD_FILL, width * FONT_SIZE, [&] {
+            lcd.FillRect(0, UI_STATUS_Y, width, FONT_SIZE);
+            lcd.WaitForDma2d(100);
+        });
+        lcd.SetTextColor(LCD_COLOR_WHITE);
+        Measure(KERNEL_LCD_TEXT, sizeof(text) - 1, [&] {
+            lcd.DisplayStringAt(0, UI_STATUS_Y, (uint8_t *)text, CENTER_MODE);
+            lcd.WaitForDma2d(100);
+        });
+        Measure(KERNEL_LCD_CLEAR, width * height, [&] {
+            lcd.Clear(LCD_COLOR_BLACK);
+            lcd.WaitForDma2d(100);
+        });
+    }
+    Report("screen");
+}
+
+int main()
+{
+    TelemetryInit();
+    TraceInit();
+
+    printf("bench: %lu MHz, GESTURE_FIXED_POINT %d, GESTURE_USE_CMSIS_DSP %d, GESTURE_MATCHER %d, "
+           "LCD_DMA2D_ASYNC %d, GYRO_SPI_ASYNC %d, GYRO_ODR_HZ %d, %d passes\n",
+           (unsigned long)(SystemCoreClock / 1000000), GESTURE_FIXED_POINT, GESTURE_USE_CMSIS_DSP,
+           GESTURE_MATCHER, LCD_DMA2D_ASYNC, GYRO_SPI_ASYNC, GYRO_ODR_HZ, BENCH_PASSES);
+
+    // Same sensor setup as the per-sample path of the application
+    Gyroscope_Init_Parameters init_parameters = {
+            GYRO_ODR_CONFIG,   // Output data rate
+            INT2_DRDY,         // Interrupt configuration
+            FULL_SCALE_500,    // Full-scale selection
+            0,                 // FIFO disabled
+            FIFO_MODE_BYPASS   // FIFO mode
+    };
+    Gyroscope_RawData raw_data;
+    InitiateGyroscope(&init_parameters, &raw_data);
+    BenchSpi();
+
+    // The clean synthetic gesture is the one template every input is matched against
+    size_t count = Synthesize(input, input_capacity, 0, false);
+    Decimate(input, count, false);
+    Rebuild(key_record);
+    trim_gyro_data(key_record);
+    key_store.enroll(key_record, KEY_STORE_DEFAULT_USER);
+
+    count = Synthesize(input, input_capacity, 0, true);
+    BenchGesture("synthetic", input, count);
+
+    printf("bench: capturing %d ms from the gyroscope\n", GESTURE_RECORD_WINDOW_MS);
+    count = Capture();
+    BenchGesture("capture", input, count);
+
+#if BENCH_RECORDED_TRACE
+    BenchGesture("recorded", recorded, sizeof(recorded) / sizeof(recorded[0]));
+#endif
+
+#if LCD_DMA2D_ASYNC
+    lcd.SetDma2dAsync(ENABLE);
+#endif
+    BenchLcd();
+
+    printf("bench: done\n");
+    while (true)
+        ThisThread::sleep_for(1000ms);
+}
@@ -0,0 +1,39 @@
+/**
+ * @file ccm.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Core-coupled memory start-up and usage for the embedded sentry
+ * project.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "ccm.h"
+
+#if CCM_ENABLE
+#include <cstdint>
+
+// Defined by scripts/ccm.ld
+extern "C" uint32_t __ccm_data_load__[], __ccm_data_start__[], __ccm_data_end__[], __ccm_end__[];
+
+// Priority 101 is the first one not reserved by the toolchain; init_array is
+// sorted by priority, so the plain C++ constructors of the CCM objects run
+// after the copy and see their constant-initialized members
+__attribute__((constructor(101))) static void CcmInit()
+{
+    for (uint32_t *src = __ccm_data_load__, *dst = __ccm_data_start__; dst < __ccm_data_end__;)
+    {
+        *dst++ = *src++;
+    }
+}
+
+size_t CcmUsed()
+{
+    return (size_t)((uintptr_t)__ccm_end__ - (uintptr_t)__ccm_data_start__);
+}
+#endif
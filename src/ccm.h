@@ -0,0 +1,36 @@
+/**
+ * @file ccm.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Core-coupled memory start-up and usage for the embedded sentry
+ * project.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ *
+ * Objects are placed with CCM_DATA / CCM_NOINIT (system_config.h). The
+ * start-up code only knows .data and .bss, so ccm.cpp copies the .ccm_data
+ * image from flash in a constructor that runs ahead of all others.
+ */
+
+#ifndef CCM_H
+#define CCM_H
+
+#include <cstddef>
+
+#include "system_config.h"
+
+#if CCM_ENABLE
+/**
+ * @brief Bytes of CCM taken by .ccm_data and .ccm_noinit together
+ */
+size_t CcmUsed();
+#else
+inline size_t CcmUsed() { return 0; }
+#endif
+
+#endif  // CCM_H
@@ -21,18 +21,44 @@
 #define LCD_FRAME_BUFFER_LAYER0                  (LCD_FRAME_BUFFER+0x130000)
 #define LCD_FRAME_BUFFER_LAYER1                  LCD_FRAME_BUFFER
 #define CONVERTED_FRAME_BUFFER                   (LCD_FRAME_BUFFER+0x260000)
+#define LCD_GLYPH_ATLAS_BUFFER                   (LCD_FRAME_BUFFER+0x390000)
+/* The status overlay takes the start of the full-screen layer 1 area */
+#define LCD_OVERLAY_BUFFER                       LCD_FRAME_BUFFER_LAYER1
 
 // Constructor
-LCD_DISCO_F429ZI::LCD_DISCO_F429ZI()
+LCD_DISCO_F429ZI::LCD_DISCO_F429ZI(uint32_t PixelFormat) : _PixelFormat(PixelFormat)
+{
+  StartFull();
+}
+
+// Constructor for a staged start-up
+LCD_DISCO_F429ZI::LCD_DISCO_F429ZI(uint32_t PixelFormat, bool Deferred) : _PixelFormat(PixelFormat)
+{
+  if(!Deferred)
+  {
+    StartFull();
+  }
+}
+
+// Both layers, the glyph atlas and a white screen
+void LCD_DISCO_F429ZI::StartFull(void)
 {
   BSP_LCD_Init();  
+  BSP_LCD_GlyphAtlasInit(&Font16, LCD_GLYPH_ATLAS_BUFFER, CM_A8);
   BSP_LCD_LayerDefaultInit(1, LCD_FRAME_BUFFER_LAYER1);
   BSP_LCD_SelectLayer(1);
   BSP_LCD_Clear(LCD_COLOR_WHITE);
   BSP_LCD_SetFont(&Font16);
   BSP_LCD_SetColorKeying(1, LCD_COLOR_WHITE);
   BSP_LCD_SetLayerVisible(1, DISABLE);
-  BSP_LCD_LayerDefaultInit(0, LCD_FRAME_BUFFER_LAYER0);
+  if(_PixelFormat == LTDC_PIXEL_FORMAT_RGB565)
+  {
+    BSP_LCD_LayerRgb565Init(0, LCD_FRAME_BUFFER_LAYER0);
+  }
+  else
+  {
+    BSP_LCD_LayerDefaultInit(0, LCD_FRAME_BUFFER_LAYER0);
+  }
   BSP_LCD_SelectLayer(0);
   BSP_LCD_SetFont(&Font16);
   BSP_LCD_DisplayOn();
@@ -54,6 +80,45 @@ uint8_t LCD_DISCO_F429ZI::Init(void)
   return BSP_LCD_Init();
 }
 
+uint8_t LCD_DISCO_F429ZI::StartMinimal(void)
+{
+  uint8_t status = BSP_LCD_Init();
+  if(_PixelFormat == LTDC_PIXEL_FORMAT_RGB565)
+  {
+    BSP_LCD_LayerRgb565Init(0, LCD_FRAME_BUFFER_LAYER0);
+  }
+  else
+  {
+    BSP_LCD_LayerDefaultInit(0, LCD_FRAME_BUFFER_LAYER0);
+  }
+  /* Hidden until drawn: the SDRAM holds garbage after power-up */
+  BSP_LCD_SetLayerVisible(0, DISABLE);
+  BSP_LCD_SelectLayer(0);
+  BSP_LCD_SetFont(&Font16);
+  BSP_LCD_DisplayOn();
+  return status;
+}
+
+uint8_t LCD_DISCO_F429ZI::StartGlyphAtlas(void)
+{
+  return BSP_LCD_GlyphAtlasInit(&Font16, LCD_GLYPH_ATLAS_BUFFER, CM_A8);
+}
+
+uint8_t LCD_DISCO_F429ZI::OverlayInit(uint16_t Ypos, uint16_t Height)
+{
+  if((Height == 0) || (Ypos + Height > BSP_LCD_GetYSize()))
+  {
+    return LCD_ERROR;
+  }
+  BSP_LCD_LayerWindowInit(LCD_FOREGROUND_LAYER, LCD_OVERLAY_BUFFER, LTDC_PIXEL_FORMAT_RGB565, Ypos, Height);
+  BSP_LCD_SelectLayer(LCD_FOREGROUND_LAYER);
+  BSP_LCD_SetFont(&Font16);
+  BSP_LCD_SetTextColor(LCD_COLOR_BLACK);
+  BSP_LCD_FillRect(0, 0, BSP_LCD_GetXSize(), Height);
+  BSP_LCD_SelectLayer(LCD_BACKGROUND_LAYER);
+  return LCD_OK;
+}
+
 uint32_t LCD_DISCO_F429ZI::GetXSize(void)
 {
   return BSP_LCD_GetXSize();
@@ -69,6 +134,11 @@ void LCD_DISCO_F429ZI::LayerDefaultInit(uint16_t LayerIndex, uint32_t FB_Address
   BSP_LCD_LayerDefaultInit(LayerIndex, FB_Address);
 }
 
+void LCD_DISCO_F429ZI::LayerRgb565Init(uint16_t LayerIndex, uint32_t FB_Address)
+{
+  BSP_LCD_LayerRgb565Init(LayerIndex, FB_Address);
+}
+
 void LCD_DISCO_F429ZI::SelectLayer(uint32_t LayerIndex)
 {
   BSP_LCD_SelectLayer(LayerIndex);
@@ -89,6 +159,36 @@ void LCD_DISCO_F429ZI::SetLayerAddress(uint32_t LayerIndex, uint32_t Address)
   BSP_LCD_SetLayerAddress(LayerIndex, Address);
 }
 
+uint8_t LCD_DISCO_F429ZI::DoubleBufferInit(uint32_t LayerIndex, uint32_t BackAddress, uint32_t SyncMode)
+{
+  return BSP_LCD_DoubleBufferInit(LayerIndex, BackAddress, SyncMode);
+}
+
+uint8_t LCD_DISCO_F429ZI::SwapBuffers(uint32_t LayerIndex)
+{
+  return BSP_LCD_SwapBuffers(LayerIndex);
+}
+
+void LCD_DISCO_F429ZI::SetDma2dAsync(FunctionalState State)
+{
+  BSP_LCD_SetDma2dAsync(State);
+}
+
+void LCD_DISCO_F429ZI::SetDma2dCallback(void (*Callback)(void))
+{
+  BSP_LCD_SetDma2dCallback(Callback);
+}
+
+uint8_t LCD_DISCO_F429ZI::Dma2dBusy(void)
+{
+  return BSP_LCD_Dma2dBusy();
+}
+
+uint8_t LCD_DISCO_F429ZI::WaitForDma2d(uint32_t Timeout)
+{
+  return BSP_LCD_WaitForDma2d(Timeout);
+}
+
 void LCD_DISCO_F429ZI::SetLayerWindow(uint16_t LayerIndex, uint16_t Xpos, uint16_t Ypos, uint16_t Width, uint16_t Height)
 {
   BSP_LCD_SetLayerWindow(LayerIndex, Xpos, Ypos, Width, Height);
@@ -129,6 +229,11 @@ void LCD_DISCO_F429ZI::SetFont(sFONT *pFonts)
   BSP_LCD_SetFont(pFonts);
 }
 
+uint8_t LCD_DISCO_F429ZI::GlyphAtlasInit(sFONT *pFonts, uint32_t Address, uint32_t ColorMode)
+{
+  return BSP_LCD_GlyphAtlasInit(pFonts, Address, ColorMode);
+}
+
 sFONT *LCD_DISCO_F429ZI::GetFont(void)
 {
   return BSP_LCD_GetFont();
@@ -239,6 +344,16 @@ void LCD_DISCO_F429ZI::DisplayOff(void)
   BSP_LCD_DisplayOff();
 }
 
+uint8_t LCD_DISCO_F429ZI::Sleep(void)
+{
+  return BSP_LCD_Sleep();
+}
+
+void LCD_DISCO_F429ZI::Wake(void)
+{
+  BSP_LCD_Wake();
+}
+
 void LCD_DISCO_F429ZI::DrawPixel(uint16_t Xpos, uint16_t Ypos, uint32_t RGB_Code)
 {
   BSP_LCD_DrawPixel(Xpos, Ypos, RGB_Code);
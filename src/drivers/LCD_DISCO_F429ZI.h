@@ -24,6 +24,9 @@
 #include "mbed.h"
 #include "stm32f429i_discovery_lcd.h"
 
+// Free SDRAM for a second layer 0 frame buffer (see DoubleBufferInit)
+#define LCD_BACK_BUFFER_LAYER0                   (LCD_FRAME_BUFFER+0x400000)
+
 /*
   This class drives the LCD display (ILI9341 240x320) present on DISCO_F429ZI board.
 
@@ -50,7 +53,15 @@ class LCD_DISCO_F429ZI
   
 public:
   //! Constructor
-  LCD_DISCO_F429ZI();
+  //! @param PixelFormat: background layer format, LTDC_PIXEL_FORMAT_ARGB8888
+  //!        or LTDC_PIXEL_FORMAT_RGB565 (the foreground layer stays ARGB8888)
+  LCD_DISCO_F429ZI(uint32_t PixelFormat = LTDC_PIXEL_FORMAT_ARGB8888);
+
+  //! Constructor for a staged start-up
+  //! @param PixelFormat: background layer format, as above
+  //! @param Deferred: true to leave the hardware alone until StartMinimal()
+  //!        and StartGlyphAtlas(), false for the full set-up above
+  LCD_DISCO_F429ZI(uint32_t PixelFormat, bool Deferred);
 
   //! Destructor
   ~LCD_DISCO_F429ZI();
@@ -62,6 +73,37 @@ public:
     */
   uint8_t Init(void);
 
+  /**
+    * @brief  Fast start-up after the deferred constructor: LTDC, panel and
+    *         SDRAM, and layer 0 only, which is left hidden so the LTDC
+    *         background (black) shows until it has been drawn. Layer 1 is
+    *         not configured. Show layer 0 with SetLayerVisible().
+    * @param  None
+    * @retval LCD state
+    */
+  uint8_t StartMinimal(void);
+
+  /**
+    * @brief  Builds the Font16 glyph atlas. Needed before text is drawn after
+    *         StartMinimal(); runs on the CPU while queued DMA2D jobs go on.
+    * @param  None
+    * @retval LCD_OK or LCD_ERROR
+    */
+  uint8_t StartGlyphAtlas(void);
+
+  /**
+    * @brief  Sets up layer 1 as a status overlay: a full-width RGB565 window
+    *         of Height lines at Ypos whose frame buffer holds only those
+    *         lines (7.5 KB for one Font16 line), composited over layer 0 by
+    *         the LTDC. It starts cleared to black and transparent; show it
+    *         with SetTransparency(1, 255). Draw on it after SelectLayer(1),
+    *         in window coordinates, and never with Clear().
+    * @param  Ypos: first screen line of the window
+    * @param  Height: window height in lines
+    * @retval LCD_OK, or LCD_ERROR if the window does not fit on the screen
+    */
+  uint8_t OverlayInit(uint16_t Ypos, uint16_t Height);
+
   /**
     * @brief  Gets the LCD X size.
     * @param  None    
@@ -84,6 +126,15 @@ public:
     */
   void LayerDefaultInit(uint16_t LayerIndex, uint32_t FB_Address);
 
+  /**
+    * @brief  Initializes an LCD layer in RGB565 format (no alpha, half the
+    *         memory and bandwidth).
+    * @param  LayerIndex: the layer foreground or background. 
+    * @param  FB_Address: the layer frame buffer.
+    * @retval None
+    */
+  void LayerRgb565Init(uint16_t LayerIndex, uint32_t FB_Address);
+
   /**
     * @brief  Selects the LCD Layer.
     * @param  LayerIndex: the Layer foreground or background.
@@ -117,6 +168,52 @@ public:
     */
   void SetLayerAddress(uint32_t LayerIndex, uint32_t Address);
 
+  /**
+    * @brief  Draws a layer into a hidden back buffer from now on.
+    * @param  LayerIndex: the Layer foreground or background
+    * @param  BackAddress: the second frame buffer, e.g. LCD_BACK_BUFFER_LAYER0
+    * @param  SyncMode: LCD_SYNC_FULL or LCD_SYNC_DAMAGE
+    * @retval LCD_OK or LCD_ERROR
+    */
+  uint8_t DoubleBufferInit(uint32_t LayerIndex, uint32_t BackAddress, uint32_t SyncMode);
+
+  /**
+    * @brief  Shows what was drawn since the last call, at vertical blanking.
+    *         No effect on single-buffered layers.
+    * @param  LayerIndex: the Layer foreground or background
+    * @retval LCD_OK or LCD_TIMEOUT
+    */
+  uint8_t SwapBuffers(uint32_t LayerIndex);
+
+  /**
+    * @brief  Lets DMA2D drawing return before the transfer is done; jobs are
+    *         queued and chained from the DMA2D interrupt.
+    * @param  State: ENABLE or DISABLE
+    * @retval None
+    */
+  void SetDma2dAsync(FunctionalState State);
+
+  /**
+    * @brief  Sets a function called from interrupt context whenever the
+    *         DMA2D queue runs empty.
+    * @param  Callback: the function, or NULL
+    * @retval None
+    */
+  void SetDma2dCallback(void (*Callback)(void));
+
+  /**
+    * @brief  Tells whether queued DMA2D jobs are still running.
+    * @retval 1 if busy, 0 if idle
+    */
+  uint8_t Dma2dBusy(void);
+
+  /**
+    * @brief  Waits for all queued DMA2D jobs.
+    * @param  Timeout: maximum wait in ms
+    * @retval LCD_OK or LCD_TIMEOUT
+    */
+  uint8_t WaitForDma2d(uint32_t Timeout);
+
   /**
     * @brief  Sets the Display window.
     * @param  LayerIndex: layer index
@@ -178,6 +275,17 @@ public:
     */
   void SetFont(sFONT *pFonts);
 
+  /**
+    * @brief  Expands a font into an A8 or A4 glyph atlas so its text is
+    *         drawn with DMA2D blending. The constructor builds one for Font16
+    *         (StartGlyphAtlas() after the deferred one).
+    * @param  pFonts: the font to expand
+    * @param  Address: atlas start address, LCD_GLYPH_ATLAS_SIZE(pFonts, ColorMode) bytes
+    * @param  ColorMode: CM_A8 or CM_A4
+    * @retval LCD_OK or LCD_ERROR
+    */
+  uint8_t GlyphAtlasInit(sFONT *pFonts, uint32_t Address, uint32_t ColorMode);
+
   /**
     * @brief  Gets the Text Font.
     * @param  None
@@ -375,6 +483,21 @@ public:
     */
   void DisplayOff(void);
 
+  /**
+    * @brief  Switches the display off for Stop mode, frame buffers kept in
+    *         SDRAM self-refresh. Nothing may be drawn until Wake().
+    * @param  None
+    * @retval LCD_OK or LCD_TIMEOUT
+    */
+  uint8_t Sleep(void);
+
+  /**
+    * @brief  Switches the display back on after Sleep().
+    * @param  None
+    * @retval None
+    */
+  void Wake(void);
+
   /**
     * @brief  Writes Pixel.
     * @param  Xpos: the X position
@@ -385,7 +508,9 @@ public:
   void DrawPixel(uint16_t Xpos, uint16_t Ypos, uint32_t RGB_Code);
 
 private:
+  void StartFull(void);
 
+  uint32_t _PixelFormat;
 };
 
 #else
@@ -61,6 +61,16 @@ void TS_DISCO_F429ZI::ITClear(void)
   BSP_TS_ITClear();
 }
 
+uint8_t TS_DISCO_F429ZI::ITConfigFifo(uint8_t Threshold)
+{
+  return BSP_TS_ITConfigFifo(Threshold);
+}
+
+uint8_t TS_DISCO_F429ZI::ReadFifo(TS_StateTypeDef* TsState)
+{
+  return BSP_TS_ReadFifo(TsState);
+}
+
 //=================================================================================================================
 // Private methods
 //=================================================================================================================
@@ -103,6 +103,20 @@ public:
     * @retval None
     */  
   void ITClear(void);
+
+  /**
+    * @brief  Enables only the touch detect and FIFO threshold interrupts.
+    * @param  Threshold: FIFO level that raises an interrupt
+    * @retval TS_OK: if ITconfig is OK. Other value if error.
+    */
+  uint8_t ITConfigFifo(uint8_t Threshold);
+
+  /**
+    * @brief  Drains the touch FIFO in one I2C burst.
+    * @param  TsState: Pointer to touch screen current state structure
+    * @retval Number of samples read.
+    */
+  uint8_t ReadFifo(TS_StateTypeDef* TsState);
   
 private:
 
@@ -37,6 +37,8 @@
 /* Includes ------------------------------------------------------------------*/
 #include "stm32f429i_discovery.h"
 #include "cmsis_nvic.h" // // Added for mbed
+#include "cmsis_os2.h" // Added for mbed: the I2C bus manager sleeps on thread flags
+#include "platform/mbed_critical.h" // Added for mbed
 
 // Added for mbed. This function replaces HAL_Delay()
 void wait_ms(int ms){
@@ -60,6 +62,13 @@ void wait_ms(int ms){
 /** @defgroup STM32F429I_DISCOVERY_LOW_LEVEL_Private_TypesDefinitions STM32F429I DISCOVERY LOW LEVEL Private TypesDefinitions
   * @{
   */ 
+/* Threads waiting for the I2C bus at one priority, oldest first */
+typedef struct
+{
+  osThreadId_t Waiter[I2C_BUS_QUEUE_SIZE];
+  uint8_t      Head;
+  uint8_t      Count;
+}I2C_BUS_QueueTypeDef;
 /**
   * @}
   */ 
@@ -107,6 +116,15 @@ uint32_t I2cxTimeout = I2Cx_TIMEOUT_MAX; /*<! Value of Timeout when I2C communic
 uint32_t SpixTimeout = SPIx_TIMEOUT_MAX; /*<! Value of Timeout when SPI communication fails */  
 
 I2C_HandleTypeDef EEP_I2cHandle;
+
+/* I2C bus manager: the touch controller and the EEPROM share I2C3. One
+   transfer runs at a time; waiting threads are granted the bus by priority. */
+static I2C_BUS_QueueTypeDef       I2cBusQueue[I2C_BUS_PRIORITIES];
+static __IO uint8_t               I2cBusOwned = 0;
+static osThreadId_t __IO          I2cBusWaiter = NULL;  /* thread sleeping on the current transfer */
+static __IO uint8_t               I2cBusDone = 0;
+static __IO HAL_StatusTypeDef     I2cBusStatus = HAL_OK;
+
 static SPI_HandleTypeDef SpiHandle;
 static uint8_t Is_LCD_IO_Initialized = 0;
 
@@ -126,6 +144,12 @@ static uint8_t            I2Cx_ReadData(uint8_t Addr, uint8_t Reg);
 static uint8_t            I2Cx_ReadBuffer(uint8_t Addr, uint8_t Reg, uint8_t *pBuffer, uint16_t Length);
 static void               I2Cx_Error(void);
 static void               I2Cx_MspInit(I2C_HandleTypeDef *hi2c);  
+static void               I2Cx_Acquire(uint8_t Priority);
+static void               I2Cx_Release(void);
+static HAL_StatusTypeDef  I2Cx_Transfer(uint8_t Addr, uint16_t Reg, uint16_t RegSize, uint8_t *pBuffer, uint16_t Length, uint8_t Write, uint8_t Priority);
+static void               I2Cx_TransferDone(HAL_StatusTypeDef Status);
+static void               I2Cx_EV_IRQHandler(void);
+static void               I2Cx_ER_IRQHandler(void);
 #ifdef EE_M24LR64
 static HAL_StatusTypeDef  I2Cx_WriteBufferDMA(uint8_t Addr, uint16_t Reg,  uint8_t *pBuffer, uint16_t Length);
 static HAL_StatusTypeDef  I2Cx_ReadBufferDMA(uint8_t Addr, uint16_t Reg, uint8_t *pBuffer, uint16_t Length);
@@ -352,11 +376,15 @@ static void I2Cx_MspInit(I2C_HandleTypeDef *hi2c)
     /* Release the I2C Peripheral Clock Reset */  
     DISCOVERY_I2Cx_RELEASE_RESET(); 
     
-    /* Enable and set Discovery I2Cx Interrupt to the lowest priority */
+    // Added for mbed
+    /* Enable and set Discovery I2Cx Interrupt to the lowest priority. The
+       HAL finishes DMA memory writes (BTF, STOP) in the event interrupt. */
+    NVIC_SetVector(DISCOVERY_I2Cx_EV_IRQn, (uint32_t)I2Cx_EV_IRQHandler);
     HAL_NVIC_SetPriority(DISCOVERY_I2Cx_EV_IRQn, 0x0F, 0);
     HAL_NVIC_EnableIRQ(DISCOVERY_I2Cx_EV_IRQn);
     
     /* Enable and set Discovery I2Cx Interrupt to the lowest priority */
+    NVIC_SetVector(DISCOVERY_I2Cx_ER_IRQn, (uint32_t)I2Cx_ER_IRQHandler);
     HAL_NVIC_SetPriority(DISCOVERY_I2Cx_ER_IRQn, 0x0F, 0);
     HAL_NVIC_EnableIRQ(DISCOVERY_I2Cx_ER_IRQn);  
 
@@ -490,17 +518,9 @@ static void I2Cx_ITConfig(void)
   * @param  Value: The target register value to be written 
   */
 static void I2Cx_WriteData(uint8_t Addr, uint8_t Reg, uint8_t Value)
-  {
-  HAL_StatusTypeDef status = HAL_OK;
-  
-  status = HAL_I2C_Mem_Write(&EEP_I2cHandle, Addr, (uint16_t)Reg, I2C_MEMADD_SIZE_8BIT, &Value, 1, I2cxTimeout); 
-  
-  /* Check the communication status */
-  if(status != HAL_OK)
-  {
-    /* Re-Initialize the BUS */
-    I2Cx_Error();
-  }        
+{
+  /* Register accesses come from the touch controller: high priority */
+  I2Cx_Transfer(Addr, (uint16_t)Reg, I2C_MEMADD_SIZE_8BIT, &Value, 1, 1, I2C_BUS_PRIORITY_HIGH);
 }
 
 /**
@@ -511,17 +531,8 @@ static void I2Cx_WriteData(uint8_t Addr, uint8_t Reg, uint8_t Value)
   * @param  Length: buffer size to be written
   */
 static void I2Cx_WriteBuffer(uint8_t Addr, uint8_t Reg,  uint8_t *pBuffer, uint16_t Length)
-  {
-  HAL_StatusTypeDef status = HAL_OK;
-  
-  status = HAL_I2C_Mem_Write(&EEP_I2cHandle, Addr, (uint16_t)Reg, I2C_MEMADD_SIZE_8BIT, pBuffer, Length, I2cxTimeout); 
-
-  /* Check the communication status */
-  if(status != HAL_OK)
-  {
-    /* Re-Initialize the BUS */
-    I2Cx_Error();
-  }        
+{
+  I2Cx_Transfer(Addr, (uint16_t)Reg, I2C_MEMADD_SIZE_8BIT, pBuffer, Length, 1, I2C_BUS_PRIORITY_HIGH);
 }
 
 /**
@@ -532,18 +543,10 @@ static void I2Cx_WriteBuffer(uint8_t Addr, uint8_t Reg,  uint8_t *pBuffer, uint1
   */
 static uint8_t I2Cx_ReadData(uint8_t Addr, uint8_t Reg)
 {
-  HAL_StatusTypeDef status = HAL_OK;
   uint8_t value = 0;
   
-  status = HAL_I2C_Mem_Read(&EEP_I2cHandle, Addr, Reg, I2C_MEMADD_SIZE_8BIT, &value, 1, I2cxTimeout);
- 
-  /* Check the communication status */
-  if(status != HAL_OK)
-  {
-    /* Re-Initialize the BUS */
-    I2Cx_Error();
+  I2Cx_Transfer(Addr, (uint16_t)Reg, I2C_MEMADD_SIZE_8BIT, &value, 1, 0, I2C_BUS_PRIORITY_HIGH);
   
-  }
   return value;
 }
 
@@ -557,22 +560,11 @@ static uint8_t I2Cx_ReadData(uint8_t Addr, uint8_t Reg)
   */
 static uint8_t I2Cx_ReadBuffer(uint8_t Addr, uint8_t Reg, uint8_t *pBuffer, uint16_t Length)
 {
-  HAL_StatusTypeDef status = HAL_OK;
-
-  status = HAL_I2C_Mem_Read(&EEP_I2cHandle, Addr, (uint16_t)Reg, I2C_MEMADD_SIZE_8BIT, pBuffer, Length, I2cxTimeout);
-  
-  /* Check the communication status */
-  if(status == HAL_OK)
+  if(I2Cx_Transfer(Addr, (uint16_t)Reg, I2C_MEMADD_SIZE_8BIT, pBuffer, Length, 0, I2C_BUS_PRIORITY_HIGH) == HAL_OK)
   {
     return 0;
   }
-  else
-  {
-    /* Re-Initialize the BUS */
-    I2Cx_Error();
-
-    return 1;
-  }
+  return 1;
 }
 
 #ifdef EE_M24LR64
@@ -585,19 +577,9 @@ static uint8_t I2Cx_ReadBuffer(uint8_t Addr, uint8_t Reg, uint8_t *pBuffer, uint
   * @retval HAL status
   */
 static HAL_StatusTypeDef I2Cx_WriteBufferDMA(uint8_t Addr, uint16_t Reg,  uint8_t *pBuffer, uint16_t Length)
-  {
-  HAL_StatusTypeDef status = HAL_OK;
-  
-  status = HAL_I2C_Mem_Write_DMA(&EEP_I2cHandle, Addr, Reg, I2C_MEMADD_SIZE_16BIT, pBuffer, Length);
-
-  /* Check the communication status */
-  if(status != HAL_OK)
-  {
-    /* Re-Initialize the BUS */
-    I2Cx_Error();
-  }
-
-  return status;
+{
+  /* Bulk EEPROM traffic yields to the touch controller */
+  return I2Cx_Transfer(Addr, Reg, I2C_MEMADD_SIZE_16BIT, pBuffer, Length, 1, I2C_BUS_PRIORITY_LOW);
 }
 
 /**
@@ -610,18 +592,7 @@ static HAL_StatusTypeDef I2Cx_WriteBufferDMA(uint8_t Addr, uint16_t Reg,  uint8_
   */
 static HAL_StatusTypeDef I2Cx_ReadBufferDMA(uint8_t Addr, uint16_t Reg, uint8_t *pBuffer, uint16_t Length)
 {
-  HAL_StatusTypeDef status = HAL_OK;
-
-  status = HAL_I2C_Mem_Read_DMA(&EEP_I2cHandle, Addr, Reg, I2C_MEMADD_SIZE_16BIT, pBuffer, Length);
-  
-  /* Check the communication status */
-  if(status != HAL_OK)
-  {
-    /* Re-Initialize the BUS */
-    I2Cx_Error();
-  }
-  
-  return status;
+  return I2Cx_Transfer(Addr, Reg, I2C_MEMADD_SIZE_16BIT, pBuffer, Length, 0, I2C_BUS_PRIORITY_LOW);
 }
 
 /**
@@ -633,10 +604,214 @@ static HAL_StatusTypeDef I2Cx_ReadBufferDMA(uint8_t Addr, uint16_t Reg, uint8_t
 */
 static HAL_StatusTypeDef I2Cx_IsDeviceReady(uint16_t DevAddress, uint32_t Trials)
 { 
-  return (HAL_I2C_IsDeviceReady(&EEP_I2cHandle, DevAddress, Trials, I2cxTimeout));
+  HAL_StatusTypeDef status = HAL_ERROR;
+  
+  /* The bus is requested again for every trial, so touch reads are served
+     while the EEPROM is busy with its internal write cycle */
+  while((Trials > 0) && (status != HAL_OK))
+  {
+    I2Cx_Acquire(I2C_BUS_PRIORITY_LOW);
+    status = HAL_I2C_IsDeviceReady(&EEP_I2cHandle, DevAddress, 1, I2cxTimeout);
+    I2Cx_Release();
+    Trials--;
+  }
+  return status;
 }
 #endif /* EE_M24LR64 */
 
+/**
+  * @brief  Waits until the I2C bus is granted to the calling thread. Threads
+  *         queue by priority and the bus is handed over directly on release,
+  *         so a high priority client never waits behind queued bulk traffic.
+  * @param  Priority: I2C_BUS_PRIORITY_HIGH or I2C_BUS_PRIORITY_LOW
+  */
+static void I2Cx_Acquire(uint8_t Priority)
+{
+  osThreadId_t self = osThreadGetId();
+  I2C_BUS_QueueTypeDef *queue = &I2cBusQueue[Priority];
+
+  while(1)
+  {
+    core_util_critical_section_enter();
+    if(!I2cBusOwned && (I2cBusQueue[I2C_BUS_PRIORITY_HIGH].Count == 0) && (I2cBusQueue[I2C_BUS_PRIORITY_LOW].Count == 0))
+    {
+      I2cBusOwned = 1;
+      core_util_critical_section_exit();
+      return;
+    }
+    if((self != NULL) && (queue->Count < I2C_BUS_QUEUE_SIZE))
+    {
+      queue->Waiter[(queue->Head + queue->Count) % I2C_BUS_QUEUE_SIZE] = self;
+      queue->Count++;
+      core_util_critical_section_exit();
+
+      /* Ownership is passed on by I2Cx_Release() */
+      osThreadFlagsWait(I2C_BUS_GRANT_FLAG, osFlagsWaitAny, osWaitForever);
+      return;
+    }
+    core_util_critical_section_exit();
+
+    /* Before the kernel runs, or with more clients than queue slots */
+    if(self != NULL)
+    {
+      osThreadYield();
+    }
+  }
+}
+
+/**
+  * @brief  Releases the I2C bus to the oldest waiter of the highest priority.
+  */
+static void I2Cx_Release(void)
+{
+  osThreadId_t next = NULL;
+  uint8_t priority;
+
+  core_util_critical_section_enter();
+  for(priority = 0; (priority < I2C_BUS_PRIORITIES) && (next == NULL); priority++)
+  {
+    I2C_BUS_QueueTypeDef *queue = &I2cBusQueue[priority];
+    if(queue->Count > 0)
+    {
+      next = queue->Waiter[queue->Head];
+      queue->Head = (queue->Head + 1) % I2C_BUS_QUEUE_SIZE;
+      queue->Count--;
+    }
+  }
+  if(next == NULL)
+  {
+    I2cBusOwned = 0;
+  }
+  core_util_critical_section_exit();
+
+  if(next != NULL)
+  {
+    osThreadFlagsSet(next, I2C_BUS_GRANT_FLAG);
+  }
+}
+
+/**
+  * @brief  Runs one memory transfer on the bus through DMA. The calling
+  *         thread sleeps until the transfer complete (or error) interrupt.
+  * @param  Addr: Device address on BUS Bus.
+  * @param  Reg: The target register / memory address
+  * @param  RegSize: I2C_MEMADD_SIZE_8BIT or I2C_MEMADD_SIZE_16BIT
+  * @param  pBuffer: pointer to the data buffer, must stay valid until return
+  * @param  Length: length of the data
+  * @param  Write: 1 to write to the device, 0 to read from it
+  * @param  Priority: I2C_BUS_PRIORITY_HIGH or I2C_BUS_PRIORITY_LOW
+  * @retval HAL status
+  */
+static HAL_StatusTypeDef I2Cx_Transfer(uint8_t Addr, uint16_t Reg, uint16_t RegSize, uint8_t *pBuffer, uint16_t Length, uint8_t Write, uint8_t Priority)
+{
+  HAL_StatusTypeDef status;
+  uint32_t timeout = I2C_BUS_TIMEOUT(Length);
+  uint32_t tickstart;
+
+  I2Cx_Acquire(Priority);
+
+  I2cBusDone = 0;
+  I2cBusStatus = HAL_OK;
+  I2cBusWaiter = osThreadGetId();
+  if(I2cBusWaiter != NULL)
+  {
+    osThreadFlagsClear(I2C_BUS_DONE_FLAG);
+  }
+
+  if(Write)
+  {
+    status = HAL_I2C_Mem_Write_DMA(&EEP_I2cHandle, Addr, Reg, RegSize, pBuffer, Length);
+  }
+  else
+  {
+    status = HAL_I2C_Mem_Read_DMA(&EEP_I2cHandle, Addr, Reg, RegSize, pBuffer, Length);
+  }
+
+  if(status == HAL_OK)
+  {
+    tickstart = HAL_GetTick();
+    while((I2cBusDone == 0) && ((HAL_GetTick() - tickstart) < timeout))
+    {
+      if(I2cBusWaiter != NULL)
+      {
+        osThreadFlagsWait(I2C_BUS_DONE_FLAG, osFlagsWaitAny, timeout);
+      }
+    }
+    status = I2cBusDone ? I2cBusStatus : HAL_TIMEOUT;
+  }
+  I2cBusWaiter = NULL;
+
+  /* Check the communication status */
+  if(status != HAL_OK)
+  {
+    /* Re-Initialize the BUS */
+    I2Cx_Error();
+  }
+
+  I2Cx_Release();
+  return status;
+}
+
+/**
+  * @brief  Completes the current transfer (interrupt context).
+  * @param  Status: HAL_OK or the error seen by the HAL
+  */
+static void I2Cx_TransferDone(HAL_StatusTypeDef Status)
+{
+  osThreadId_t waiter = I2cBusWaiter;
+
+  I2cBusStatus = Status;
+  I2cBusDone = 1;
+  if(waiter != NULL)
+  {
+    osThreadFlagsSet(waiter, I2C_BUS_DONE_FLAG);
+  }
+}
+
+/**
+  * @brief  Memory Tx Transfer completed callbacks.
+  * @param  hi2c: I2C handle
+  */
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+  I2Cx_TransferDone(HAL_OK);
+}
+
+/**
+  * @brief  Memory Rx Transfer completed callbacks.
+  * @param  hi2c: I2C handle
+  */
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+  I2Cx_TransferDone(HAL_OK);
+}
+
+/**
+  * @brief  I2C error callbacks.
+  * @param  hi2c: I2C handle
+  */
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+  I2Cx_TransferDone(HAL_ERROR);
+}
+
+// Added for mbed
+/**
+  * @brief  This function handles I2Cx event interrupt request.
+  */
+static void I2Cx_EV_IRQHandler(void)
+{
+  HAL_I2C_EV_IRQHandler(&EEP_I2cHandle);
+}
+
+/**
+  * @brief  This function handles I2Cx error interrupt request.
+  */
+static void I2Cx_ER_IRQHandler(void)
+{
+  HAL_I2C_ER_IRQHandler(&EEP_I2cHandle);
+}
+
 /**
   * @brief  I2Cx error treatment function
   */
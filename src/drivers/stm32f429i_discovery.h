@@ -185,6 +185,20 @@ typedef enum
 
 #define I2Cx_TIMEOUT_MAX                    0x3000 /*<! The value of the maximal timeout for I2C waiting loops */
 
+/* I2C bus manager. Every transfer on I2Cx runs through DMA; when both clients
+   want the bus, touch controller register accesses are served before EEPROM
+   traffic. */
+#define I2C_BUS_PRIORITY_HIGH               0  /* touch controller (IOE) */
+#define I2C_BUS_PRIORITY_LOW                1  /* EEPROM */
+#define I2C_BUS_PRIORITIES                  2
+#ifndef I2C_BUS_QUEUE_SIZE
+ #define I2C_BUS_QUEUE_SIZE                 4  /* waiting threads per priority */
+#endif /* I2C_BUS_QUEUE_SIZE */
+#define I2C_BUS_GRANT_FLAG                  0x40000000U /* thread flag: bus handed over */
+#define I2C_BUS_DONE_FLAG                   0x20000000U /* thread flag: transfer finished */
+/* Transfer timeout in ms: ~90 us per byte at 100 kHz, plus margin */
+#define I2C_BUS_TIMEOUT(len)                (10 + (len) / 8)
+
 /*############################### SPIx #######################################*/
 #define DISCOVERY_SPIx                          SPI5
 #define DISCOVERY_SPIx_CLK_ENABLE()             __HAL_RCC_SPI5_CLK_ENABLE()
@@ -197,21 +197,18 @@ uint32_t BSP_EEPROM_ReadBuffer(uint8_t *pBuffer, uint16_t ReadAddr, uint16_t *Nu
   DMA transfer has been complete or not. */
   EEPROMDataRead = *NumByteToRead;
   
-  if (EEPROM_IO_ReadData(EEPROMAddress, ReadAddr, pBuffer, buffersize) != HAL_OK)
+  /* The I2C bus manager returns once the DMA transfer is complete */
+  switch (EEPROM_IO_ReadData(EEPROMAddress, ReadAddr, pBuffer, buffersize))
   {
+  case HAL_OK:
+    break;
+  case HAL_TIMEOUT:
+    BSP_EEPROM_TIMEOUT_UserCallback();
+    return EEPROM_TIMEOUT;
+  default:
     return EEPROM_FAIL;
   }
-
-  /* Wait transfer through DMA to be complete */
-  EEPROMTimeout = HAL_GetTick() + EEPROM_READ_TIMEOUT;
-  while (EEPROMDataRead > 0)
-  {
-    if(HAL_GetTick() > EEPROMTimeout)
-    {
-      BSP_EEPROM_TIMEOUT_UserCallback();
-      return EEPROM_TIMEOUT;
-    }
-  }
+  EEPROMDataRead = 0;
   
   /* If all operations OK, return EEPROM_OK (0) */
   return EEPROM_OK;
@@ -254,21 +251,19 @@ uint32_t BSP_EEPROM_WritePage(uint8_t *pBuffer, uint16_t WriteAddr, uint8_t *Num
       DMA transfer has been complete or not. */
   EEPROMDataWrite = *NumByteToWrite;  
   
-  if (EEPROM_IO_WriteData(EEPROMAddress, WriteAddr, pBuffer, buffersize) != HAL_OK)
+  /* The I2C bus manager returns once the DMA transfer is complete */
+  switch (EEPROM_IO_WriteData(EEPROMAddress, WriteAddr, pBuffer, buffersize))
   {
+  case HAL_OK:
+    break;
+  case HAL_TIMEOUT:
+    BSP_EEPROM_TIMEOUT_UserCallback();
+    return EEPROM_TIMEOUT;
+  default:
     status = EEPROM_FAIL;
+    break;
   }
-  
-  /* Wait transfer through DMA to be complete */
-  EEPROMTimeout = HAL_GetTick() + EEPROM_WRITE_TIMEOUT;
-  while (EEPROMDataWrite > 0)
-  {
-    if(HAL_GetTick() > EEPROMTimeout)
-    {
-      BSP_EEPROM_TIMEOUT_UserCallback();
-      return EEPROM_TIMEOUT;
-    }
-  }
+  EEPROMDataWrite = 0;
   
   if (BSP_EEPROM_WaitEepromStandbyState() != EEPROM_OK) 
   {
@@ -457,23 +452,8 @@ uint32_t BSP_EEPROM_WaitEepromStandbyState(void)
   return EEPROM_OK;
 }
 
-/**
-  * @brief  Memory Tx Transfer completed callbacks.
-  * @param  hi2c: I2C handle
-  */
-void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c)
-{
-  EEPROMDataWrite = 0;  
-}
-
-/**
-  * @brief  Memory Rx Transfer completed callbacks.
-  * @param  hi2c: I2C handle
-  */
-void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
-{
-  EEPROMDataRead = 0;
-}
+/* The HAL_I2C_Mem*CpltCallback()s live with the I2C bus manager in
+   stm32f429i_discovery.c, which completes every transfer on the bus. */
 
 /**
   * @brief  Basic management of the timeout situation.
@@ -113,6 +113,12 @@
   * @{
   */
 #define ABS(X)  ((X) > 0 ? (X) : -(X))
+#define LCD_MIN(A, B)  ((A) < (B) ? (A) : (B))
+#define ARGB8888_TO_RGB565(C)  ((uint16_t)((((C) >> 8) & 0xF800) | (((C) >> 5) & 0x07E0) | (((C) >> 3) & 0x001F)))
+#define RGB565_TO_ARGB8888(C)  (0xFF000000 | (((C) & 0xF800) << 8) | (((C) & 0xE000) << 3) | \
+                                (((C) & 0x07E0) << 5) | (((C) & 0x0600) >> 1) | \
+                                (((C) & 0x001F) << 3) | (((C) & 0x001C) >> 2))
+#define LCD_MAX(A, B)  ((A) > (B) ? (A) : (B))
 /**
   * @}
   */ 
@@ -127,6 +133,56 @@ static RCC_PeriphCLKInitTypeDef  PeriphClkInitStruct;
 /* Default LCD configuration with LCD Layer 1 */
 static uint32_t ActiveLayer = 0;
 static LCD_DrawPropTypeDef DrawProp[MAX_LAYER_NUMBER];
+
+/* Registered glyph atlases */
+typedef struct
+{
+  sFONT    *pFont;
+  uint32_t Address;
+  uint32_t ColorMode;
+} LCD_GlyphAtlasTypeDef;
+static LCD_GlyphAtlasTypeDef GlyphAtlas[LCD_GLYPH_ATLAS_MAX];
+static uint32_t GlyphAtlasCount = 0;
+
+/* Drawing target of each layer. Equal to the displayed frame buffer, except
+   in double-buffered mode where it is the hidden back buffer. */
+typedef struct
+{
+  uint16_t X0, Y0, X1, Y1;  /* X1/Y1 exclusive */
+} LCD_DamageRectTypeDef;
+typedef struct
+{
+  uint32_t DrawAddress;
+  uint8_t  DoubleBuffer;
+  uint8_t  SyncMode;
+  uint8_t  DamageCount;
+  LCD_DamageRectTypeDef Damage[LCD_DAMAGE_RECT_MAX];
+} LCD_BufferTypeDef;
+static LCD_BufferTypeDef LayerBuffer[MAX_LAYER_NUMBER];
+
+/* DMA2D jobs, started back to back from the transfer complete interrupt */
+typedef struct
+{
+  uint32_t Mode;
+  uint32_t ColorMode;         /* output color mode */
+  uint32_t OutputOffset;
+  uint32_t FgColorMode;
+  uint32_t FgOffset;
+  uint32_t FgColor;           /* A8/A4 glyph color */
+  uint32_t BgColorMode;       /* blending only */
+  uint32_t BgOffset;
+  uint32_t Src;               /* source address, or the R2M color */
+  uint32_t Bg;                /* blending only */
+  uint32_t Dst;
+  uint32_t Width;
+  uint32_t Height;
+} LCD_Dma2dJobTypeDef;
+static LCD_Dma2dJobTypeDef Dma2dQueue[LCD_DMA2D_QUEUE_SIZE];
+static volatile uint32_t Dma2dHead = 0;     /* next free slot */
+static volatile uint32_t Dma2dTail = 0;     /* job on the DMA2D, if Dma2dBusy */
+static volatile uint8_t  Dma2dBusy = 0;
+static uint8_t Dma2dAsync = 0;
+static void (*Dma2dDoneCallback)(void) = NULL;
 LCD_DrvTypeDef  *LcdDrv;
 /**
   * @}
@@ -136,6 +192,16 @@ LCD_DrvTypeDef  *LcdDrv;
   * @{
   */ 
 static void DrawChar(uint16_t Xpos, uint16_t Ypos, const uint8_t *c);
+static void LayerInit(uint16_t LayerIndex, uint32_t FB_Address, uint32_t PixelFormat, uint8_t Alpha);
+static const LCD_GlyphAtlasTypeDef *FindGlyphAtlas(sFONT *pFont);
+static uint32_t GetLayerBpp(uint32_t LayerIndex);
+static void MarkDamage(uint32_t LayerIndex, uint32_t Xpos, uint32_t Ypos, uint32_t Width, uint32_t Height);
+static void CopyBuffer(uint32_t LayerIndex, uint32_t Src, uint32_t Dst, uint32_t Xpos, uint32_t Ypos, uint32_t Width, uint32_t Height);
+static void SubmitDma2dJob(const LCD_Dma2dJobTypeDef *pJob);
+static void StartDma2dJob(const LCD_Dma2dJobTypeDef *pJob);
+static void Dma2dTransferComplete(DMA2D_HandleTypeDef *hdma2d);
+static void Dma2dIRQHandler(void);
+static void BlitChar(uint16_t Xpos, uint16_t Ypos, uint8_t Ascii, const LCD_GlyphAtlasTypeDef *pAtlas, uint8_t FillBackground);
 static void FillBuffer(uint32_t LayerIndex, void *pDst, uint32_t xSize, uint32_t ySize, uint32_t OffLine, uint32_t ColorIndex);
 static void ConvertLineToARGB8888(void *pSrc, void *pDst, uint32_t xSize, uint32_t ColorMode);
 /**
@@ -226,6 +292,12 @@ uint8_t BSP_LCD_Init(void)
     /* Initialize the font */
     BSP_LCD_SetFont(&LCD_DEFAULT_FONT);
 
+    /* DMA2D completion interrupt, used to chain queued jobs */
+    Dma2dHandler.Instance = DMA2D;
+    NVIC_SetVector(DMA2D_IRQn, (uint32_t)Dma2dIRQHandler);
+    HAL_NVIC_SetPriority(DMA2D_IRQn, LCD_DMA2D_IRQ_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(DMA2D_IRQn);
+
   return LCD_OK;
 }  
 
@@ -253,6 +325,55 @@ uint32_t BSP_LCD_GetYSize(void)
   * @param  FB_Address: the layer frame buffer.
   */
 void BSP_LCD_LayerDefaultInit(uint16_t LayerIndex, uint32_t FB_Address)
+{     
+  LayerInit(LayerIndex, FB_Address, LTDC_PIXEL_FORMAT_ARGB8888, 255);
+}
+
+/**
+  * @brief  Initializes an LCD layer in RGB565 format. Without an alpha
+  *         channel the layer takes half the SDRAM and half the scan-out
+  *         bandwidth of an ARGB8888 layer.
+  * @param  LayerIndex: the layer foreground or background. 
+  * @param  FB_Address: the layer frame buffer.
+  */
+void BSP_LCD_LayerRgb565Init(uint16_t LayerIndex, uint32_t FB_Address)
+{     
+  LayerInit(LayerIndex, FB_Address, LTDC_PIXEL_FORMAT_RGB565, 255);
+}
+
+/**
+  * @brief  Initializes a layer as a full-width window of Height lines at
+  *         Ypos, with a frame buffer of just those lines. The layer starts
+  *         fully transparent; BSP_LCD_SetTransparency() shows it. Drawing
+  *         on it uses window coordinates (line 0 is Ypos on screen); the
+  *         drawing functions step lines by the screen width, which is the
+  *         window width. Clear the window with BSP_LCD_FillRect(), as
+  *         BSP_LCD_Clear() covers a whole screen.
+  * @param  LayerIndex: the layer foreground or background. 
+  * @param  FB_Address: the frame buffer, screen width x Height pixels
+  * @param  PixelFormat: LTDC_PIXEL_FORMAT_ARGB8888 or LTDC_PIXEL_FORMAT_RGB565
+  * @param  Ypos: first screen line of the window
+  * @param  Height: window height in lines
+  */
+void BSP_LCD_LayerWindowInit(uint16_t LayerIndex, uint32_t FB_Address, uint32_t PixelFormat, uint16_t Ypos, uint16_t Height)
+{
+  /* Transparent while it still spans the whole screen */
+  LayerInit(LayerIndex, FB_Address, PixelFormat, 0);
+
+  /* Shrink to the window and drop any keying, applied in one reload */
+  BSP_LCD_SetLayerWindow_NoReload(LayerIndex, 0, Ypos, BSP_LCD_GetXSize(), Height);
+  BSP_LCD_ResetColorKeying_NoReload(LayerIndex);
+  BSP_LCD_Relaod(LCD_RELOAD_IMMEDIATE);
+}
+
+/**
+  * @brief  Initializes an LCD layer.
+  * @param  LayerIndex: the layer foreground or background. 
+  * @param  FB_Address: the layer frame buffer.
+  * @param  PixelFormat: LTDC_PIXEL_FORMAT_ARGB8888 or LTDC_PIXEL_FORMAT_RGB565
+  * @param  Alpha: constant alpha, 255 opaque
+  */
+static void LayerInit(uint16_t LayerIndex, uint32_t FB_Address, uint32_t PixelFormat, uint8_t Alpha)
 {     
   LCD_LayerCfgTypeDef   Layercfg;
 
@@ -261,9 +382,9 @@ void BSP_LCD_LayerDefaultInit(uint16_t LayerIndex, uint32_t FB_Address)
   Layercfg.WindowX1 = BSP_LCD_GetXSize();
   Layercfg.WindowY0 = 0;
   Layercfg.WindowY1 = BSP_LCD_GetYSize(); 
-  Layercfg.PixelFormat = LTDC_PIXEL_FORMAT_ARGB8888;
+  Layercfg.PixelFormat = PixelFormat;
   Layercfg.FBStartAdress = FB_Address;
-  Layercfg.Alpha = 255;
+  Layercfg.Alpha = Alpha;
   Layercfg.Alpha0 = 0;
   Layercfg.Backcolor.Blue = 0;
   Layercfg.Backcolor.Green = 0;
@@ -275,6 +396,10 @@ void BSP_LCD_LayerDefaultInit(uint16_t LayerIndex, uint32_t FB_Address)
   
   HAL_LTDC_ConfigLayer(&LtdcHandler, &Layercfg, LayerIndex); 
 
+  LayerBuffer[LayerIndex].DrawAddress = FB_Address;
+  LayerBuffer[LayerIndex].DoubleBuffer = 0;
+  LayerBuffer[LayerIndex].DamageCount = 0;
+
   DrawProp[LayerIndex].BackColor = LCD_COLOR_WHITE;
   DrawProp[LayerIndex].pFont     = &Font24;
   DrawProp[LayerIndex].TextColor = LCD_COLOR_BLACK; 
@@ -364,6 +489,11 @@ void BSP_LCD_SetTransparency_NoReload(uint32_t LayerIndex, uint8_t Transparency)
 void BSP_LCD_SetLayerAddress(uint32_t LayerIndex, uint32_t Address)
 {     
   HAL_LTDC_SetAddress(&LtdcHandler, Address, LayerIndex);
+
+  /* Drawing follows the displayed buffer again */
+  LayerBuffer[LayerIndex].DrawAddress = Address;
+  LayerBuffer[LayerIndex].DoubleBuffer = 0;
+  LayerBuffer[LayerIndex].DamageCount = 0;
 }
 
 /**
@@ -470,6 +600,165 @@ void BSP_LCD_Relaod(uint32_t ReloadType)
   HAL_LTDC_Relaod (&LtdcHandler, ReloadType);
 }
 
+/**
+  * @brief  Switches a layer to double buffering. Drawing then goes to a
+  *         hidden back buffer that BSP_LCD_SwapBuffers() shows at the next
+  *         vertical blanking, so partial updates are never scanned out.
+  * @param  LayerIndex: layer index
+  * @param  BackAddress: second frame buffer, the same size as the first
+  * @param  SyncMode: how the buffers are kept equal after a flip
+  *          This parameter can be one of the following values:
+  *            @arg LCD_SYNC_FULL: copy the whole frame
+  *            @arg LCD_SYNC_DAMAGE: copy only the rectangles drawn since
+  *                 the last flip
+  * @retval LCD_OK or LCD_ERROR
+  */
+uint8_t BSP_LCD_DoubleBufferInit(uint32_t LayerIndex, uint32_t BackAddress, uint32_t SyncMode)
+{
+  uint32_t front;
+
+  if((LayerIndex >= MAX_LAYER_NUMBER) ||
+     ((SyncMode != LCD_SYNC_FULL) && (SyncMode != LCD_SYNC_DAMAGE)))
+  {
+    return LCD_ERROR;
+  }
+  front = LtdcHandler.LayerCfg[LayerIndex].FBStartAdress;
+  if(BackAddress == front)
+  {
+    return LCD_ERROR;
+  }
+
+  /* Start from the picture on screen */
+  CopyBuffer(LayerIndex, front, BackAddress, 0, 0, BSP_LCD_GetXSize(), BSP_LCD_GetYSize());
+
+  LayerBuffer[LayerIndex].DrawAddress = BackAddress;
+  LayerBuffer[LayerIndex].DoubleBuffer = 1;
+  LayerBuffer[LayerIndex].SyncMode = SyncMode;
+  LayerBuffer[LayerIndex].DamageCount = 0;
+  return LCD_OK;
+}
+
+/**
+  * @brief  Shows the back buffer of a double-buffered layer. The address is
+  *         latched at vertical blanking; the old front buffer then becomes
+  *         the back buffer and is brought up to date per the sync mode.
+  *         Does nothing if nothing was drawn since the last flip or the
+  *         layer is single-buffered.
+  * @param  LayerIndex: layer index
+  * @retval LCD_OK, or LCD_TIMEOUT if no vertical blanking was seen and the
+  *         flip was forced immediately
+  */
+uint8_t BSP_LCD_SwapBuffers(uint32_t LayerIndex)
+{
+  LCD_BufferTypeDef *buffer = &LayerBuffer[LayerIndex];
+  uint32_t front = LtdcHandler.LayerCfg[LayerIndex].FBStartAdress;
+  uint32_t back = buffer->DrawAddress;
+  uint32_t tickstart;
+  uint8_t status = LCD_OK;
+  uint32_t i;
+
+  if(!buffer->DoubleBuffer || (buffer->DamageCount == 0))
+  {
+    return LCD_OK;
+  }
+
+  /* Everything queued for the back buffer has to be in it */
+  BSP_LCD_WaitForDma2d(LCD_DMA2D_TIMEOUT);
+
+  BSP_LCD_SetLayerAddress_NoReload(LayerIndex, back);
+  BSP_LCD_Relaod(LCD_RELOAD_VERTICAL_BLANKING);
+
+  /* VBR is cleared by hardware once the shadow registers are reloaded */
+  tickstart = HAL_GetTick();
+  while(LtdcHandler.Instance->SRCR & LTDC_SRCR_VBR)
+  {
+    if((HAL_GetTick() - tickstart) > LCD_FLIP_TIMEOUT)
+    {
+      /* No blanking seen: flip now rather than draw into the shown buffer */
+      BSP_LCD_Relaod(LCD_RELOAD_IMMEDIATE);
+      status = LCD_TIMEOUT;
+      break;
+    }
+  }
+
+  /* Bring the old front buffer up to date before it is drawn into */
+  if(buffer->SyncMode == LCD_SYNC_DAMAGE)
+  {
+    for(i = 0; i < buffer->DamageCount; i++)
+    {
+      LCD_DamageRectTypeDef *rect = &buffer->Damage[i];
+      CopyBuffer(LayerIndex, back, front, rect->X0, rect->Y0, rect->X1 - rect->X0, rect->Y1 - rect->Y0);
+    }
+  }
+  else
+  {
+    CopyBuffer(LayerIndex, back, front, 0, 0, BSP_LCD_GetXSize(), BSP_LCD_GetYSize());
+  }
+
+  buffer->DrawAddress = front;
+  buffer->DamageCount = 0;
+  return status;
+}
+
+/**
+  * @brief  Selects whether DMA2D drawing returns before the transfer ends.
+  *         In asynchronous mode fills, copies, bitmaps and atlas glyphs are
+  *         queued and chained from the completion interrupt, and the CPU is
+  *         free until it draws pixels itself or calls BSP_LCD_WaitForDma2d().
+  * @param  State: ENABLE for asynchronous, DISABLE to wait for every job
+  */
+void BSP_LCD_SetDma2dAsync(FunctionalState State)
+{
+  BSP_LCD_WaitForDma2d(LCD_DMA2D_TIMEOUT);
+  Dma2dAsync = (State == ENABLE);
+}
+
+/**
+  * @brief  Sets a function called from interrupt context each time the DMA2D
+  *         queue runs empty, e.g. to signal an RTOS event.
+  * @param  Callback: the function, or NULL
+  */
+void BSP_LCD_SetDma2dCallback(void (*Callback)(void))
+{
+  Dma2dDoneCallback = Callback;
+}
+
+/**
+  * @brief  Tells whether queued DMA2D jobs are still running.
+  * @retval 1 if busy, 0 if idle
+  */
+uint8_t BSP_LCD_Dma2dBusy(void)
+{
+  return Dma2dBusy;
+}
+
+/**
+  * @brief  Waits until all queued DMA2D jobs are done.
+  * @param  Timeout: maximum wait in ms
+  * @retval LCD_OK, or LCD_TIMEOUT if the queue was dropped
+  */
+uint8_t BSP_LCD_WaitForDma2d(uint32_t Timeout)
+{
+  uint32_t tickstart = HAL_GetTick();
+
+  while(Dma2dBusy)
+  {
+    if((HAL_GetTick() - tickstart) > Timeout)
+    {
+      /* Drop what is left rather than hang the caller */
+      HAL_NVIC_DisableIRQ(DMA2D_IRQn);
+      DMA2D->CR &= ~DMA2D_CR_START;
+      Dma2dTail = Dma2dHead;
+      Dma2dBusy = 0;
+      Dma2dHandler.State = HAL_DMA2D_STATE_READY;
+      __HAL_UNLOCK(&Dma2dHandler);
+      HAL_NVIC_EnableIRQ(DMA2D_IRQn);
+      return LCD_TIMEOUT;
+    }
+  }
+  return LCD_OK;
+}
+
 /**
   * @brief  Gets the LCD Text color.
   * @retval Text color
@@ -528,33 +817,44 @@ sFONT *BSP_LCD_GetFont(void)
   * @brief  Reads Pixel.
   * @param  Xpos: the X position
   * @param  Ypos: the Y position 
-  * @retval RGB pixel color
+  * @retval RGB pixel color; RGB565 pixels are expanded to ARGB8888 so the
+  *         value can be passed back to BSP_LCD_DrawPixel()
   */
 uint32_t BSP_LCD_ReadPixel(uint16_t Xpos, uint16_t Ypos)
 {
   uint32_t ret = 0;
+
+  /* Queued DMA2D jobs may still write this pixel */
+  if(Dma2dBusy)
+  {
+    BSP_LCD_WaitForDma2d(LCD_DMA2D_TIMEOUT);
+  }
   
   if(LtdcHandler.LayerCfg[ActiveLayer].PixelFormat == LTDC_PIXEL_FORMAT_ARGB8888)
   {
     /* Read data value from SDRAM memory */
-    ret = *(__IO uint32_t*) (LtdcHandler.LayerCfg[ActiveLayer].FBStartAdress + (4*(Ypos*BSP_LCD_GetXSize() + Xpos)));
+    ret = *(__IO uint32_t*) (LayerBuffer[ActiveLayer].DrawAddress + (4*(Ypos*BSP_LCD_GetXSize() + Xpos)));
   }
   else if(LtdcHandler.LayerCfg[ActiveLayer].PixelFormat == LTDC_PIXEL_FORMAT_RGB888)
   {
     /* Read data value from SDRAM memory */
-    ret = (*(__IO uint32_t*) (LtdcHandler.LayerCfg[ActiveLayer].FBStartAdress + (4*(Ypos*BSP_LCD_GetXSize() + Xpos))) & 0x00FFFFFF);
+    ret = (*(__IO uint32_t*) (LayerBuffer[ActiveLayer].DrawAddress + (4*(Ypos*BSP_LCD_GetXSize() + Xpos))) & 0x00FFFFFF);
   }
-  else if((LtdcHandler.LayerCfg[ActiveLayer].PixelFormat == LTDC_PIXEL_FORMAT_RGB565) || \
-          (LtdcHandler.LayerCfg[ActiveLayer].PixelFormat == LTDC_PIXEL_FORMAT_ARGB4444) || \
+  else if(LtdcHandler.LayerCfg[ActiveLayer].PixelFormat == LTDC_PIXEL_FORMAT_RGB565)
+  {
+    /* Read data value from SDRAM memory */
+    ret = RGB565_TO_ARGB8888(*(__IO uint16_t*) (LayerBuffer[ActiveLayer].DrawAddress + (2*(Ypos*BSP_LCD_GetXSize() + Xpos))));
+  }
+  else if((LtdcHandler.LayerCfg[ActiveLayer].PixelFormat == LTDC_PIXEL_FORMAT_ARGB4444) || \
           (LtdcHandler.LayerCfg[ActiveLayer].PixelFormat == LTDC_PIXEL_FORMAT_AL88))  
   {
     /* Read data value from SDRAM memory */
-    ret = *(__IO uint16_t*) (LtdcHandler.LayerCfg[ActiveLayer].FBStartAdress + (2*(Ypos*BSP_LCD_GetXSize() + Xpos)));    
+    ret = *(__IO uint16_t*) (LayerBuffer[ActiveLayer].DrawAddress + (2*(Ypos*BSP_LCD_GetXSize() + Xpos)));    
   }
   else
   {
     /* Read data value from SDRAM memory */
-    ret = *(__IO uint8_t*) (LtdcHandler.LayerCfg[ActiveLayer].FBStartAdress + (2*(Ypos*BSP_LCD_GetXSize() + Xpos)));    
+    ret = *(__IO uint8_t*) (LayerBuffer[ActiveLayer].DrawAddress + (2*(Ypos*BSP_LCD_GetXSize() + Xpos)));    
   }
 
   return ret;
@@ -567,7 +867,7 @@ uint32_t BSP_LCD_ReadPixel(uint16_t Xpos, uint16_t Ypos)
 void BSP_LCD_Clear(uint32_t Color)
 { 
   /* Clear the LCD */ 
-  FillBuffer(ActiveLayer, (uint32_t *)(LtdcHandler.LayerCfg[ActiveLayer].FBStartAdress), BSP_LCD_GetXSize(), BSP_LCD_GetYSize(), 0, Color);
+  FillBuffer(ActiveLayer, (uint32_t *)(LayerBuffer[ActiveLayer].DrawAddress), BSP_LCD_GetXSize(), BSP_LCD_GetYSize(), 0, Color);
 }
 
 /**
@@ -594,10 +894,104 @@ void BSP_LCD_ClearStringLine(uint32_t Line)
   */
 void BSP_LCD_DisplayChar(uint16_t Xpos, uint16_t Ypos, uint8_t Ascii)
 {
+  const LCD_GlyphAtlasTypeDef *atlas = FindGlyphAtlas(DrawProp[ActiveLayer].pFont);
+
+  if(atlas != NULL)
+  {
+    BlitChar(Xpos, Ypos, Ascii, atlas, 1);
+    return;
+  }
+
   DrawChar(Xpos, Ypos, &DrawProp[ActiveLayer].pFont->table[(Ascii-' ') *\
               DrawProp[ActiveLayer].pFont->Height * ((DrawProp[ActiveLayer].pFont->Width + 7) / 8)]);
 }
 
+/**
+  * @brief  Expands a font into an alpha-only glyph atlas and registers it.
+  *         Text in that font is then drawn with DMA2D blending: one
+  *         register-to-memory fill for the background of a string and one
+  *         memory-to-memory blend per glyph.
+  * @param  pFont: font to expand
+  * @param  Address: atlas start address, LCD_GLYPH_ATLAS_SIZE(pFont, ColorMode)
+  *         bytes in memory DMA2D can read (SDRAM or SRAM, not CCM)
+  * @param  ColorMode: CM_A8 (one byte per pixel) or CM_A4 (two pixels per byte)
+  * @retval LCD_OK, or LCD_ERROR if the mode is not supported or the
+  *         registry is full
+  */
+uint8_t BSP_LCD_GlyphAtlasInit(sFONT *pFont, uint32_t Address, uint32_t ColorMode)
+{
+  uint32_t glyph, i, j, index;
+  uint32_t stride = (pFont->Width + 7) / 8;
+  uint32_t offset = 8 * stride - pFont->Width;
+  uint32_t glyphsize = LCD_GLYPH_SIZE(pFont, ColorMode);
+  uint8_t *pDst = (uint8_t *)Address;
+  LCD_GlyphAtlasTypeDef *atlas = (LCD_GlyphAtlasTypeDef *)FindGlyphAtlas(pFont);
+
+  if((ColorMode != CM_A8) && (ColorMode != CM_A4))
+  {
+    return LCD_ERROR;
+  }
+  if(atlas == NULL)
+  {
+    if(GlyphAtlasCount >= LCD_GLYPH_ATLAS_MAX)
+    {
+      return LCD_ERROR;
+    }
+    atlas = &GlyphAtlas[GlyphAtlasCount];
+  }
+  else
+  {
+    /* Queued glyphs may still read the old atlas; a new one can be built
+       while other DMA2D jobs run */
+    BSP_LCD_WaitForDma2d(LCD_DMA2D_TIMEOUT);
+  }
+
+  for(glyph = 0; glyph < LCD_GLYPH_COUNT; glyph++)
+  {
+    const uint8_t *c = &pFont->table[glyph * pFont->Height * stride];
+    uint8_t *pGlyph = pDst + glyph * glyphsize;
+
+    for(i = 0; i < glyphsize; i++)
+    {
+      pGlyph[i] = 0;
+    }
+
+    for(i = 0; i < pFont->Height; i++)
+    {
+      const uint8_t *pchar = c + stride * i;
+      uint32_t line = pchar[0];
+      if(stride > 1) line = (line << 8) | pchar[1];
+      if(stride > 2) line = (line << 8) | pchar[2];
+
+      for(j = 0; j < pFont->Width; j++)
+      {
+        if(line & (1 << (pFont->Width - j + offset - 1)))
+        {
+          index = i * pFont->Width + j;
+          if(ColorMode == CM_A8)
+          {
+            pGlyph[index] = 0xFF;
+          }
+          else
+          {
+            /* A4: first pixel of each pair in the low nibble */
+            pGlyph[index / 2] |= (index & 1) ? 0xF0 : 0x0F;
+          }
+        }
+      }
+    }
+  }
+
+  atlas->pFont = pFont;
+  atlas->Address = Address;
+  atlas->ColorMode = ColorMode;
+  if(atlas == &GlyphAtlas[GlyphAtlasCount])
+  {
+    GlyphAtlasCount++;
+  }
+  return LCD_OK;
+}
+
 /**
   * @brief  Displays a maximum of 60 char on the LCD.
   * @param  X: pointer to x position (in pixel)
@@ -614,6 +1008,7 @@ void BSP_LCD_DisplayStringAt(uint16_t X, uint16_t Y, uint8_t *pText, Text_AlignM
   uint16_t refcolumn = 1, i = 0;
   uint32_t size = 0, xsize = 0; 
   uint8_t  *ptr = pText;
+  const LCD_GlyphAtlasTypeDef *atlas;
   
   /* Get the text size */
   while (*ptr++) size ++ ;
@@ -645,11 +1040,36 @@ void BSP_LCD_DisplayStringAt(uint16_t X, uint16_t Y, uint8_t *pText, Text_AlignM
     }
   }
 
+  atlas = FindGlyphAtlas(DrawProp[ActiveLayer].pFont);
+  if(atlas != NULL)
+  {
+    /* One fill for the background of every glyph that fits on the line */
+    uint32_t fit = 0;
+    while((fit < size) && (refcolumn + (fit + 1) * DrawProp[ActiveLayer].pFont->Width <= BSP_LCD_GetXSize()))
+    {
+      fit++;
+    }
+    if(fit > 0)
+    {
+      uint32_t backup = DrawProp[ActiveLayer].TextColor;
+      DrawProp[ActiveLayer].TextColor = DrawProp[ActiveLayer].BackColor;
+      BSP_LCD_FillRect(refcolumn, Y, fit * DrawProp[ActiveLayer].pFont->Width, DrawProp[ActiveLayer].pFont->Height);
+      DrawProp[ActiveLayer].TextColor = backup;
+    }
+  }
+
   /* Send the string character by character on LCD */
   while ((*pText != 0) & (((BSP_LCD_GetXSize() - (i*DrawProp[ActiveLayer].pFont->Width)) & 0xFFFF) >= DrawProp[ActiveLayer].pFont->Width))
   {
     /* Display one character on LCD */
-    BSP_LCD_DisplayChar(refcolumn, Y, *pText);
+    if(atlas != NULL)
+    {
+      BlitChar(refcolumn, Y, *pText, atlas, 0);
+    }
+    else
+    {
+      BSP_LCD_DisplayChar(refcolumn, Y, *pText);
+    }
     /* Decrement the column position by 16 */
     refcolumn += DrawProp[ActiveLayer].pFont->Width;
     /* Point on the next character */
@@ -679,7 +1099,7 @@ void BSP_LCD_DrawHLine(uint16_t Xpos, uint16_t Ypos, uint16_t Length)
   uint32_t xaddress = 0;
   
   /* Get the line address */
-  xaddress = (LtdcHandler.LayerCfg[ActiveLayer].FBStartAdress) + 4*(BSP_LCD_GetXSize()*Ypos + Xpos);
+  xaddress = (LayerBuffer[ActiveLayer].DrawAddress) + GetLayerBpp(ActiveLayer)*(BSP_LCD_GetXSize()*Ypos + Xpos);
 
   /* Write line */
   FillBuffer(ActiveLayer, (uint32_t *)xaddress, Length, 1, 0, DrawProp[ActiveLayer].TextColor);
@@ -696,7 +1116,7 @@ void BSP_LCD_DrawVLine(uint16_t Xpos, uint16_t Ypos, uint16_t Length)
   uint32_t xaddress = 0;
   
   /* Get the line address */
-  xaddress = (LtdcHandler.LayerCfg[ActiveLayer].FBStartAdress) + 4*(BSP_LCD_GetXSize()*Ypos + Xpos);
+  xaddress = (LayerBuffer[ActiveLayer].DrawAddress) + GetLayerBpp(ActiveLayer)*(BSP_LCD_GetXSize()*Ypos + Xpos);
   
   /* Write line */
   FillBuffer(ActiveLayer, (uint32_t *)xaddress, 1, Length, (BSP_LCD_GetXSize() - 1), DrawProp[ActiveLayer].TextColor);
@@ -917,7 +1337,8 @@ void BSP_LCD_DrawBitmap(uint32_t X, uint32_t Y, uint8_t *pBmp)
   bitpixel = pBmp[28] + (pBmp[29] << 8);   
  
   /* Set Address */
-  address = LtdcHandler.LayerCfg[ActiveLayer].FBStartAdress + (((BSP_LCD_GetXSize()*Y) + X)*(4));
+  address = LayerBuffer[ActiveLayer].DrawAddress + (((BSP_LCD_GetXSize()*Y) + X)*GetLayerBpp(ActiveLayer));
+  MarkDamage(ActiveLayer, X, Y, width, height);
 
   /* Get the Layer pixel format */    
   if ((bitpixel/8) == 4)
@@ -936,14 +1357,14 @@ void BSP_LCD_DrawBitmap(uint32_t X, uint32_t Y, uint8_t *pBmp)
   /* bypass the bitmap header */
   pBmp += (index + (width * (height - 1) * (bitpixel/8)));
 
-  /* Convert picture to ARGB8888 pixel format */
+  /* Convert picture to the layer pixel format */
   for(index=0; index < height; index++)
   {
   /* Pixel format conversion */
   ConvertLineToARGB8888((uint32_t *)pBmp, (uint32_t *)address, width, inputcolormode);
 
   /* Increment the source and destination buffers */
-  address+=  ((BSP_LCD_GetXSize() - width + width)*4);
+  address+=  ((BSP_LCD_GetXSize() - width + width)*GetLayerBpp(ActiveLayer));
   pBmp -= width*(bitpixel/8);
   }
 }
@@ -963,7 +1384,7 @@ void BSP_LCD_FillRect(uint16_t Xpos, uint16_t Ypos, uint16_t Width, uint16_t Hei
   BSP_LCD_SetTextColor(DrawProp[ActiveLayer].TextColor);
 
   /* Get the rectangle start address */
-  xaddress = (LtdcHandler.LayerCfg[ActiveLayer].FBStartAdress) + 4*(BSP_LCD_GetXSize()*Ypos + Xpos);
+  xaddress = (LayerBuffer[ActiveLayer].DrawAddress) + GetLayerBpp(ActiveLayer)*(BSP_LCD_GetXSize()*Ypos + Xpos);
 
   /* Fill the rectangle */
   FillBuffer(ActiveLayer, (uint32_t *)xaddress, Width, Height, (BSP_LCD_GetXSize() - Width), DrawProp[ActiveLayer].TextColor);
@@ -1214,6 +1635,46 @@ void BSP_LCD_DisplayOff(void)
   }
 }
 
+/**
+  * @brief  Switches the panel and the LTDC scan-out off and puts the SDRAM
+  *         into self-refresh, so the frame buffers survive Stop mode, when
+  *         the FMC clock is gone. Nothing may be drawn until BSP_LCD_Wake().
+  * @retval LCD_OK, or LCD_TIMEOUT if queued DMA2D jobs had to be dropped
+  */
+uint8_t BSP_LCD_Sleep(void)
+{
+  FMC_SDRAM_CommandTypeDef command;
+  uint8_t status = BSP_LCD_WaitForDma2d(LCD_DMA2D_TIMEOUT);
+
+  BSP_LCD_DisplayOff();
+  __HAL_LTDC_DISABLE(&LtdcHandler);
+
+  command.CommandMode            = FMC_SDRAM_CMD_SELFREFRESH_MODE;
+  command.CommandTarget          = FMC_SDRAM_CMD_TARGET_BANK2;
+  command.AutoRefreshNumber      = 1;
+  command.ModeRegisterDefinition = 0;
+  BSP_SDRAM_Sendcmd(&command);
+  return status;
+}
+
+/**
+  * @brief  Undoes BSP_LCD_Sleep(): SDRAM back to normal mode, scan-out and
+  *         panel on. The frame buffers show what was on screen before.
+  */
+void BSP_LCD_Wake(void)
+{
+  FMC_SDRAM_CommandTypeDef command;
+
+  command.CommandMode            = FMC_SDRAM_CMD_NORMAL_MODE;
+  command.CommandTarget          = FMC_SDRAM_CMD_TARGET_BANK2;
+  command.AutoRefreshNumber      = 1;
+  command.ModeRegisterDefinition = 0;
+  BSP_SDRAM_Sendcmd(&command);
+
+  __HAL_LTDC_ENABLE(&LtdcHandler);
+  BSP_LCD_DisplayOn();
+}
+
 /*******************************************************************************
                        LTDC and DMA2D BSP Routines
 *******************************************************************************/
@@ -1303,12 +1764,28 @@ __weak void BSP_LCD_MspInit(void)
   * @brief  Writes Pixel.
   * @param  Xpos: the X position
   * @param  Ypos: the Y position
-  * @param  RGB_Code: the pixel color in ARGB mode (8-8-8-8)  
+  * @param  RGB_Code: the pixel color in ARGB mode (8-8-8-8), converted for
+  *         RGB565 layers
   */
 void BSP_LCD_DrawPixel(uint16_t Xpos, uint16_t Ypos, uint32_t RGB_Code)
 {
-  /* Write data value to all SDRAM memory */
-  *(__IO uint32_t*) (LtdcHandler.LayerCfg[ActiveLayer].FBStartAdress + (4*(Ypos*BSP_LCD_GetXSize() + Xpos))) = RGB_Code;
+  /* Keep CPU and DMA2D writes in program order */
+  if(Dma2dBusy)
+  {
+    BSP_LCD_WaitForDma2d(LCD_DMA2D_TIMEOUT);
+  }
+
+  if(LtdcHandler.LayerCfg[ActiveLayer].PixelFormat == LTDC_PIXEL_FORMAT_RGB565)
+  {
+    /* Write data value to all SDRAM memory */
+    *(__IO uint16_t*) (LayerBuffer[ActiveLayer].DrawAddress + (2*(Ypos*BSP_LCD_GetXSize() + Xpos))) = ARGB8888_TO_RGB565(RGB_Code);
+  }
+  else
+  {
+    /* Write data value to all SDRAM memory */
+    *(__IO uint32_t*) (LayerBuffer[ActiveLayer].DrawAddress + (4*(Ypos*BSP_LCD_GetXSize() + Xpos))) = RGB_Code;
+  }
+  MarkDamage(ActiveLayer, Xpos, Ypos, 1, 1);
 }
 
 /**
@@ -1365,6 +1842,200 @@ static void DrawChar(uint16_t Xpos, uint16_t Ypos, const uint8_t *c)
   }
 }
 
+/**
+  * @brief  Looks up the glyph atlas of a font.
+  * @param  pFont: the font
+  * @retval The atlas, or NULL if the font has none
+  */
+static const LCD_GlyphAtlasTypeDef *FindGlyphAtlas(sFONT *pFont)
+{
+  uint32_t i;
+
+  for(i = 0; i < GlyphAtlasCount; i++)
+  {
+    if(GlyphAtlas[i].pFont == pFont)
+    {
+      return &GlyphAtlas[i];
+    }
+  }
+  return NULL;
+}
+
+/**
+  * @brief  Draws one character by blending its atlas glyph onto the layer.
+  *         The glyph supplies the alpha, the text color the RGB value.
+  * @param  Xpos: the X position
+  * @param  Ypos: the Y position
+  * @param  Ascii: character ascii code, between LCD_GLYPH_FIRST and LCD_GLYPH_LAST
+  * @param  pAtlas: atlas of the current font
+  * @param  FillBackground: 1 to paint the back color under the glyph first,
+  *         0 if the caller already did
+  */
+static void BlitChar(uint16_t Xpos, uint16_t Ypos, uint8_t Ascii, const LCD_GlyphAtlasTypeDef *pAtlas, uint8_t FillBackground)
+{
+  sFONT *pFont = pAtlas->pFont;
+  uint32_t format = LtdcHandler.LayerCfg[ActiveLayer].PixelFormat;
+  uint32_t bpp = GetLayerBpp(ActiveLayer);
+  uint32_t address;
+  uint32_t color = DrawProp[ActiveLayer].TextColor;
+  LCD_Dma2dJobTypeDef job = {0};
+
+  if((Ascii < LCD_GLYPH_FIRST) || (Ascii > LCD_GLYPH_LAST) ||
+     (Xpos + pFont->Width > BSP_LCD_GetXSize()) || (Ypos + pFont->Height > BSP_LCD_GetYSize()))
+  {
+    return;
+  }
+
+  if(FillBackground)
+  {
+    uint32_t backup = DrawProp[ActiveLayer].TextColor;
+    DrawProp[ActiveLayer].TextColor = DrawProp[ActiveLayer].BackColor;
+    BSP_LCD_FillRect(Xpos, Ypos, pFont->Width, pFont->Height);
+    DrawProp[ActiveLayer].TextColor = backup;
+  }
+
+  address = LayerBuffer[ActiveLayer].DrawAddress + bpp * (Ypos * BSP_LCD_GetXSize() + Xpos);
+
+  /* Memory to memory with blending: glyph over the framebuffer, in place */
+  job.Mode         = DMA2D_M2M_BLEND;
+  job.ColorMode    = format;
+  job.OutputOffset = BSP_LCD_GetXSize() - pFont->Width;
+
+  /* Foreground: the glyph */
+  job.FgColorMode = pAtlas->ColorMode;
+  job.FgOffset    = 0;
+  job.FgColor     = color;
+
+  /* Background: the pixels already on the layer */
+  job.BgColorMode = format;
+  job.BgOffset    = BSP_LCD_GetXSize() - pFont->Width;
+
+  job.Src    = pAtlas->Address + (Ascii - LCD_GLYPH_FIRST) * LCD_GLYPH_SIZE(pFont, pAtlas->ColorMode);
+  job.Bg     = address;
+  job.Dst    = address;
+  job.Width  = pFont->Width;
+  job.Height = pFont->Height;
+  SubmitDma2dJob(&job);
+
+  MarkDamage(ActiveLayer, Xpos, Ypos, pFont->Width, pFont->Height);
+}
+
+/**
+  * @brief  Returns the bytes per pixel of a layer.
+  * @param  LayerIndex: layer index
+  * @retval 4, 3 or 2
+  */
+static uint32_t GetLayerBpp(uint32_t LayerIndex)
+{
+  uint32_t format = LtdcHandler.LayerCfg[LayerIndex].PixelFormat;
+
+  if(format == LTDC_PIXEL_FORMAT_ARGB8888)
+  {
+    return 4;
+  }
+  if(format == LTDC_PIXEL_FORMAT_RGB888)
+  {
+    return 3;
+  }
+  return 2;
+}
+
+/**
+  * @brief  Records a drawn rectangle on a double-buffered layer. Rectangles
+  *         that touch are merged; when the list is full the new one is
+  *         merged into the rectangle it grows least.
+  * @param  LayerIndex: layer index
+  * @param  Xpos: the X position
+  * @param  Ypos: the Y position
+  * @param  Width: rectangle width
+  * @param  Height: rectangle height
+  */
+static void MarkDamage(uint32_t LayerIndex, uint32_t Xpos, uint32_t Ypos, uint32_t Width, uint32_t Height)
+{
+  LCD_BufferTypeDef *buffer = &LayerBuffer[LayerIndex];
+  uint32_t x1 = Xpos + Width, y1 = Ypos + Height;
+  uint32_t i, best = 0, bestgrowth = 0xFFFFFFFF;
+  LCD_DamageRectTypeDef *rect;
+
+  if(!buffer->DoubleBuffer || (Width == 0) || (Height == 0))
+  {
+    return;
+  }
+  if(x1 > BSP_LCD_GetXSize()) x1 = BSP_LCD_GetXSize();
+  if(y1 > BSP_LCD_GetYSize()) y1 = BSP_LCD_GetYSize();
+  if((Xpos >= x1) || (Ypos >= y1))
+  {
+    return;
+  }
+
+  for(i = 0; i < buffer->DamageCount; i++)
+  {
+    uint32_t growth;
+    rect = &buffer->Damage[i];
+
+    if((Xpos <= rect->X1) && (x1 >= rect->X0) && (Ypos <= rect->Y1) && (y1 >= rect->Y0))
+    {
+      /* Overlapping or adjacent */
+      best = i;
+      bestgrowth = 0;
+      break;
+    }
+    growth = (LCD_MAX(rect->X1, x1) - LCD_MIN(rect->X0, Xpos)) * (LCD_MAX(rect->Y1, y1) - LCD_MIN(rect->Y0, Ypos)) -
+             (rect->X1 - rect->X0) * (rect->Y1 - rect->Y0);
+    if(growth < bestgrowth)
+    {
+      best = i;
+      bestgrowth = growth;
+    }
+  }
+
+  if((bestgrowth != 0) && (buffer->DamageCount < LCD_DAMAGE_RECT_MAX))
+  {
+    rect = &buffer->Damage[buffer->DamageCount++];
+    rect->X0 = Xpos;
+    rect->Y0 = Ypos;
+    rect->X1 = x1;
+    rect->Y1 = y1;
+  }
+  else
+  {
+    rect = &buffer->Damage[best];
+    rect->X0 = LCD_MIN(rect->X0, Xpos);
+    rect->Y0 = LCD_MIN(rect->Y0, Ypos);
+    rect->X1 = LCD_MAX(rect->X1, x1);
+    rect->Y1 = LCD_MAX(rect->Y1, y1);
+  }
+}
+
+/**
+  * @brief  Copies a rectangle between two frame buffers of a layer.
+  * @param  LayerIndex: layer index
+  * @param  Src: source frame buffer
+  * @param  Dst: destination frame buffer
+  * @param  Xpos: the X position
+  * @param  Ypos: the Y position
+  * @param  Width: rectangle width
+  * @param  Height: rectangle height
+  */
+static void CopyBuffer(uint32_t LayerIndex, uint32_t Src, uint32_t Dst, uint32_t Xpos, uint32_t Ypos, uint32_t Width, uint32_t Height)
+{
+  uint32_t format = LtdcHandler.LayerCfg[LayerIndex].PixelFormat;
+  uint32_t offset = GetLayerBpp(LayerIndex) * (Ypos * BSP_LCD_GetXSize() + Xpos);
+  LCD_Dma2dJobTypeDef job = {0};
+
+  /* Memory to memory, same pixel format on both ends */
+  job.Mode         = DMA2D_M2M;
+  job.ColorMode    = format;
+  job.OutputOffset = BSP_LCD_GetXSize() - Width;
+  job.FgColorMode  = format;
+  job.FgOffset     = BSP_LCD_GetXSize() - Width;
+  job.Src          = Src + offset;
+  job.Dst          = Dst + offset;
+  job.Width        = Width;
+  job.Height       = Height;
+  SubmitDma2dJob(&job);
+}
+
 /**
   * @brief  Fills buffer.
   * @param  LayerIndex: layer index
@@ -1376,62 +2047,180 @@ static void DrawChar(uint16_t Xpos, uint16_t Ypos, const uint8_t *c)
   */
 static void FillBuffer(uint32_t LayerIndex, void * pDst, uint32_t xSize, uint32_t ySize, uint32_t OffLine, uint32_t ColorIndex) 
 {
-  
-  /* Register to memory mode with ARGB8888 as color Mode */ 
-  Dma2dHandler.Init.Mode         = DMA2D_R2M;
-  Dma2dHandler.Init.ColorMode    = DMA2D_ARGB8888;
-  Dma2dHandler.Init.OutputOffset = OffLine;      
-  
-  Dma2dHandler.Instance = DMA2D; 
-  
-  /* DMA2D Initialization */
-  if(HAL_DMA2D_Init(&Dma2dHandler) == HAL_OK) 
+  LCD_Dma2dJobTypeDef job = {0};
+
+  /* Register to memory mode in the layer color mode; the ARGB8888 color is
+     converted by the HAL */ 
+  job.Mode         = DMA2D_R2M;
+  job.ColorMode    = LtdcHandler.LayerCfg[LayerIndex].PixelFormat;
+  job.OutputOffset = OffLine;
+  job.Src          = ColorIndex;
+  job.Dst          = (uint32_t)pDst;
+  job.Width        = xSize;
+  job.Height       = ySize;
+  SubmitDma2dJob(&job);
+
+  /* Every fill lands at an offset from the layer's drawing target */
+  if(LayerBuffer[LayerIndex].DoubleBuffer)
   {
-    if(HAL_DMA2D_ConfigLayer(&Dma2dHandler, LayerIndex) == HAL_OK) 
-    {
-      if (HAL_DMA2D_Start(&Dma2dHandler, ColorIndex, (uint32_t)pDst, xSize, ySize) == HAL_OK)
-      {
-        /* Polling For DMA transfer */  
-        HAL_DMA2D_PollForTransfer(&Dma2dHandler, 10);
-      }
-    }
-  } 
+    uint32_t pixel = ((uint32_t)pDst - LayerBuffer[LayerIndex].DrawAddress) / GetLayerBpp(LayerIndex);
+    MarkDamage(LayerIndex, pixel % BSP_LCD_GetXSize(), pixel / BSP_LCD_GetXSize(), xSize, ySize);
+  }
 }
 
 /**
-  * @brief  Converts Line to ARGB8888 pixel format.
+  * @brief  Converts Line to the pixel format of the active layer (ARGB8888
+  *         unless it was set up with BSP_LCD_LayerRgb565Init()).
   * @param  pSrc: pointer to source buffer
   * @param  pDst: output color
   * @param  xSize: buffer width
   * @param  ColorMode: input color mode   
   */
 static void ConvertLineToARGB8888(void * pSrc, void * pDst, uint32_t xSize, uint32_t ColorMode)
-{    
+{
+  LCD_Dma2dJobTypeDef job = {0};
+
   /* Configure the DMA2D Mode, Color Mode and output offset */
-  Dma2dHandler.Init.Mode         = DMA2D_M2M_PFC;
-  Dma2dHandler.Init.ColorMode    = DMA2D_ARGB8888;
-  Dma2dHandler.Init.OutputOffset = 0;     
-  
+  job.Mode         = DMA2D_M2M_PFC;
+  job.ColorMode    = LtdcHandler.LayerCfg[ActiveLayer].PixelFormat;
+  job.OutputOffset = 0;
+
   /* Foreground Configuration */
-  Dma2dHandler.LayerCfg[1].AlphaMode = DMA2D_NO_MODIF_ALPHA;
+  job.FgColorMode = ColorMode;
+  job.FgOffset    = 0;
+
+  job.Src    = (uint32_t)pSrc;
+  job.Dst    = (uint32_t)pDst;
+  job.Width  = xSize;
+  job.Height = 1;
+  SubmitDma2dJob(&job);
+}
+
+/**
+  * @brief  Queues a DMA2D job and starts it if the DMA2D is idle. Waits for
+  *         a free slot when the queue is full, and for completion unless
+  *         asynchronous mode is on.
+  * @param  pJob: the job, copied
+  */
+static void SubmitDma2dJob(const LCD_Dma2dJobTypeDef *pJob)
+{
+  uint32_t tickstart = HAL_GetTick();
+
+  while((Dma2dHead - Dma2dTail) >= LCD_DMA2D_QUEUE_SIZE)
+  {
+    if((HAL_GetTick() - tickstart) > LCD_DMA2D_TIMEOUT)
+    {
+      BSP_LCD_WaitForDma2d(0);
+      break;
+    }
+  }
+
+  HAL_NVIC_DisableIRQ(DMA2D_IRQn);
+  Dma2dQueue[Dma2dHead % LCD_DMA2D_QUEUE_SIZE] = *pJob;
+  Dma2dHead++;
+  if(!Dma2dBusy)
+  {
+    Dma2dBusy = 1;
+    StartDma2dJob(&Dma2dQueue[Dma2dTail % LCD_DMA2D_QUEUE_SIZE]);
+  }
+  HAL_NVIC_EnableIRQ(DMA2D_IRQn);
+
+  if(!Dma2dAsync)
+  {
+    BSP_LCD_WaitForDma2d(LCD_DMA2D_TIMEOUT);
+  }
+}
+
+/**
+  * @brief  Programs the DMA2D for a job and starts it with interrupts.
+  *         Called from thread context with the DMA2D interrupt masked, or
+  *         from the completion interrupt.
+  * @param  pJob: the job
+  */
+static void StartDma2dJob(const LCD_Dma2dJobTypeDef *pJob)
+{
+  HAL_StatusTypeDef status = HAL_ERROR;
+
+  Dma2dHandler.Init.Mode         = pJob->Mode;
+  Dma2dHandler.Init.ColorMode    = pJob->ColorMode;
+  Dma2dHandler.Init.OutputOffset = pJob->OutputOffset;
+
+  /* Foreground */
+  Dma2dHandler.LayerCfg[1].AlphaMode = (pJob->Mode == DMA2D_M2M_BLEND) ? DMA2D_COMBINE_ALPHA : DMA2D_NO_MODIF_ALPHA;
   Dma2dHandler.LayerCfg[1].InputAlpha = 0xFF;
-  Dma2dHandler.LayerCfg[1].InputColorMode = ColorMode;
-  Dma2dHandler.LayerCfg[1].InputOffset = 0;
-  
-  Dma2dHandler.Instance = DMA2D; 
-  
-  /* DMA2D Initialization */
-  if(HAL_DMA2D_Init(&Dma2dHandler) == HAL_OK) 
+  Dma2dHandler.LayerCfg[1].InputColorMode = pJob->FgColorMode;
+  Dma2dHandler.LayerCfg[1].InputOffset = pJob->FgOffset;
+
+  /* Background */
+  Dma2dHandler.LayerCfg[0].AlphaMode = DMA2D_NO_MODIF_ALPHA;
+  Dma2dHandler.LayerCfg[0].InputAlpha = 0xFF;
+  Dma2dHandler.LayerCfg[0].InputColorMode = pJob->BgColorMode;
+  Dma2dHandler.LayerCfg[0].InputOffset = pJob->BgOffset;
+
+  Dma2dHandler.Instance = DMA2D;
+  Dma2dHandler.XferCpltCallback = Dma2dTransferComplete;
+  Dma2dHandler.XferErrorCallback = Dma2dTransferComplete;
+
+  if(HAL_DMA2D_Init(&Dma2dHandler) == HAL_OK)
   {
-    if(HAL_DMA2D_ConfigLayer(&Dma2dHandler, 1) == HAL_OK) 
+    if(pJob->Mode == DMA2D_R2M)
     {
-      if (HAL_DMA2D_Start(&Dma2dHandler, (uint32_t)pSrc, (uint32_t)pDst, xSize, 1) == HAL_OK)
+      status = HAL_DMA2D_Start_IT(&Dma2dHandler, pJob->Src, pJob->Dst, pJob->Width, pJob->Height);
+    }
+    else if(pJob->Mode == DMA2D_M2M_BLEND)
+    {
+      if((HAL_DMA2D_ConfigLayer(&Dma2dHandler, 0) == HAL_OK) && (HAL_DMA2D_ConfigLayer(&Dma2dHandler, 1) == HAL_OK))
       {
-        /* Polling For DMA transfer */  
-        HAL_DMA2D_PollForTransfer(&Dma2dHandler, 10);
+        /* A8/A4 pixels carry only alpha: RGB and the global alpha come from the
+           text color, written directly as HAL versions differ in how they map it */
+        DMA2D->FGCOLR = pJob->FgColor & 0x00FFFFFF;
+        MODIFY_REG(DMA2D->FGPFCCR, DMA2D_FGPFCCR_ALPHA, pJob->FgColor & 0xFF000000);
+
+        status = HAL_DMA2D_BlendingStart_IT(&Dma2dHandler, pJob->Src, pJob->Bg, pJob->Dst, pJob->Width, pJob->Height);
       }
     }
-  } 
+    else if(HAL_DMA2D_ConfigLayer(&Dma2dHandler, 1) == HAL_OK)
+    {
+      status = HAL_DMA2D_Start_IT(&Dma2dHandler, pJob->Src, pJob->Dst, pJob->Width, pJob->Height);
+    }
+  }
+
+  if(status != HAL_OK)
+  {
+    /* Skip the job so the queue keeps moving */
+    Dma2dTransferComplete(&Dma2dHandler);
+  }
+}
+
+/**
+  * @brief  DMA2D transfer complete or error: start the next queued job.
+  * @param  hdma2d: DMA2D handle
+  */
+static void Dma2dTransferComplete(DMA2D_HandleTypeDef *hdma2d)
+{
+  (void)hdma2d;
+
+  Dma2dTail++;
+  if(Dma2dTail != Dma2dHead)
+  {
+    StartDma2dJob(&Dma2dQueue[Dma2dTail % LCD_DMA2D_QUEUE_SIZE]);
+  }
+  else
+  {
+    Dma2dBusy = 0;
+    if(Dma2dDoneCallback != NULL)
+    {
+      Dma2dDoneCallback();
+    }
+  }
+}
+
+/**
+  * @brief  DMA2D interrupt handler.
+  */
+static void Dma2dIRQHandler(void)
+{
+  HAL_DMA2D_IRQHandler(&Dma2dHandler);
 }
 
 /**
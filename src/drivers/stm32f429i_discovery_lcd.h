@@ -156,6 +156,35 @@ typedef enum
 #define LCD_BACKGROUND_LAYER     0x0000
 #define LCD_FOREGROUND_LAYER     0x0001
 
+/** 
+  * @brief  LCD glyph atlases: fonts pre-expanded to A8 or A4 alpha maps so
+  *         text is drawn with DMA2D blending instead of per-pixel stores
+  */
+#define LCD_GLYPH_ATLAS_MAX      5
+#define LCD_GLYPH_FIRST          ' '
+#define LCD_GLYPH_LAST           '~'
+#define LCD_GLYPH_COUNT          (LCD_GLYPH_LAST - LCD_GLYPH_FIRST + 1)
+/* Bytes one glyph occupies in an atlas of the given mode (CM_A8 or CM_A4) */
+#define LCD_GLYPH_SIZE(font, mode) \
+  ((mode) == CM_A4 ? ((font)->Width * (font)->Height + 1) / 2 : (font)->Width * (font)->Height)
+#define LCD_GLYPH_ATLAS_SIZE(font, mode)  (LCD_GLYPH_COUNT * LCD_GLYPH_SIZE(font, mode))
+
+/** 
+  * @brief  LCD double buffering: how the new back buffer is brought up to
+  *         date after a flip
+  */
+#define LCD_SYNC_FULL            0x00   /* copy the whole frame */
+#define LCD_SYNC_DAMAGE          0x01   /* copy only the rectangles drawn since the last flip */
+#define LCD_DAMAGE_RECT_MAX      4      /* disjoint rectangles tracked before they are merged */
+#define LCD_FLIP_TIMEOUT         50     /* ms to wait for vertical blanking */
+
+/** 
+  * @brief  LCD DMA2D job queue
+  */
+#define LCD_DMA2D_QUEUE_SIZE     8      /* jobs in flight before submitters wait */
+#define LCD_DMA2D_TIMEOUT        100    /* ms before a stuck queue is dropped */
+#define LCD_DMA2D_IRQ_PRIORITY   0x0E
+
 /**
   * @}
   */ 
@@ -187,6 +216,8 @@ uint32_t BSP_LCD_GetYSize(void);
 
 /* functions using the LTDC controller */
 void     BSP_LCD_LayerDefaultInit(uint16_t LayerIndex, uint32_t FrameBuffer);
+void     BSP_LCD_LayerRgb565Init(uint16_t LayerIndex, uint32_t FrameBuffer);
+void     BSP_LCD_LayerWindowInit(uint16_t LayerIndex, uint32_t FrameBuffer, uint32_t PixelFormat, uint16_t Ypos, uint16_t Height);
 void     BSP_LCD_SetTransparency(uint32_t LayerIndex, uint8_t Transparency);
 void     BSP_LCD_SetTransparency_NoReload(uint32_t LayerIndex, uint8_t Transparency);
 void     BSP_LCD_SetLayerAddress(uint32_t LayerIndex, uint32_t Address);
@@ -201,6 +232,12 @@ void     BSP_LCD_SelectLayer(uint32_t LayerIndex);
 void     BSP_LCD_SetLayerVisible(uint32_t LayerIndex, FunctionalState state);
 void     BSP_LCD_SetLayerVisible_NoReload(uint32_t LayerIndex, FunctionalState State);
 void     BSP_LCD_Relaod(uint32_t ReloadType);
+uint8_t  BSP_LCD_DoubleBufferInit(uint32_t LayerIndex, uint32_t BackAddress, uint32_t SyncMode);
+uint8_t  BSP_LCD_SwapBuffers(uint32_t LayerIndex);
+void     BSP_LCD_SetDma2dAsync(FunctionalState State);
+void     BSP_LCD_SetDma2dCallback(void (*Callback)(void));
+uint8_t  BSP_LCD_Dma2dBusy(void);
+uint8_t  BSP_LCD_WaitForDma2d(uint32_t Timeout);
 
 void     BSP_LCD_SetTextColor(uint32_t Color);
 void     BSP_LCD_SetBackColor(uint32_t Color);
@@ -216,6 +253,7 @@ void     BSP_LCD_ClearStringLine(uint32_t Line);
 void     BSP_LCD_DisplayStringAtLine(uint16_t Line, uint8_t *ptr);
 void     BSP_LCD_DisplayStringAt(uint16_t X, uint16_t Y, uint8_t *pText, Text_AlignModeTypdef mode);
 void     BSP_LCD_DisplayChar(uint16_t Xpos, uint16_t Ypos, uint8_t Ascii);
+uint8_t  BSP_LCD_GlyphAtlasInit(sFONT *pFont, uint32_t Address, uint32_t ColorMode);
 
 void     BSP_LCD_DrawHLine(uint16_t Xpos, uint16_t Ypos, uint16_t Length);
 void     BSP_LCD_DrawVLine(uint16_t Xpos, uint16_t Ypos, uint16_t Length);
@@ -234,6 +272,8 @@ void     BSP_LCD_FillEllipse(int Xpos, int Ypos, int XRadius, int YRadius);
 
 void     BSP_LCD_DisplayOff(void);
 void     BSP_LCD_DisplayOn(void);
+uint8_t  BSP_LCD_Sleep(void);
+void     BSP_LCD_Wake(void);
 
 /* This function can be modified in case the current settings need to be changed 
    for specific application needs */
@@ -85,6 +85,7 @@ static uint16_t          TsXBoundary, TsYBoundary;
 /** @defgroup STM32F429I_DISCOVERY_TS_Private_Function_Prototypes STM32F429I DISCOVERY TS Private Function Prototypes
   * @{
   */
+static void TS_CorrectXY(uint16_t x, uint16_t y, TS_StateTypeDef* TsState);
 /**
   * @}
   */
@@ -155,75 +156,160 @@ uint8_t BSP_TS_ITGetStatus(void)
   */
 void BSP_TS_GetState(TS_StateTypeDef* TsState)
 {
-  static uint32_t _x = 0, _y = 0;
-  uint16_t xDiff, yDiff , x , y, xr, yr;
+  uint16_t x, y;
   
   TsState->TouchDetected = TsDrv->DetectTouch(TS_I2C_ADDRESS);
   
   if(TsState->TouchDetected)
   {
     TsDrv->GetXY(TS_I2C_ADDRESS, &x, &y);
+    TS_CorrectXY(x, y, TsState);
+  }
+}
+
+/**
+  * @brief  Configures the touch screen interrupts for event driven reading:
+  *         only the touch detect and FIFO threshold sources are enabled, so
+  *         the INT line stays quiet while the panel is not touched.
+  * @note   The INT pin (PA15) itself is left to the caller, e.g. an mbed
+  *         InterruptIn on the falling edge.
+  * @param  Threshold: number of samples in the FIFO that raises an interrupt
+  * @retval TS_OK: if ITconfig is OK. Other value if error.
+  */
+uint8_t BSP_TS_ITConfigFifo(uint8_t Threshold)
+{
+  if((Threshold == 0) || (Threshold > TS_FIFO_BURST_MAX))
+  {
+    return TS_ERROR;
+  }
+  
+  /* Disable all sources while reconfiguring */
+  IOE_Write(TS_I2C_ADDRESS, STMPE811_REG_INT_EN, 0x00);
+  IOE_Write(TS_I2C_ADDRESS, STMPE811_REG_FIFO_TH, Threshold);
+  
+  /* Empty the FIFO and drop any pending status */
+  IOE_Write(TS_I2C_ADDRESS, STMPE811_REG_FIFO_STA, 0x01);
+  IOE_Write(TS_I2C_ADDRESS, STMPE811_REG_FIFO_STA, 0x00);
+  IOE_Write(TS_I2C_ADDRESS, STMPE811_REG_INT_STA, STMPE811_ALL_GIT);
+  
+  /* Level interrupt, active low, global enable */
+  IOE_Write(TS_I2C_ADDRESS, STMPE811_REG_INT_CTRL, STMPE811_GIT_EN);
+  IOE_Write(TS_I2C_ADDRESS, STMPE811_REG_INT_EN, STMPE811_GIT_TOUCH | STMPE811_GIT_FTH);
+  
+  return TS_OK;
+}
+
+/**
+  * @brief  Drains the touch FIFO in a single I2C burst and returns the
+  *         newest position. Samples beyond TS_FIFO_BURST_MAX are discarded.
+  * @param  TsState: Pointer to touch screen current state structure
+  * @retval Number of samples read from the FIFO.
+  */
+uint8_t BSP_TS_ReadFifo(TS_StateTypeDef* TsState)
+{
+  uint8_t  data[TS_FIFO_BURST_MAX * 4];
+  uint8_t  count;
+  uint8_t  *last;
+  uint32_t value;
+  
+  count = IOE_Read(TS_I2C_ADDRESS, STMPE811_REG_FIFO_SIZE);
+  if(count > TS_FIFO_BURST_MAX)
+  {
+    count = TS_FIFO_BURST_MAX;
+  }
+  
+  if(count > 0)
+  {
+    /* The non incrementing data register streams the FIFO, 4 bytes per
+       sample: 12-bit X, 12-bit Y, 8-bit Z */
+    IOE_ReadMultiple(TS_I2C_ADDRESS, STMPE811_REG_TSC_DATA_NON_INC, data, count * 4);
     
-    /* Y value first correction */
-    y -= 360;  
-    
-    /* Y value second correction */
-    yr = y / 11;
-    
-    /* Return y position value */
-    if(yr <= 0)
-    {
-      yr = 0;
-    }
-    else if (yr > TsYBoundary)
-    {
-      yr = TsYBoundary - 1;
-    }
-    else
-    {}
-    y = yr;
-    
-    /* X value first correction */
-    if(x <= 3000)
-    {
-      x = 3870 - x;
-    }
-    else
-    {
-      x = 3800 - x;
-    }
-    
-    /* X value second correction */  
-    xr = x / 15;
-    
-    /* Return X position value */
-    if(xr <= 0)
-    {
-      xr = 0;
-    }
-    else if (xr > TsXBoundary)
-    {
-      xr = TsXBoundary - 1;
-    }
-    else 
-    {}
-    
-    x = xr;
-    xDiff = x > _x? (x - _x): (_x - x);
-    yDiff = y > _y? (y - _y): (_y - y); 
-    
-    if (xDiff + yDiff > 5)
-    {
-      _x = x;
-      _y = y; 
-    }
-    
-    /* Update the X position */
-    TsState->X = _x;
-    
-    /* Update the Y position */  
-    TsState->Y = _y;
+    last  = &data[(count - 1) * 4];
+    value = ((uint32_t)last[0] << 24) | ((uint32_t)last[1] << 16) | ((uint32_t)last[2] << 8) | last[3];
+    TS_CorrectXY((value >> 20) & 0x00000FFF, (value >> 8) & 0x00000FFF, TsState);
+    TsState->Z = value & 0xFF;
   }
+  
+  /* Reset the FIFO so stale samples never reach the next read */
+  IOE_Write(TS_I2C_ADDRESS, STMPE811_REG_FIFO_STA, 0x01);
+  IOE_Write(TS_I2C_ADDRESS, STMPE811_REG_FIFO_STA, 0x00);
+  
+  TsState->TouchDetected = (count > 0);
+  
+  return count;
+}
+
+/**
+  * @brief  Converts raw STMPE811 coordinates to screen coordinates and applies
+  *         the jitter filter.
+  * @param  x: raw X value
+  * @param  y: raw Y value
+  * @param  TsState: Pointer to touch screen current state structure
+  */
+static void TS_CorrectXY(uint16_t x, uint16_t y, TS_StateTypeDef* TsState)
+{
+  static uint32_t _x = 0, _y = 0;
+  uint16_t xDiff, yDiff, xr, yr;
+  
+  /* Y value first correction */
+  y -= 360;  
+  
+  /* Y value second correction */
+  yr = y / 11;
+  
+  /* Return y position value */
+  if(yr <= 0)
+  {
+    yr = 0;
+  }
+  else if (yr > TsYBoundary)
+  {
+    yr = TsYBoundary - 1;
+  }
+  else
+  {}
+  y = yr;
+  
+  /* X value first correction */
+  if(x <= 3000)
+  {
+    x = 3870 - x;
+  }
+  else
+  {
+    x = 3800 - x;
+  }
+  
+  /* X value second correction */  
+  xr = x / 15;
+  
+  /* Return X position value */
+  if(xr <= 0)
+  {
+    xr = 0;
+  }
+  else if (xr > TsXBoundary)
+  {
+    xr = TsXBoundary - 1;
+  }
+  else 
+  {}
+  
+  x = xr;
+  xDiff = x > _x? (x - _x): (_x - x);
+  yDiff = y > _y? (y - _y): (_y - y); 
+  
+  if (xDiff + yDiff > 5)
+  {
+    _x = x;
+    _y = y; 
+  }
+  
+  /* Update the X position */
+  TsState->X = _x;
+  
+  /* Update the Y position */  
+  TsState->Y = _y;
 }
 
 /**
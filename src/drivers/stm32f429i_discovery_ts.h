@@ -81,6 +81,9 @@ typedef struct
 #define TS_SWAP_Y                       0x02
 #define TS_SWAP_XY                      0x04
 
+/* Largest number of samples drained from the touch FIFO in one burst */
+#define TS_FIFO_BURST_MAX               32
+
 typedef enum 
 {
   TS_OK       = 0x00,
@@ -106,6 +109,8 @@ void    BSP_TS_GetState(TS_StateTypeDef *TsState);
 uint8_t BSP_TS_ITConfig(void);
 uint8_t BSP_TS_ITGetStatus(void);
 void    BSP_TS_ITClear(void);
+uint8_t BSP_TS_ITConfigFifo(uint8_t Threshold);
+uint8_t BSP_TS_ReadFifo(TS_StateTypeDef *TsState);
 
 /**
   * @}
@@ -0,0 +1,134 @@
+/**
+ * @file dsp_backend.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Optional CMSIS-DSP implementations of the gesture kernels for the
+ * embedded sentry project.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "dsp_backend.h"
+#include "utilities.h"
+
+#if GESTURE_USE_CMSIS_DSP
+#include "arm_math.h"
+
+// Structure-of-arrays scratch for one axis pair; CMSIS kernels need
+// contiguous operands. Static so the kernel never touches the heap.
+static float axis_a[GESTURE_BUFFER_CAPACITY];
+static float axis_b[GESTURE_BUFFER_CAPACITY];
+
+/*******************************************************************************
+ *
+ * @brief Per-axis correlation using arm_mean_f32 / arm_dot_prod_f32
+ * @param vec1: the first gesture
+ * @param vec2: the second gesture
+ * @param n: number of leading samples of each gesture to correlate
+ * @return per-axis correlation [x, y, z] in [-1, 1], NaN without variation
+ *
+ * ****************************************************************************/
+array<float, 3> correlationCmsis(const GestureBuffer &vec1,
+                                 const GestureBuffer &vec2, size_t n) {
+  array<float, 3> result;
+
+  for (int axis = 0; axis < 3; axis++) {
+    for (size_t j = 0; j < n; ++j) {
+      axis_a[j] = vec1[j][axis];
+      axis_b[j] = vec2[j][axis];
+    }
+
+    // Center both axes, then three dot products give the co-moment and
+    // both second moments
+    float32_t mean_a = 0.0f, mean_b = 0.0f;
+    if (n > 0) {
+      arm_mean_f32(axis_a, n, &mean_a);
+      arm_mean_f32(axis_b, n, &mean_b);
+    }
+    arm_offset_f32(axis_a, -mean_a, axis_a, n);
+    arm_offset_f32(axis_b, -mean_b, axis_b, n);
+
+    float32_t c_ab = 0.0f, m2_a = 0.0f, m2_b = 0.0f;
+    arm_dot_prod_f32(axis_a, axis_b, n, &c_ab);
+    arm_dot_prod_f32(axis_a, axis_a, n, &m2_a);
+    arm_dot_prod_f32(axis_b, axis_b, n, &m2_b);
+
+    float32_t denominator = 0.0f;
+    arm_sqrt_f32(m2_a * m2_b, &denominator);
+    result[axis] = (denominator > 0.0f)
+                       ? c_ab / denominator
+                       : std::numeric_limits<float>::quiet_NaN();
+  }
+
+  return result;
+}
+
+/*******************************************************************************
+ *
+ * @brief Unit-magnitude scaling using arm_sqrt_f32 and one reciprocal per sample
+ * @param data: the gyro data to normalize in place
+ *
+ * ****************************************************************************/
+void normalizeCmsis(GestureBuffer &data) {
+  for (auto &point : data) {
+    float32_t magnitude = 0.0f;
+    arm_sqrt_f32(point[0] * point[0] + point[1] * point[1] + point[2] * point[2],
+                 &magnitude);
+    if (magnitude > 0) {
+      arm_scale_f32(point.data(), 1.0f / magnitude, point.data(), 3);
+    }
+  }
+}
+
+static float max_abs_diff(float a, float b) {
+  if (std::isnan(a) && std::isnan(b)) return 0.0f;
+  if (std::isnan(a) || std::isnan(b)) return std::numeric_limits<float>::infinity();
+  return fabsf(a - b);
+}
+#endif  // GESTURE_USE_CMSIS_DSP
+
+/*******************************************************************************
+ *
+ * @brief Run the selected backend and the scalar reference on the same input
+ * @param vec1: the first gesture (not modified)
+ * @param vec2: the second gesture (not modified)
+ * @return deviation of the backend from the reference
+ *
+ * ****************************************************************************/
+Dsp_Backend_Error compareDspBackend(const GestureBuffer &vec1,
+                                    const GestureBuffer &vec2) {
+  Dsp_Backend_Error error = {0.0f, 0.0f};
+
+#if GESTURE_USE_CMSIS_DSP
+  static GestureBuffer backend, reference;
+
+  size_t n = std::min(vec1.size(), vec2.size());
+  array<float, 3> r_backend = correlationCmsis(vec1, vec2, n);
+  array<float, 3> r_reference = correlationReference(vec1, vec2, n);
+  for (int axis = 0; axis < 3; axis++) {
+    error.correlation_error = std::max(
+        error.correlation_error, max_abs_diff(r_backend[axis], r_reference[axis]));
+  }
+
+  backend.copy_from(vec1);
+  reference.copy_from(vec1);
+  normalizeCmsis(backend);
+  normalizeReference(reference);
+  for (size_t j = 0; j < backend.size(); ++j) {
+    for (int axis = 0; axis < 3; axis++) {
+      error.normalize_error = std::max(
+          error.normalize_error, max_abs_diff(backend[j][axis], reference[j][axis]));
+    }
+  }
+#else
+  (void)vec1;
+  (void)vec2;
+#endif
+
+  return error;
+}
@@ -0,0 +1,56 @@
+/**
+ * @file dsp_backend.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Optional CMSIS-DSP implementations of the gesture kernels for the
+ * embedded sentry project.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef DSP_BACKEND_H
+#define DSP_BACKEND_H
+
+#include "gesture_buffer.h"
+#include "system_config.h"
+
+// Largest deviation of the selected backend from the scalar reference
+typedef struct {
+  float correlation_error;  // max |r_backend - r_reference| over the three axes
+  float normalize_error;    // max |backend - reference| over all normalized values
+} Dsp_Backend_Error;
+
+#if GESTURE_USE_CMSIS_DSP
+/**
+ * @brief Per-axis correlation using arm_mean_f32 / arm_dot_prod_f32
+ * @param vec1: the first gesture
+ * @param vec2: the second gesture
+ * @param n: number of leading samples of each gesture to correlate
+ * @return per-axis correlation [x, y, z] in [-1, 1], NaN without variation
+ */
+array<float, 3> correlationCmsis(const GestureBuffer &vec1,
+                                 const GestureBuffer &vec2, size_t n);
+
+/**
+ * @brief Unit-magnitude scaling using arm_sqrt_f32 and one reciprocal per sample
+ * @param data: the gyro data to normalize in place
+ */
+void normalizeCmsis(GestureBuffer &data);
+#endif
+
+/**
+ * @brief Run the selected backend and the scalar reference on the same input
+ * @param vec1: the first gesture (not modified)
+ * @param vec2: the second gesture (not modified)
+ * @return deviation of the backend from the reference; all zero when the
+ * reference itself is selected
+ */
+Dsp_Backend_Error compareDspBackend(const GestureBuffer &vec1,
+                                    const GestureBuffer &vec2);
+
+#endif  // DSP_BACKEND_H
@@ -0,0 +1,84 @@
+/**
+ * @file dtw.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Banded dynamic time warping kernel shared by the float and
+ * fixed-point gesture pipelines in the embedded sentry project.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef DTW_H
+#define DTW_H
+
+#include <cstddef>
+
+#include "system_config.h"
+
+/**
+ * @brief Accumulated DTW cost between two series of length n and m inside a
+ * Sakoe-Chiba band of +/- band samples around the (length-scaled) diagonal.
+ * Only two band-wide rows are kept, so memory is O(DTW_MAX_BAND). After each
+ * row the cheapest cell is a lower bound on the final cost; once it exceeds
+ * abandon_above the remaining rows are skipped.
+ * @param n: length of the first series (rows)
+ * @param m: length of the second series (columns)
+ * @param band: half-width of the warping band, clamped to DTW_MAX_BAND
+ * @param abandon_above: accumulated cost at which the match is abandoned
+ * @param infinity: value returned for abandoned or unreachable matches
+ * @param cost: cost(i, j), local distance between sample i and sample j
+ * @return accumulated cost of the best warping path, or infinity
+ */
+template <typename Acc, typename CostFn>
+Acc dtwBanded(size_t n, size_t m, size_t band, Acc abandon_above, Acc infinity, CostFn cost) {
+  if (n == 0 || m == 0) return infinity;
+  if (band > DTW_MAX_BAND) band = DTW_MAX_BAND;
+
+  const size_t width = 2 * DTW_MAX_BAND + 1;
+  Acc rows[2][width];
+  size_t lo[2] = {0, 0}, hi[2] = {0, 0};  // column range held by each row
+  int cur = 0;
+
+  for (size_t i = 0; i < n; i++) {
+    // Band centre follows the diagonal from (0, 0) to (n - 1, m - 1)
+    size_t centre = n > 1 ? (i * (m - 1) + (n - 1) / 2) / (n - 1) : 0;
+    lo[cur] = centre > band ? centre - band : 0;
+    hi[cur] = centre + band < m - 1 ? centre + band : m - 1;
+
+    int prev = cur ^ 1;
+    Acc row_min = infinity;
+    for (size_t j = lo[cur]; j <= hi[cur]; j++) {
+      Acc best;
+      if (i == 0) {
+        // First row: only horizontal steps from (0, 0)
+        best = j == 0 ? Acc(0) : (j > lo[cur] ? rows[cur][j - 1 - lo[cur]] : infinity);
+      } else {
+        best = infinity;
+        if (j >= lo[prev] && j <= hi[prev] && rows[prev][j - lo[prev]] < best)
+          best = rows[prev][j - lo[prev]];  // vertical
+        if (j >= 1 && j - 1 >= lo[prev] && j - 1 <= hi[prev] && rows[prev][j - 1 - lo[prev]] < best)
+          best = rows[prev][j - 1 - lo[prev]];  // diagonal
+        if (j > lo[cur] && rows[cur][j - 1 - lo[cur]] < best)
+          best = rows[cur][j - 1 - lo[cur]];  // horizontal
+      }
+
+      Acc value = best < infinity ? best + cost(i, j) : infinity;
+      rows[cur][j - lo[cur]] = value;
+      if (value < row_min) row_min = value;
+    }
+
+    // Every path to the end passes through this row, and costs only grow
+    if (!(row_min <= abandon_above)) return infinity;
+    cur ^= 1;
+  }
+
+  int last = cur ^ 1;
+  return hi[last] == m - 1 ? rows[last][m - 1 - lo[last]] : infinity;
+}
+
+#endif  // DTW_H
@@ -0,0 +1,316 @@
+/**
+ * @file filters.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Header-only 3-axis filter stages (moving average, EMA, biquad,
+ * median) and a compile-time filter chain for the embedded sentry project.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef FILTERS_H
+#define FILTERS_H
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// Every stage filters the three axes of one sample per update(). T is float
+// (degrees per second) or int16_t (Q15 or raw counts); integer stages keep a
+// wider accumulator and round towards minus infinity like the rest of the
+// fixed-point pipeline. All parameters that shape the loops are template
+// arguments, so a chain is inlined into its caller.
+
+constexpr bool isPowerOfTwo(size_t n) { return n != 0 && (n & (n - 1)) == 0; }
+
+constexpr unsigned log2Exact(size_t n) { return n <= 1 ? 0 : 1 + log2Exact(n >> 1); }
+
+template <typename T>
+struct FilterAccumulator {
+  typedef T type;
+};
+
+template <>
+struct FilterAccumulator<int16_t> {
+  typedef int32_t type;
+};
+
+inline int16_t saturate16(int64_t value) {
+  return value > INT16_MAX ? INT16_MAX : (value < INT16_MIN ? INT16_MIN : (int16_t)value);
+}
+
+/**
+ * @brief Moving average over the last N samples. With N a power of two the
+ * ring index wraps with a mask and the integer average is a shift; otherwise
+ * the index wraps with a compare and the average multiplies by a reciprocal.
+ * There is no divide or modulo either way.
+ */
+template <typename T, size_t N>
+class MovingAverage {
+  static_assert(N > 0, "empty moving average window");
+
+ public:
+  typedef std::array<T, 3> Sample;
+  typedef typename FilterAccumulator<T>::type Acc;
+  static constexpr size_t window = N;
+
+  MovingAverage() { reset(); }
+
+  void reset() {
+    for (size_t j = 0; j < N; j++) history_[j] = Sample{};
+    sum_ = {};
+    index_ = 0;
+  }
+
+  Sample update(const Sample &x) {
+    Sample &oldest = history_[index_];
+    if (std::is_integral<T>::value) {
+      for (int i = 0; i < 3; i++) sum_[i] += Acc(x[i]) - Acc(oldest[i]);
+    }
+    oldest = x;
+    index_ = isPowerOfTwo(N) ? (index_ + 1) & (N - 1) : (index_ + 1 == N ? 0 : index_ + 1);
+
+    if (!std::is_integral<T>::value) {
+      // Float sums are taken again instead of updated: a running sum keeps a
+      // rounding residue after the motion stops, and trim_gyro_data() needs
+      // exact zeros. N is a constant, so this unrolls.
+      for (int i = 0; i < 3; i++) {
+        Acc sum = 0;
+        for (size_t j = 0; j < N; j++) sum += history_[j][i];
+        sum_[i] = sum;
+      }
+    }
+
+    Sample out;
+    for (int i = 0; i < 3; i++) out[i] = scale(sum_[i], std::is_integral<T>());
+    return out;
+  }
+
+ private:
+  static T scale(Acc sum, std::true_type) {
+    // Q15 reciprocal, rounded to nearest, so an average can be one LSB off
+    // either way; |sum| <= N * 32768 keeps the product inside 32 bits, and
+    // saturate16() clamps a full-scale input that rounds past the range.
+    const Acc reciprocal = (32768 + N / 2) / N;
+    return isPowerOfTwo(N) ? T(sum >> log2Exact(N)) : saturate16((sum * reciprocal) >> 15);
+  }
+
+  static T scale(Acc sum, std::false_type) { return sum * (Acc(1) / Acc(N)); }
+
+  Sample history_[N];  // ring of the last N samples, oldest at index_
+  std::array<Acc, 3> sum_;
+  size_t index_;
+};
+
+/**
+ * @brief Exponential moving average with a smoothing factor of 2^-Shift:
+ * y += (x - y) / 2^Shift. The integer form keeps y with Shift extra
+ * fraction bits, so small steps are not lost to the shift.
+ */
+template <typename T, unsigned Shift>
+class Ema {
+  static_assert(Shift > 0 && Shift < 16, "EMA shift out of range");
+
+ public:
+  typedef std::array<T, 3> Sample;
+  typedef typename FilterAccumulator<T>::type Acc;
+
+  Ema() { reset(); }
+
+  void reset() { state_ = {}; }
+
+  Sample update(const Sample &x) {
+    Sample out;
+    for (int i = 0; i < 3; i++) out[i] = step(state_[i], x[i], std::is_integral<T>());
+    return out;
+  }
+
+ private:
+  static T step(Acc &state, T x, std::true_type) {
+    state += Acc(x) - (state >> Shift);
+    return T(state >> Shift);
+  }
+
+  static T step(Acc &state, T x, std::false_type) {
+    state += (x - state) * (Acc(1) / Acc(1u << Shift));
+    return state;
+  }
+
+  std::array<Acc, 3> state_;  // y, scaled by 2^Shift for integers
+};
+
+// Normalized biquad coefficients, a0 = 1
+typedef struct {
+  float b0, b1, b2;
+  float a1, a2;
+} Biquad_Coefficients;
+
+/**
+ * @brief Second-order Butterworth low-pass (RBJ cookbook, Q = 1/sqrt(2)),
+ * for use as the Design of a Biquad stage
+ */
+template <unsigned CutoffHz, unsigned RateHz>
+struct ButterworthLowpass {
+  static_assert(2 * CutoffHz < RateHz, "cutoff at or above Nyquist");
+
+  static Biquad_Coefficients coefficients() {
+    const float w0 = 2.0f * 3.14159265f * CutoffHz / RateHz;
+    const float alpha = sinf(w0) * 0.70710678f;  // sin(w0) / (2 Q)
+    const float c = cosf(w0);
+    const float a0 = 1.0f + alpha;
+    return {(1.0f - c) / 2.0f / a0, (1.0f - c) / a0, (1.0f - c) / 2.0f / a0, -2.0f * c / a0,
+            (1.0f - alpha) / a0};
+  }
+};
+
+/**
+ * @brief Direct form I biquad; Design::coefficients() supplies the taps.
+ * The integer form uses Q14 coefficients (|a1| may reach 2), a 64-bit
+ * accumulator and saturates the output.
+ */
+template <typename T, typename Design>
+class Biquad {
+ public:
+  typedef std::array<T, 3> Sample;
+  typedef typename std::conditional<std::is_integral<T>::value, int32_t, float>::type Coeff;
+
+  Biquad() {
+    Biquad_Coefficients c = Design::coefficients();
+    b_[0] = quantize(c.b0);
+    b_[1] = quantize(c.b1);
+    b_[2] = quantize(c.b2);
+    a_[0] = quantize(c.a1);
+    a_[1] = quantize(c.a2);
+    reset();
+  }
+
+  void reset() {
+    for (int i = 0; i < 3; i++) x1_[i] = x2_[i] = y1_[i] = y2_[i] = error_[i] = 0;
+  }
+
+  Sample update(const Sample &x) {
+    Sample out;
+    for (int i = 0; i < 3; i++) {
+      out[i] = step(i, x[i], std::is_integral<T>());
+      x2_[i] = x1_[i];
+      x1_[i] = x[i];
+      y2_[i] = y1_[i];
+      y1_[i] = out[i];
+    }
+    return out;
+  }
+
+ private:
+  static Coeff quantize(float c) {
+    return std::is_integral<T>::value ? Coeff(lroundf(c * 16384.0f)) : Coeff(c);
+  }
+
+  T step(int i, T x, std::true_type) {
+    // The bits shifted out are carried into the next output (error
+    // feedback); plain truncation or rounding leaves a few LSB limit cycle
+    // on a still input
+    int64_t acc = (int64_t)b_[0] * x + (int64_t)b_[1] * x1_[i] + (int64_t)b_[2] * x2_[i] -
+                  (int64_t)a_[0] * y1_[i] - (int64_t)a_[1] * y2_[i] + error_[i];
+    error_[i] = (int32_t)(acc & ((1 << 14) - 1));
+    return saturate16(acc >> 14);
+  }
+
+  T step(int i, T x, std::false_type) {
+    return b_[0] * x + b_[1] * x1_[i] + b_[2] * x2_[i] - a_[0] * y1_[i] - a_[1] * y2_[i];
+  }
+
+  Coeff b_[3], a_[2];
+  T x1_[3], x2_[3], y1_[3], y2_[3];
+  int32_t error_[3];  // fraction bits of the last integer output
+};
+
+/**
+ * @brief Median of the last N samples per axis (N odd). Removes single
+ * sample spikes without smearing edges; N is meant to be small (3 or 5).
+ */
+template <typename T, size_t N>
+class Median {
+  static_assert(N % 2 == 1, "median window must be odd");
+
+ public:
+  typedef std::array<T, 3> Sample;
+
+  Median() { reset(); }
+
+  void reset() {
+    for (size_t j = 0; j < N; j++) history_[j] = Sample{};
+    index_ = 0;
+  }
+
+  Sample update(const Sample &x) {
+    history_[index_] = x;
+    index_ = index_ + 1 == N ? 0 : index_ + 1;
+
+    Sample out;
+    for (int i = 0; i < 3; i++) {
+      // Insertion sort of a copy, N is tiny
+      T sorted[N];
+      for (size_t j = 0; j < N; j++) {
+        T v = history_[j][i];
+        size_t k = j;
+        while (k > 0 && sorted[k - 1] > v) {
+          sorted[k] = sorted[k - 1];
+          k--;
+        }
+        sorted[k] = v;
+      }
+      out[i] = sorted[N / 2];
+    }
+    return out;
+  }
+
+ private:
+  Sample history_[N];
+  size_t index_;
+};
+
+/**
+ * @brief Stages applied in order, composed at compile time:
+ *   FilterChain<Median<float, 3>, MovingAverage<float, 4>> chain;
+ *   sample = chain.update(sample);
+ * All stages must share the same sample type.
+ */
+template <typename... Stages>
+class FilterChain;
+
+template <>
+class FilterChain<> {
+ public:
+  void reset() {}
+
+  template <typename Sample>
+  Sample update(const Sample &x) {
+    return x;
+  }
+};
+
+template <typename First, typename... Rest>
+class FilterChain<First, Rest...> {
+ public:
+  typedef typename First::Sample Sample;
+
+  void reset() {
+    first_.reset();
+    rest_.reset();
+  }
+
+  Sample update(const Sample &x) { return rest_.update(first_.update(x)); }
+
+ private:
+  First first_;
+  FilterChain<Rest...> rest_;
+};
+
+#endif  // FILTERS_H
@@ -0,0 +1,266 @@
+/**
+ * @file fixed_point.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Fixed-point (Q15 data, 64-bit accumulated) gesture pipeline for the
+ * embedded sentry project.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <cstring>
+#include "fixed_point.h"
+#include "dtw.h"
+
+#if defined(__ARM_FEATURE_DSP) && __ARM_FEATURE_DSP
+#include "cmsis_compiler.h"  // __SMLALD, __SADD16
+#define FIXED_POINT_USE_SIMD 1
+#else
+#define FIXED_POINT_USE_SIMD 0
+#endif
+
+/*******************************************************************************
+ *
+ * @brief Bitwise integer square root, floor(sqrt(value))
+ *
+ * ****************************************************************************/
+uint32_t isqrt32(uint32_t value) {
+  uint32_t result = 0;
+  uint32_t bit = 1UL << 30;
+  while (bit > value) bit >>= 2;
+  while (bit != 0) {
+    if (value >= result + bit) {
+      value -= result + bit;
+      result = (result >> 1) + bit;
+    } else {
+      result >>= 1;
+    }
+    bit >>= 2;
+  }
+  return result;
+}
+
+uint32_t isqrt64(uint64_t value) {
+  uint64_t result = 0;
+  uint64_t bit = 1ULL << 62;
+  while (bit > value) bit >>= 2;
+  while (bit != 0) {
+    if (value >= result + bit) {
+      value -= result + bit;
+      result = (result >> 1) + bit;
+    } else {
+      result >>= 1;
+    }
+    bit >>= 2;
+  }
+  return (uint32_t)result;
+}
+
+// Correlation from the five raw sums of n sample pairs
+static q15_t correlationFromSums(size_t n, int32_t sum_a, int32_t sum_b, int64_t sum_ab,
+                                 int64_t sq_sum_a, int64_t sq_sum_b) {
+  int64_t count = (int64_t)n;
+  int64_t numerator = count * sum_ab - (int64_t)sum_a * sum_b;
+  int64_t var_a = count * sq_sum_a - (int64_t)sum_a * sum_a;
+  int64_t var_b = count * sq_sum_b - (int64_t)sum_b * sum_b;
+  if (n == 0 || var_a <= 0 || var_b <= 0) {
+    return 0;
+  }
+
+  // For long series numerator << 15 no longer fits in 64 bits; give up
+  // fraction bits one at a time, halving the denominator to match
+  int64_t denominator = (int64_t)isqrt64(var_a) * isqrt64(var_b);
+  int shift = 15;
+  while (denominator > 0 && (numerator > (INT64_MAX >> shift) || numerator < -(INT64_MAX >> shift))) {
+    denominator >>= 1;
+    shift--;
+  }
+  if (denominator == 0) return 0;
+
+  int64_t r = (numerator * ((int64_t)1 << shift)) / denominator;
+  if (r > Q15_ONE) r = Q15_ONE;
+  if (r < -Q15_ONE) r = -Q15_ONE;
+  return (q15_t)r;
+}
+
+/*******************************************************************************
+ *
+ * @brief Pearson correlation of two Q15 series with 64-bit accumulators
+ * @param a: the first series
+ * @param b: the second series
+ * @param n: number of elements in each series
+ * @return correlation in Q15, 0 if either series has no variation
+ *
+ * Integer sums are exact, so the one-pass raw-sum formula has none of the
+ * cancellation problems it has in float.
+ *
+ * ****************************************************************************/
+q15_t correlationQ15(const q15_t *a, const q15_t *b, size_t n) {
+  int32_t sum_a = 0, sum_b = 0;
+  int64_t sum_ab = 0, sq_sum_a = 0, sq_sum_b = 0;
+  size_t i = 0;
+
+#if FIXED_POINT_USE_SIMD
+  // Two samples per step: SMLALD multiplies both halfword pairs and adds
+  // them into a 64-bit accumulator
+  for (; i + 1 < n; i += 2) {
+    uint32_t pa, pb;
+    memcpy(&pa, a + i, sizeof(pa));
+    memcpy(&pb, b + i, sizeof(pb));
+    sum_ab = __SMLALD(pa, pb, sum_ab);
+    sq_sum_a = __SMLALD(pa, pa, sq_sum_a);
+    sq_sum_b = __SMLALD(pb, pb, sq_sum_b);
+    sum_a += a[i] + a[i + 1];
+    sum_b += b[i] + b[i + 1];
+  }
+#endif
+  for (; i < n; i++) {
+    sum_a += a[i];
+    sum_b += b[i];
+    sum_ab += (int32_t)a[i] * b[i];
+    sq_sum_a += (int32_t)a[i] * a[i];
+    sq_sum_b += (int32_t)b[i] * b[i];
+  }
+
+  return correlationFromSums(n, sum_a, sum_b, sum_ab, sq_sum_a, sq_sum_b);
+}
+
+/*******************************************************************************
+ *
+ * @brief Running sums of every prefix of a gesture
+ * @param samples: the gesture
+ *
+ * ****************************************************************************/
+void PrefixSumsQ15::build(const GestureBufferQ15 &samples) {
+  for (int i = 0; i < 3; i++) {
+    const q15_t *axis = samples.axis(i);
+    int32_t s = 0;
+    int64_t sq = 0;
+    for (size_t j = 0; j < samples.size(); j++) {
+      s += axis[j];
+      sq += (int32_t)axis[j] * axis[j];
+      sum[i][j] = s;
+      sq_sum[i][j] = sq;
+    }
+  }
+}
+
+/*******************************************************************************
+ *
+ * @brief Q15 correlation of one axis of two gestures from their prefix sums
+ * @param a: axis of the first gesture
+ * @param sums_a: prefix sums of the first gesture
+ * @param b: same axis of the second gesture
+ * @param sums_b: prefix sums of the second gesture
+ * @param axis: 0 = x, 1 = y, 2 = z
+ * @return correlation of the common prefix in Q15, 0 without variation
+ *
+ * Only the cross products need the samples; the loop is one dual MAC per
+ * two sample pairs.
+ *
+ * ****************************************************************************/
+q15_t correlationPrefixQ15(ConstSpan<q15_t> a, const PrefixSumsQ15 &sums_a,
+                           ConstSpan<q15_t> b, const PrefixSumsQ15 &sums_b, int axis) {
+  size_t n = std::min(a.size(), b.size());
+  if (n == 0) return 0;
+
+  int64_t sum_ab = 0;
+  size_t i = 0;
+#if FIXED_POINT_USE_SIMD
+  for (; i + 1 < n; i += 2) {
+    uint32_t pa, pb;
+    memcpy(&pa, a.data() + i, sizeof(pa));
+    memcpy(&pb, b.data() + i, sizeof(pb));
+    sum_ab = __SMLALD(pa, pb, sum_ab);
+  }
+#endif
+  for (; i < n; i++) {
+    sum_ab += (int32_t)a[i] * b[i];
+  }
+
+  return correlationFromSums(n, sums_a.sum[axis][n - 1], sums_b.sum[axis][n - 1], sum_ab,
+                             sums_a.sq_sum[axis][n - 1], sums_b.sq_sum[axis][n - 1]);
+}
+
+/*******************************************************************************
+ *
+ * @brief Q15 dynamic time warping distance between two normalized gestures
+ * @param vec1: the first gesture (Q15 unit vectors)
+ * @param vec2: the second gesture (Q15 unit vectors)
+ * @param band: Sakoe-Chiba band half-width in samples
+ * @param threshold: acceptance threshold in Q15
+ * @return mean (1 - cos) per path step in Q15, or INT32_MAX
+ *
+ * Local costs are at most 2.0 in Q15, so even a full-capacity path stays far
+ * inside an int32 accumulator.
+ *
+ * ****************************************************************************/
+int32_t dtwDistance(const GestureBufferQ15 &vec1, const GestureBufferQ15 &vec2,
+                    size_t band, int32_t threshold) {
+  const q15_t *ax = vec1.axis(0), *ay = vec1.axis(1), *az = vec1.axis(2);
+  const q15_t *bx = vec2.axis(0), *by = vec2.axis(1), *bz = vec2.axis(2);
+  int32_t steps = (int32_t)(vec1.size() + vec2.size());
+
+  int32_t total = dtwBanded<int32_t>(
+      vec1.size(), vec2.size(), band, threshold * steps, INT32_MAX,
+      [&](size_t i, size_t j) {
+        int32_t dot = (int32_t)ax[i] * bx[j] + (int32_t)ay[i] * by[j] +
+                      (int32_t)az[i] * bz[j];
+        return Q15_ONE - (dot >> 15);
+      });
+  return total == INT32_MAX ? INT32_MAX : total / steps;
+}
+
+/*******************************************************************************
+ *
+ * @brief Trim leading and trailing all-zero samples. The calibration
+ * dead-band already zeroes noise, so no threshold is needed in fixed point.
+ * @param data: the gyro data to trim
+ *
+ * ****************************************************************************/
+void trim_gyro_data(GestureBufferQ15 &data) {
+  const q15_t *x = data.axis(0);
+  const q15_t *y = data.axis(1);
+  const q15_t *z = data.axis(2);
+
+  size_t first = 0;
+  while (first < data.size() && x[first] == 0 && y[first] == 0 && z[first] == 0) {
+    first++;
+  }
+  if (first == data.size()) return;  // all data below threshold
+
+  size_t last = data.size();
+  while (last > first && x[last - 1] == 0 && y[last - 1] == 0 && z[last - 1] == 0) {
+    last--;
+  }
+
+  data.keep_range(first, last);
+}
+
+/*******************************************************************************
+ *
+ * @brief Scale every sample to a Q15 unit vector
+ * @param data: the gyro data to normalize in place
+ *
+ * ****************************************************************************/
+void normalize(GestureBufferQ15 &data) {
+  q15_t *x = data.axis(0);
+  q15_t *y = data.axis(1);
+  q15_t *z = data.axis(2);
+
+  for (size_t j = 0; j < data.size(); j++) {
+    uint32_t sq = (uint32_t)((int32_t)x[j] * x[j]) + (uint32_t)((int32_t)y[j] * y[j]) +
+                  (uint32_t)((int32_t)z[j] * z[j]);
+    int32_t magnitude = (int32_t)isqrt32(sq);
+    if (magnitude > 0) {
+      x[j] = (q15_t)(((int32_t)x[j] * Q15_ONE) / magnitude);
+      y[j] = (q15_t)(((int32_t)y[j] * Q15_ONE) / magnitude);
+      z[j] = (q15_t)(((int32_t)z[j] * Q15_ONE) / magnitude);
+    }
+  }
+}
@@ -0,0 +1,169 @@
+/**
+ * @file fixed_point.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Fixed-point (Q15 data, 64-bit accumulated) gesture pipeline for the
+ * embedded sentry project.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "gesture_buffer.h"
+#include "utilities.h"
+
+typedef int16_t q15_t;  // signed 1.15 fixed point
+typedef int32_t q31_t;  // signed 1.31 fixed point
+
+#define Q15_ONE 32767  // largest Q15 value (~1.0)
+
+// Correlation and DTW acceptance thresholds in Q15
+#define CORRELATION_THRESHOLD_Q15 ((q15_t)(CORRELATION_THRESHOLD * 32768.0f))
+#define DTW_THRESHOLD_Q15 ((int32_t)(DTW_THRESHOLD * 32768.0f))
+
+// One filtered sample: [x, y, z] raw angular rate, later unit vector in Q15
+typedef std::array<q15_t, 3> GestureSampleQ15;
+
+/**
+ * @brief Fixed-capacity gesture buffer in structure-of-arrays layout.
+ * Each axis is contiguous so the correlation kernel can feed two samples at
+ * a time to the dual 16-bit MAC instructions. 6 bytes per sample.
+ */
+class GestureBufferQ15 {
+ public:
+  GestureBufferQ15() : size_(0) {}
+
+  GestureBufferQ15(const GestureBufferQ15 &) = delete;
+  GestureBufferQ15 &operator=(const GestureBufferQ15 &) = delete;
+
+  bool push_back(const GestureSampleQ15 &sample) {
+    if (size_ >= GESTURE_BUFFER_CAPACITY) return false;
+    for (int i = 0; i < 3; i++) data_[i][size_] = sample[i];
+    size_++;
+    return true;
+  }
+
+  GestureSampleQ15 operator[](size_t j) const {
+    return {data_[0][j], data_[1][j], data_[2][j]};
+  }
+
+  void resize(size_t count) {
+    if (count > GESTURE_BUFFER_CAPACITY) count = GESTURE_BUFFER_CAPACITY;
+    for (size_t j = size_; j < count; j++) {
+      for (int i = 0; i < 3; i++) data_[i][j] = 0;
+    }
+    size_ = count;
+  }
+
+  /**
+   * @brief Keep only the samples in [first, last)
+   */
+  void keep_range(size_t first, size_t last) {
+    for (int i = 0; i < 3; i++) {
+      for (size_t j = first; j < last; j++) data_[i][j - first] = data_[i][j];
+    }
+    size_ = last - first;
+  }
+
+  void swap(GestureBufferQ15 &other) {
+    size_t live = size_ > other.size_ ? size_ : other.size_;
+    for (int i = 0; i < 3; i++) {
+      for (size_t j = 0; j < live; j++) {
+        q15_t tmp = data_[i][j];
+        data_[i][j] = other.data_[i][j];
+        other.data_[i][j] = tmp;
+      }
+    }
+    size_t tmp_size = size_;
+    size_ = other.size_;
+    other.size_ = tmp_size;
+  }
+
+  void clear() { size_ = 0; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  static constexpr size_t capacity() { return GESTURE_BUFFER_CAPACITY; }
+
+  q15_t *axis(int i) { return data_[i]; }
+  const q15_t *axis(int i) const { return data_[i]; }
+  ConstSpan<q15_t> axis_view(int i) const { return ConstSpan<q15_t>(data_[i], size_); }
+
+ private:
+  q15_t data_[3][GESTURE_BUFFER_CAPACITY];
+  size_t size_;
+};
+
+/**
+ * @brief Integer square roots
+ */
+uint32_t isqrt32(uint32_t value);
+uint32_t isqrt64(uint64_t value);
+
+/**
+ * @brief Pearson correlation of two Q15 series with 64-bit accumulators
+ * @param a: the first series
+ * @param b: the second series
+ * @param n: number of elements in each series
+ * @return correlation in Q15, 0 if either series has no variation
+ */
+q15_t correlationQ15(const q15_t *a, const q15_t *b, size_t n);
+
+/**
+ * @brief Per-axis running sums over every prefix of a gesture: sum[i][j]
+ * and sq_sum[i][j] cover samples [0, j], so the mean, variance and energy
+ * of any prefix are known without touching the samples again
+ */
+struct PrefixSumsQ15 {
+  int32_t sum[3][GESTURE_BUFFER_CAPACITY];
+  int64_t sq_sum[3][GESTURE_BUFFER_CAPACITY];
+
+  void build(const GestureBufferQ15 &samples);
+};
+
+/**
+ * @brief Q15 correlation of one axis of two gestures from their prefix sums
+ * @param a: axis of the first gesture
+ * @param sums_a: prefix sums of the first gesture
+ * @param b: same axis of the second gesture
+ * @param sums_b: prefix sums of the second gesture
+ * @param axis: 0 = x, 1 = y, 2 = z
+ * @return correlation of the common prefix in Q15, 0 without variation
+ */
+q15_t correlationPrefixQ15(ConstSpan<q15_t> a, const PrefixSumsQ15 &sums_a,
+                           ConstSpan<q15_t> b, const PrefixSumsQ15 &sums_b, int axis);
+
+/**
+ * @brief Q15 dynamic time warping distance between two normalized gestures
+ * @param vec1: the first gesture (Q15 unit vectors)
+ * @param vec2: the second gesture (Q15 unit vectors)
+ * @param band: Sakoe-Chiba band half-width in samples
+ * @param threshold: acceptance threshold in Q15
+ * @return mean (1 - cos) per path step in Q15, or INT32_MAX
+ */
+int32_t dtwDistance(const GestureBufferQ15 &vec1, const GestureBufferQ15 &vec2,
+                    size_t band, int32_t threshold);
+
+/**
+ * @brief Trim leading and trailing all-zero samples
+ * @param data: the gyro data to trim
+ */
+void trim_gyro_data(GestureBufferQ15 &data);
+
+/**
+ * @brief Scale every sample to a Q15 unit vector
+ * @param data: the gyro data to normalize in place
+ */
+void normalize(GestureBufferQ15 &data);
+
+#endif  // FIXED_POINT_H
@@ -0,0 +1,172 @@
+/**
+ * @file gesture_buffer.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Statically sized, heap-free sample buffer for gesture recordings in
+ * the embedded sentry project.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef GESTURE_BUFFER_H
+#define GESTURE_BUFFER_H
+
+#include <array>
+#include <cstddef>
+
+#include "system_config.h"
+
+/**
+ * @brief Read-only view of contiguous samples, a minimal std::span for
+ * C++14. It does not own the samples; the container must outlive it.
+ */
+template <typename T>
+class ConstSpan {
+ public:
+  typedef T value_type;
+  typedef const T *const_iterator;
+
+  ConstSpan() : data_(nullptr), size_(0) {}
+  ConstSpan(const T *data, size_t size) : data_(data), size_(size) {}
+
+  /**
+   * @brief View of the leading samples
+   * @param count: samples to keep, clamped to the size
+   */
+  ConstSpan first(size_t count) const { return ConstSpan(data_, count < size_ ? count : size_); }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  const T *data() const { return data_; }
+  const_iterator begin() const { return data_; }
+  const_iterator end() const { return data_ + size_; }
+  const T &operator[](size_t i) const { return data_[i]; }
+
+ private:
+  const T *data_;
+  size_t size_;
+};
+
+/**
+ * @brief Vector-like container with inline storage and a compile-time
+ * capacity. It never allocates; push_back() on a full buffer is refused.
+ * Copies are disabled so a recording cannot be duplicated by accident in the
+ * sampling loop; move and swap only touch the live samples.
+ */
+template <typename T, size_t Capacity>
+class FixedBuffer {
+ public:
+  typedef T value_type;
+  typedef T *iterator;
+  typedef const T *const_iterator;
+
+  FixedBuffer() : size_(0) {}
+
+  FixedBuffer(const FixedBuffer &) = delete;
+  FixedBuffer &operator=(const FixedBuffer &) = delete;
+
+  FixedBuffer(FixedBuffer &&other) : size_(0) { *this = static_cast<FixedBuffer &&>(other); }
+
+  FixedBuffer &operator=(FixedBuffer &&other) {
+    if (this != &other) {
+      for (size_t i = 0; i < other.size_; ++i) data_[i] = other.data_[i];
+      size_ = other.size_;
+      other.size_ = 0;
+    }
+    return *this;
+  }
+
+  /**
+   * @brief Exchange the contents of two buffers
+   * @param other: the buffer to swap with
+   */
+  void swap(FixedBuffer &other) {
+    size_t live = size_ > other.size_ ? size_ : other.size_;
+    for (size_t i = 0; i < live; ++i) {
+      T tmp = data_[i];
+      data_[i] = other.data_[i];
+      other.data_[i] = tmp;
+    }
+    size_t tmp_size = size_;
+    size_ = other.size_;
+    other.size_ = tmp_size;
+  }
+
+  /**
+   * @brief Explicit copy, for the rare places that really need one
+   * @param other: the buffer to copy from
+   */
+  void copy_from(const FixedBuffer &other) {
+    for (size_t i = 0; i < other.size_; ++i) data_[i] = other.data_[i];
+    size_ = other.size_;
+  }
+
+  /**
+   * @brief Append a sample
+   * @param value: the sample to append
+   * @return false if the buffer is full and the sample was dropped
+   */
+  bool push_back(const T &value) {
+    if (size_ >= Capacity) return false;
+    data_[size_++] = value;
+    return true;
+  }
+
+  /**
+   * @brief Change the number of live samples, new samples are value-initialized
+   * @param count: new size, clamped to the capacity
+   */
+  void resize(size_t count) {
+    if (count > Capacity) count = Capacity;
+    for (size_t i = size_; i < count; ++i) data_[i] = T();
+    size_ = count;
+  }
+
+  /**
+   * @brief Remove the samples in [first, last), shifting the tail down
+   * @return iterator to the sample that followed the erased range
+   */
+  iterator erase(iterator first, iterator last) {
+    iterator out = first;
+    for (iterator in = last; in != end(); ++in, ++out) *out = *in;
+    size_ = out - begin();
+    return first;
+  }
+
+  void clear() { size_ = 0; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  bool full() const { return size_ == Capacity; }
+  static constexpr size_t capacity() { return Capacity; }
+
+  T *data() { return data_; }
+  const T *data() const { return data_; }
+  iterator begin() { return data_; }
+  iterator end() { return data_ + size_; }
+  const_iterator begin() const { return data_; }
+  const_iterator end() const { return data_ + size_; }
+  T &operator[](size_t i) { return data_[i]; }
+  const T &operator[](size_t i) const { return data_[i]; }
+  T &back() { return data_[size_ - 1]; }
+  const T &back() const { return data_[size_ - 1]; }
+  ConstSpan<T> view() const { return ConstSpan<T>(data_, size_); }
+
+ private:
+  T data_[Capacity];
+  size_t size_;
+};
+
+// Samples in one recording window at the working sample rate, plus headroom
+// for timer slack at the end of the window
+constexpr size_t GESTURE_BUFFER_CAPACITY =
+    (GESTURE_RECORD_WINDOW_MS * GESTURE_SAMPLE_RATE_HZ + 999) / 1000 + GESTURE_BUFFER_MARGIN;
+
+// One recorded gesture: smoothed [x, y, z] angular rate per sample
+typedef FixedBuffer<std::array<float, 3>, GESTURE_BUFFER_CAPACITY> GestureBuffer;
+
+#endif  // GESTURE_BUFFER_H
@@ -13,21 +13,39 @@
  */
 
 #include "gyro.h"
+#include "pipeline.h"
+#include "trace.h"
 
 SPI gyroscope(PF_9, PF_8, PF_7); // mosi, miso, sclk
 DigitalOut cs(PC_1);
 
-int16_t x_threshold; // X-axis calibration threshold
-int16_t y_threshold; // Y-axis calibration threshold
-int16_t z_threshold; // Z-axis calibration threshold
+static Gyroscope_Calibration calibration; // bias and dead-band in use
+static int16_t calibrated_bias[3];        // bias at the last full calibration
+static int32_t tracked_bias[3];           // drift tracker state, Q8 counts
+static volatile bool drift_alarm = false; // tracked bias left GYRO_DRIFT_LIMIT
 
-int16_t x_sample; // X-axis zero-rate level sample
-int16_t y_sample; // Y-axis zero-rate level sample
-int16_t z_sample; // Z-axis zero-rate level sample
+#ifndef SPI_EVENT_COMPLETE
+#define SPI_EVENT_COMPLETE (1 << 3) // only provided by targets with DEVICE_SPI_ASYNCH
+#endif
 
-float sensitivity = 0.0f;
+static_assert(GYRO_SPI_FREQUENCY <= GYRO_SPI_MAX_FREQUENCY, "L3GD20 SPI clock is limited to 10 MHz");
+static_assert(!GYRO_HW_MOTION || (GYRO_USE_FIFO && GYRO_SPI_ASYNC),
+              "GYRO_HW_MOTION gates the asynchronous FIFO acquisition");
+
+// Burst buffers: one address byte followed by up to a full FIFO of samples.
+// Asynchronous reads alternate between two receive frames so the samples
+// handed to the caller are not overwritten by the next transfer.
+static char fifo_tx[1 + FIFO_DEPTH * 6];
+static char fifo_rx[2][1 + FIFO_DEPTH * 6];
+static Gyroscope_RawData fifo_frames[2][FIFO_DEPTH];
+static int fill_frame = 0;              // frame the next transfer writes into
+static size_t transfer_count = 0;       // samples in the transfer in flight
+static uint32_t transfer_start = 0;     // TraceNow() when it was started
+static volatile bool transfer_busy = false;
+static GyroReadCallback read_callback;
 
 Gyroscope_RawData *gyro_raw;
+uint8_t fifo_ctrl = FIFO_MODE_BYPASS; // FIFO mode selected at initialization
 
 // Write I/O
 void WriteByte(uint8_t address, uint8_t data)
@@ -38,53 +56,250 @@ void WriteByte(uint8_t address, uint8_t data)
     cs = 1;
 }
 
+// Unpack little-endian 6-byte frames into raw samples
+static void DecodeFrames(const char *rx, Gyroscope_RawData *samples, size_t count)
+{
+    const uint8_t *frame = reinterpret_cast<const uint8_t *>(rx);
+    for (size_t i = 0; i < count; i++, frame += 6)
+    {
+        samples[i].x_raw = frame[0] | frame[1] << 8;
+        samples[i].y_raw = frame[2] | frame[3] << 8;
+        samples[i].z_raw = frame[4] | frame[5] << 8;
+    }
+}
+
+// Prepare the transmit buffer for an auto-incremented read of count samples
+static int PrepareBurst(size_t count)
+{
+    int length = 1 + count * 6;
+    memset(fifo_tx, 0xff, length);
+    fifo_tx[0] = OUT_X_L | 0x80 | 0x40; // auto-incremented read
+    return length;
+}
+
 // Get raw data from gyroscope
 void GetGyroValue(Gyroscope_RawData *rawdata)
 {
+    TraceSpan span(TRACE_SPI_READ);
+
+    // One 7-byte transaction instead of seven single-byte writes
+    int length = PrepareBurst(1);
     cs = 0;
-    gyroscope.write(OUT_X_L | 0x80 | 0x40); // auto-incremented read
-    rawdata->x_raw = gyroscope.write(0xff) | gyroscope.write(0xff) << 8;
-    rawdata->y_raw = gyroscope.write(0xff) | gyroscope.write(0xff) << 8;
-    rawdata->z_raw = gyroscope.write(0xff) | gyroscope.write(0xff) << 8;
+    gyroscope.write(fifo_tx, length, fifo_rx[fill_frame], length);
     cs = 1;
+    DecodeFrames(fifo_rx[fill_frame] + 1, rawdata, 1);
 }
 
-// Calibrate gyroscope before recording.
-// Samples 128 readings to determine the zero-rate level (bias) and peak noise
-// threshold for each axis. Data below the threshold is treated as zero to
-// suppress ambient vibration.
+// Read a single register
+static uint8_t ReadByte(uint8_t address)
+{
+    cs = 0;
+    gyroscope.write(address | 0x80);
+    uint8_t value = gyroscope.write(0xff);
+    cs = 1;
+    return value;
+}
+
+// Follow slow bias drift on samples that sit inside the dead-band on all
+// axes. Runs for every sample, also from the SPI completion interrupt.
+static void TrackDrift(const int16_t raw[3])
+{
+    for (int i = 0; i < 3; i++)
+    {
+        if (abs(raw[i] - calibration.bias[i]) >= calibration.threshold[i])
+            return; // moving
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+        tracked_bias[i] += ((int32_t)raw[i] * 256 - tracked_bias[i]) >> GYRO_DRIFT_SHIFT;
+        calibration.bias[i] = (tracked_bias[i] + 128) >> 8;
+        if (abs(calibration.bias[i] - calibrated_bias[i]) > GYRO_DRIFT_LIMIT)
+            drift_alarm = true;
+    }
+}
+
+// Apply bias offset and noise threshold to one sample
+static void CalibrateSample(Gyroscope_RawData *rawdata)
+{
+#if GYRO_HW_MOTION
+    (void)rawdata; // the sensor's high-pass filter already removed the bias
+#else
+    int16_t raw[3] = {rawdata->x_raw, rawdata->y_raw, rawdata->z_raw};
+    TrackDrift(raw);
+
+    // Subtract the zero-rate level bias
+    rawdata->x_raw -= calibration.bias[0];
+    rawdata->y_raw -= calibration.bias[1];
+    rawdata->z_raw -= calibration.bias[2];
+
+    // Zero out readings below the noise threshold
+    if (abs(rawdata->x_raw) < calibration.threshold[0])
+        rawdata->x_raw = 0;
+    if (abs(rawdata->y_raw) < calibration.threshold[1])
+        rawdata->y_raw = 0;
+    if (abs(rawdata->z_raw) < calibration.threshold[2])
+        rawdata->z_raw = 0;
+#endif
+}
+
+// Burst-read up to max_samples uncalibrated samples from the FIFO
+static size_t ReadFifo(Gyroscope_RawData *samples, size_t max_samples)
+{
+    size_t count = min<size_t>(GetFifoLevel(), min<size_t>(max_samples, FIFO_DEPTH));
+    if (count == 0)
+        return 0;
+
+    TraceSpan span(TRACE_SPI_READ);
+    int length = PrepareBurst(count);
+    cs = 0;
+    gyroscope.write(fifo_tx, length, fifo_rx[fill_frame], length);
+    cs = 1;
+
+    DecodeFrames(fifo_rx[fill_frame] + 1, samples, count);
+    return count;
+}
+
+// Calibrate the gyroscope while it is at rest.
+// Averages GYRO_CALIBRATION_SAMPLES readings to determine the zero-rate level
+// (bias) of each axis, and takes the largest deviation from it as the noise
+// threshold. Data below the threshold is treated as zero to suppress ambient
+// vibration. With the FIFO enabled the readings are drained in bursts at the
+// full ODR; otherwise the output registers are polled once per ODR period.
 void CalibrateGyroscope(Gyroscope_RawData *rawdata)
 {
-    int16_t sumX = 0;
-    int16_t sumY = 0;
-    int16_t sumZ = 0;
-    for (int i = 0; i < 128; i++)
+    TraceSpan span(TRACE_CALIBRATION);
+    int32_t sum[3] = {0, 0, 0};
+    int16_t low[3] = {INT16_MAX, INT16_MAX, INT16_MAX};
+    int16_t high[3] = {INT16_MIN, INT16_MIN, INT16_MIN};
+    Gyroscope_RawData burst[FIFO_DEPTH];
+    int taken = 0;
+
+    if (fifo_ctrl != FIFO_MODE_BYPASS)
+        FlushFifo();
+
+    while (taken < GYRO_CALIBRATION_SAMPLES)
+    {
+        size_t count = 1;
+        if (fifo_ctrl != FIFO_MODE_BYPASS)
+        {
+            ThisThread::sleep_for(std::chrono::milliseconds(FIFO_DEPTH / 2 * 1000 / GYRO_ODR_HZ)); // let half the FIFO fill
+            count = ReadFifo(burst, min<size_t>(FIFO_DEPTH, GYRO_CALIBRATION_SAMPLES - taken));
+        }
+        else
+        {
+            wait_us(1000000 / GYRO_ODR_HZ); // next output sample
+            GetGyroValue(&burst[0]);
+        }
+
+        for (size_t n = 0; n < count; n++, taken++)
+        {
+            int16_t raw[3] = {burst[n].x_raw, burst[n].y_raw, burst[n].z_raw};
+            for (int i = 0; i < 3; i++)
+            {
+                sum[i] += raw[i];
+                low[i] = min(low[i], raw[i]);
+                high[i] = max(high[i], raw[i]);
+            }
+        }
+    }
+    *rawdata = burst[0];
+
+    for (int i = 0; i < 3; i++)
+    {
+        int16_t bias = (sum[i] + GYRO_CALIBRATION_SAMPLES / 2) / GYRO_CALIBRATION_SAMPLES;
+        calibration.bias[i] = bias;
+        calibration.threshold[i] = max(high[i] - bias, bias - low[i]) + GYRO_THRESHOLD_MARGIN;
+        calibrated_bias[i] = bias;
+        tracked_bias[i] = (int32_t)bias * 256;
+    }
+    calibration.temperature = GetGyroTemperature();
+    calibration.valid = 1;
+    drift_alarm = false;
+
+    if (fifo_ctrl != FIFO_MODE_BYPASS)
+        FlushFifo();
+}
+
+int8_t GetGyroTemperature()
+{
+    return (int8_t)ReadByte(OUT_TEMP);
+}
+
+bool GyroscopeNeedsCalibration()
+{
+#if GYRO_HW_MOTION
+    return false;
+#else
+    if (!calibration.valid || drift_alarm)
+        return true;
+    return abs(GetGyroTemperature() - calibration.temperature) > GYRO_RECAL_TEMP_DELTA;
+#endif
+}
+
+// TrackDrift() updates the bias from the SPI completion interrupt, so the
+// calibration is only copied in or out with interrupts masked
+Gyroscope_Calibration GetGyroscopeCalibration()
+{
+    core_util_critical_section_enter();
+    Gyroscope_Calibration snapshot = calibration;
+    core_util_critical_section_exit();
+    return snapshot;
+}
+
+void SetGyroscopeCalibration(const Gyroscope_Calibration &restored)
+{
+    core_util_critical_section_enter();
+    calibration = restored;
+    for (int i = 0; i < 3; i++)
+    {
+        calibrated_bias[i] = restored.bias[i];
+        tracked_bias[i] = (int32_t)restored.bias[i] * 256;
+    }
+    drift_alarm = false;
+    core_util_critical_section_exit();
+}
+
+#if GYRO_INT1_USED
+// High-pass filter on the output data and the FIFO, INT1 on angular-rate
+// thresholds. Runs after the FIFO mode is set, CTRL_REG3/5 are rewritten.
+static void ConfigureMotionDetection(uint8_t hpf_config, uint8_t conf3, uint8_t conf5)
+{
+    uint16_t threshold = min<uint32_t>((uint32_t)(GYRO_MOTION_THRESHOLD_DPS / sensitivity), 0x7FFF);
+
+    WriteByte(CTRL_REG_2, hpf_config); // normal mode, reset by reading REFERENCE
+    for (int axis = 0; axis < 3; axis++)
     {
-        GetGyroValue(rawdata);
-        sumX += rawdata->x_raw;
-        sumY += rawdata->y_raw;
-        sumZ += rawdata->z_raw;
-        x_threshold = max(x_threshold, rawdata->x_raw);
-        y_threshold = max(y_threshold, rawdata->y_raw);
-        z_threshold = max(z_threshold, rawdata->z_raw);
-        wait_us(10000);
+        WriteByte(INT1_THS_XH + 2 * axis, threshold >> 8);
+        WriteByte(INT1_THS_XH + 2 * axis + 1, threshold & 0xFF);
     }
+    // No WAIT bit: INT1 falls with the rate, the acquisition holds the gate open
+    WriteByte(INT1_DURATION, GYRO_MOTION_DURATION);
+    WriteByte(INT1_CFG, INT1_CFG_HIGH_XYZ);
+    WriteByte(CTRL_REG_3, conf3 | INT1_ENABLE);
+    WriteByte(CTRL_REG_5, conf5 | HPF_ENABLE | INT1_SEL_HPF | OUT_SEL_HPF);
 
-    x_sample = sumX >> 7; // 128 is 2^7
-    y_sample = sumY >> 7;
-    z_sample = sumZ >> 7;
+    // Start the filter from the current rate instead of settling from zero
+    ReadByte(REFERENCE);
 }
+#endif
 
 // Initiate gyroscope, set up control registers
-void InitiateGyroscope(Gyroscope_Init_Parameters *init_parameters, Gyroscope_RawData *init_raw_data)
+bool InitiateGyroscope(Gyroscope_Init_Parameters *init_parameters, Gyroscope_RawData *init_raw_data, bool calibrate)
 {
     gyro_raw = init_raw_data;
     cs = 1;
-    gyroscope.format(8, 3);       // 8 bits per SPI frame; polarity 1, phase 0
-    gyroscope.frequency(1000000); // 1 MHz clock (max: 10 MHz)
+    gyroscope.format(8, 3);                  // 8 bits per SPI frame; polarity 1, phase 0
+    gyroscope.frequency(GYRO_SPI_FREQUENCY); // max: 10 MHz
+#if GYRO_SPI_ASYNC && DEVICE_SPI_ASYNCH
+    gyroscope.set_dma_usage(DMA_USAGE_ALWAYS); // falls back to interrupts if no DMA channel
+#endif
+
+    WriteByte(CTRL_REG_5, 0x00);
+    WriteByte(FIFO_CTRL_REG, FIFO_MODE_BYPASS);
 
     WriteByte(CTRL_REG_1, init_parameters->conf1 | POWERON); // set ODR, bandwidth, enable all axes
-    WriteByte(CTRL_REG_3, init_parameters->conf3);           // DRDY enable
+    WriteByte(CTRL_REG_3, init_parameters->conf3);           // DRDY / watermark enable
     WriteByte(CTRL_REG_4, init_parameters->conf4);           // full-scale selection
 
     switch (init_parameters->conf4)
@@ -106,32 +321,122 @@ void InitiateGyroscope(Gyroscope_Init_Parameters *init_parameters, Gyroscope_Raw
             break;
     }
 
-    CalibrateGyroscope(gyro_raw);
-}
+    // Switch to the requested FIFO mode; passing through bypass empties it
+    fifo_ctrl = FIFO_MODE_BYPASS;
+    if (init_parameters->conf5 & FIFO_ENABLE)
+    {
+        fifo_ctrl = init_parameters->fifo_ctrl;
+        WriteByte(CTRL_REG_5, init_parameters->conf5);
+        WriteByte(FIFO_CTRL_REG, fifo_ctrl);
+    }
 
-// Convert raw ADC value to degrees per second
-float ConvertToDPS(int16_t axis_data)
-{
-    return axis_data * sensitivity;
+#if GYRO_HW_MOTION
+    ConfigureMotionDetection(GYRO_HPF_CONFIG, init_parameters->conf3, init_parameters->conf5);
+    (void)calibrate;
+    return false;
+#else
+    // The cached calibration is reused until temperature or drift says otherwise
+    if (!calibrate || !GyroscopeNeedsCalibration())
+        return false;
+
+    CalibrateGyroscope(gyro_raw);
+    return true;
+#endif
 }
 
 // Apply bias offset and noise threshold, writing calibrated values back to gyro_raw
 void GetCalibratedRawData()
 {
     GetGyroValue(gyro_raw);
+    CalibrateSample(gyro_raw);
+}
 
-    // Subtract the zero-rate level bias
-    gyro_raw->x_raw -= x_sample;
-    gyro_raw->y_raw -= y_sample;
-    gyro_raw->z_raw -= z_sample;
+void GetCalibratedSample(Gyroscope_RawData *sample)
+{
+    GetGyroValue(sample);
+    CalibrateSample(sample);
+}
 
-    // Zero out readings below the noise threshold
-    if (abs(gyro_raw->x_raw) < abs(x_threshold))
-        gyro_raw->x_raw = 0;
-    if (abs(gyro_raw->y_raw) < abs(y_threshold))
-        gyro_raw->y_raw = 0;
-    if (abs(gyro_raw->z_raw) < abs(z_threshold))
-        gyro_raw->z_raw = 0;
+// Number of unread samples in the FIFO (OVRN means all 32 slots are full)
+uint8_t GetFifoLevel()
+{
+    uint8_t src = ReadByte(FIFO_SRC_REG);
+    if (src & FIFO_SRC_OVRN)
+        return FIFO_DEPTH;
+    if (src & FIFO_SRC_EMPTY)
+        return 0;
+    return src & FIFO_SRC_FSS_MASK;
+}
+
+// Going through bypass mode resets the FIFO contents
+void FlushFifo()
+{
+    WriteByte(FIFO_CTRL_REG, FIFO_MODE_BYPASS);
+    WriteByte(FIFO_CTRL_REG, fifo_ctrl);
+}
+
+// Drain the FIFO with a single auto-incremented read. With the FIFO enabled
+// the address pointer wraps from OUT_Z_H back to OUT_X_L, so consecutive
+// samples can be clocked out in one transaction.
+size_t GetCalibratedFifoData(Gyroscope_RawData *samples, size_t max_samples)
+{
+    size_t count = ReadFifo(samples, max_samples);
+    for (size_t i = 0; i < count; i++)
+        CalibrateSample(&samples[i]);
+
+    return count;
+}
+
+// SPI completion: release the chip select, publish the filled frame and
+// switch the next transfer to the other buffer
+static void OnGyroTransferDone(int event)
+{
+    cs = 1;
+    TraceRecord(TRACE_SPI_READ, transfer_start);
+
+    Gyroscope_RawData *samples = fifo_frames[fill_frame];
+    DecodeFrames(fifo_rx[fill_frame] + 1, samples, transfer_count);
+    for (size_t i = 0; i < transfer_count; i++)
+        CalibrateSample(&samples[i]);
+
+    fill_frame ^= 1;
+    transfer_busy = false;
+
+    if ((event & SPI_EVENT_COMPLETE) && read_callback)
+        read_callback(samples, transfer_count);
+}
+
+bool GyroReadBusy()
+{
+    return transfer_busy;
+}
+
+bool StartGyroReadAsync(size_t count, GyroReadCallback on_complete)
+{
+    if (transfer_busy || count == 0)
+        return false;
+
+    transfer_busy = true;
+    transfer_count = min<size_t>(count, FIFO_DEPTH);
+    read_callback = on_complete;
+
+    int length = PrepareBurst(transfer_count);
+    transfer_start = TraceNow();
+    cs = 0;
+#if GYRO_SPI_ASYNC && DEVICE_SPI_ASYNCH
+    if (gyroscope.transfer(fifo_tx, length, fifo_rx[fill_frame], length,
+                           callback(OnGyroTransferDone), SPI_EVENT_COMPLETE) != 0)
+    {
+        cs = 1;
+        transfer_busy = false;
+        return false;
+    }
+#else
+    // No asynchronous SPI on this target: complete the transfer in place
+    gyroscope.write(fifo_tx, length, fifo_rx[fill_frame], length);
+    OnGyroTransferDone(SPI_EVENT_COMPLETE);
+#endif
+    return true;
 }
 
 // Turn off the gyroscope
@@ -139,3 +444,18 @@ void PowerOff()
 {
     WriteByte(CTRL_REG_1, 0x00);
 }
+
+// Slowest ODR, FIFO and INT2 off, only the INT1 motion threshold left on.
+// InitiateGyroscope() restores the acquisition setup.
+void GyroscopeWakeOnMotion()
+{
+#if IDLE_ENABLE && IDLE_WAKE_ON_MOTION
+    WriteByte(CTRL_REG_5, 0x00);
+    WriteByte(FIFO_CTRL_REG, FIFO_MODE_BYPASS);
+    fifo_ctrl = FIFO_MODE_BYPASS;
+    WriteByte(CTRL_REG_1, ODR_100_CUTOFF_25 | POWERON);
+    ConfigureMotionDetection(IDLE_HPF_CONFIG, 0x00, 0x00);
+#else
+    PowerOff();
+#endif
+}
@@ -12,8 +12,12 @@
  * - Temira Koenig
  */
 
+#ifndef GYRO_H
+#define GYRO_H
+
 #include <mbed.h>
 
+#include "gyro_sample.h"
 #include "system_config.h"
 
 // Initialization parameters
@@ -21,14 +25,20 @@ typedef struct {
   uint8_t conf1;  // output data rate
   uint8_t conf3;  // interrupt configuration
   uint8_t conf4;  // full-scale selection
+  uint8_t conf5;  // FIFO enable (0 to leave the FIFO bypassed)
+  uint8_t fifo_ctrl;  // FIFO mode and watermark level
 } Gyroscope_Init_Parameters;
 
-// Raw data
+// Zero-rate calibration
 typedef struct {
-  int16_t x_raw;  // X-axis raw data
-  int16_t y_raw;  // Y-axis raw data
-  int16_t z_raw;  // Z-axis raw data
-} Gyroscope_RawData;
+  int16_t bias[3];       // zero-rate level per axis
+  int16_t threshold[3];  // noise dead-band per axis, relative to the bias
+  int8_t temperature;    // OUT_TEMP reading when the calibration was taken
+  uint8_t valid;         // set once a calibration was taken or restored
+} Gyroscope_Calibration;
+
+// Completion callback for asynchronous reads, runs in interrupt context
+typedef Callback<void(const Gyroscope_RawData *samples, size_t count)> GyroReadCallback;
 
 // Write IO
 void WriteByte(uint8_t address, uint8_t data);
@@ -36,18 +46,56 @@ void WriteByte(uint8_t address, uint8_t data);
 // Read IO
 void GetGyroValue(Gyroscope_RawData *rawdata);
 
-// Gyroscope calibration
+// Gyroscope calibration, blocking; reads the FIFO at full ODR when it is enabled
 void CalibrateGyroscope(Gyroscope_RawData *rawdata);
 
-// Gyroscope initialization
-void InitiateGyroscope(Gyroscope_Init_Parameters *init_parameters,
-                       Gyroscope_RawData *init_raw_data);
+// Gyroscope initialization. Calibrates only when GyroscopeNeedsCalibration()
+// and calibrate is set (false while the board may be moving: registers only);
+// returns true if a fresh calibration was taken.
+bool InitiateGyroscope(Gyroscope_Init_Parameters *init_parameters,
+                       Gyroscope_RawData *init_raw_data, bool calibrate = true);
+
+// No calibration yet, or temperature / tracked drift moved past their limits
+bool GyroscopeNeedsCalibration();
+
+// Consistent copy of the current calibration, including the tracked bias
+Gyroscope_Calibration GetGyroscopeCalibration();
 
-// Data conversion: raw -> degrees per second
-float ConvertToDPS(int16_t rawdata);
+// Restore a calibration, e.g. from persistent storage
+void SetGyroscopeCalibration(const Gyroscope_Calibration &calibration);
+
+// Die temperature (OUT_TEMP), only meaningful relative to another reading
+int8_t GetGyroTemperature();
 
 // Get calibrated raw data
 void GetCalibratedRawData();
 
+// Read and calibrate one sample into the caller's buffer, for readers that
+// run outside the gyroscope thread
+void GetCalibratedSample(Gyroscope_RawData *sample);
+
+// Number of samples currently held in the FIFO
+uint8_t GetFifoLevel();
+
+// Discard everything buffered in the FIFO and restart it
+void FlushFifo();
+
+// Drain the FIFO in one burst and calibrate every sample, returns the count read
+size_t GetCalibratedFifoData(Gyroscope_RawData *samples, size_t max_samples);
+
+// Start a non-blocking burst read of count samples. The calibrated samples
+// are passed to on_complete; they stay valid until the next read completes.
+// Returns false if a transfer is still in flight.
+bool StartGyroReadAsync(size_t count, GyroReadCallback on_complete);
+
+// An asynchronous read is in flight; the bus must not be used until it completes
+bool GyroReadBusy();
+
 // Turn off the gyroscope
 void PowerOff();
+
+// Idle mode: watch for motion on INT1 (IDLE_WAKE_ON_MOTION) or power down.
+// No asynchronous read may be in flight.
+void GyroscopeWakeOnMotion();
+
+#endif  // GYRO_H
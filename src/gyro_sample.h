@@ -0,0 +1,34 @@
+/**
+ * @file gyro_sample.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Gyroscope sample types shared by the driver, the processing
+ * pipeline and the host replay harness in the embedded sentry project.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef GYRO_SAMPLE_H
+#define GYRO_SAMPLE_H
+
+#include <cstdint>
+
+// Raw data
+typedef struct {
+  int16_t x_raw;  // X-axis raw data
+  int16_t y_raw;  // Y-axis raw data
+  int16_t z_raw;  // Z-axis raw data
+} Gyroscope_RawData;
+
+// Raw data stamped with its acquisition time
+typedef struct {
+  uint32_t timestamp_us;   // microsecond ticker at sample time
+  Gyroscope_RawData data;  // calibrated raw data
+} Gyroscope_Sample;
+
+#endif  // GYRO_SAMPLE_H
@@ -0,0 +1,436 @@
+/**
+ * @file replay.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Host replay and benchmark harness for the gesture pipeline of the
+ * embedded sentry project (env:native).
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ *
+ * Feeds gyroscope traces through the same filter, decimation, trim,
+ * enrollment and matching code the firmware runs, as fast as the host
+ * allows. Traces are the CSV files written by serial_dump.py --csv
+ * (timestamp_us,x,y,z per sample, calibrated raw counts); one capture may
+ * hold several recordings, which are split at gaps in the timestamps.
+ *
+ *   program --enroll key.csv --genuine owner.csv --impostor others.csv
+ *   program --synthetic 50 --max-far 0 --max-frr 0.1
+ *
+ * Reports accept/reject rates, per-kernel time and the number of heap
+ * allocations made inside each kernel; exits with 1 if --max-far or
+ * --max-frr is exceeded.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <vector>
+
+#include "key_store.h"
+#include "pipeline.h"
+#include "segmenter.h"
+#include "streaming_matcher.h"
+
+typedef std::chrono::steady_clock Clock;
+typedef std::vector<Gyroscope_Sample> Recording;
+
+/*******************************************************************************
+ * Allocation counting: every operator new made while a kernel runs is
+ * charged to it. The firmware kernels are meant to stay at zero.
+ * ****************************************************************************/
+static size_t allocation_count = 0;
+
+void *operator new(size_t size)
+{
+    allocation_count++;
+    void *p = malloc(size ? size : 1);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+/*******************************************************************************
+ * Kernels
+ * ****************************************************************************/
+typedef enum
+{
+    KERNEL_FILTER, // record_sample() over one decimation period
+    KERNEL_TRIM,
+    KERNEL_ENROLL, // normalize and store a template
+    KERNEL_MATCH,  // batch matcher, normalize included
+    KERNEL_STREAM, // streaming matcher, one kept sample or the final decision
+    KERNEL_COUNT
+} Kernel;
+
+typedef struct
+{
+    uint64_t calls;
+    uint64_t items; // samples the calls processed
+    uint64_t ns;
+    uint64_t allocations;
+} Kernel_Stats;
+
+static const char *const kernel_names[KERNEL_COUNT] = {"filter", "trim", "enroll", "match", "stream"};
+static Kernel_Stats kernels[KERNEL_COUNT];
+
+// Time one kernel call and charge its allocations
+template <typename F>
+static auto Measure(Kernel kernel, size_t items, F f) -> decltype(f())
+{
+    struct Scope
+    {
+        Kernel_Stats &stats;
+        size_t items;
+        size_t allocations;
+        Clock::time_point start;
+        ~Scope()
+        {
+            stats.ns += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+            stats.calls++;
+            stats.items += items;
+            stats.allocations += allocation_count - allocations;
+        }
+    } scope = {kernels[kernel], items, allocation_count, Clock::now()};
+    return f();
+}
+
+/*******************************************************************************
+ * Replay
+ * ****************************************************************************/
+typedef enum
+{
+    ROLE_ENROLL,
+    ROLE_GENUINE,
+    ROLE_IMPOSTOR
+} Role;
+
+typedef struct
+{
+    Role role;
+    Recording samples;
+} Replay_Item;
+
+static KeyStore key_store;
+#if GESTURE_STREAMING_ACTIVE
+static StreamingMatcher stream_matcher;
+#endif
+#if GESTURE_SEGMENT
+static GestureSegmenter segmenter;
+#endif
+
+static uint64_t replayed_us = 0; // recorded time fed through the pipeline
+
+// One record or unlock attempt, as gyroscope_thread() runs it
+static bool Replay(const Replay_Item &item)
+{
+    static GestureRecord record; // too large for the stack with DTW envelopes
+    record.clear();
+
+    bool attempt = item.role != ROLE_ENROLL;
+#if GESTURE_STREAMING_ACTIVE
+    bool streaming = attempt && !key_store.empty();
+    if (streaming)
+        stream_matcher.begin(key_store);
+#endif
+
+    // Same window and early stop as recording_done()
+    size_t decimation_count = 0;
+    filter_reset();
+#if GESTURE_SEGMENT
+    segmenter.reset();
+#endif
+    size_t period = 0;
+    Clock::time_point period_start = Clock::now();
+    size_t allocations = allocation_count;
+    uint32_t first = item.samples.empty() ? 0 : item.samples.front().timestamp_us;
+    for (const Gyroscope_Sample &sample : item.samples)
+    {
+#if GESTURE_SEGMENT
+        if (segmenter.done() ||
+            (!segmenter.started() && sample.timestamp_us - first >= (uint32_t)SEGMENT_START_TIMEOUT_MS * 1000))
+            break;
+#else
+        if (sample.timestamp_us - first >= (uint32_t)GESTURE_RECORD_WINDOW_MS * 1000)
+            break;
+#endif
+#if GESTURE_STREAMING_ACTIVE
+        if (streaming && stream_matcher.decided())
+            break;
+#endif
+        replayed_us += 1000000 / GYRO_ODR_HZ;
+
+        period++;
+        GestureSample decimated;
+        if (!decimate_sample(sample.data, decimation_count, decimated))
+            continue;
+#if GESTURE_SEGMENT
+        size_t appended = segmenter.add(record, decimated);
+#else
+        size_t appended = record.push_back(decimated) ? 1 : 0;
+#endif
+
+        Kernel_Stats &filter = kernels[KERNEL_FILTER];
+        filter.ns += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - period_start).count();
+        filter.calls++;
+        filter.items += period;
+        filter.allocations += allocation_count - allocations;
+
+#if GESTURE_STREAMING_ACTIVE
+        for (size_t i = record.size() - appended; streaming && i < record.size(); i++)
+            Measure(KERNEL_STREAM, 1, [&] { return stream_matcher.add(record[i]); });
+#else
+        (void)appended;
+#endif
+        period = 0;
+        period_start = Clock::now();
+        allocations = allocation_count;
+    }
+
+    Measure(KERNEL_TRIM, record.size(), [&] { trim_gyro_data(record); });
+
+    if (!attempt)
+    {
+        Measure(KERNEL_ENROLL, record.size(), [&] { return key_store.enroll(record, KEY_STORE_DEFAULT_USER); });
+        return true;
+    }
+    if (key_store.empty())
+        return false;
+
+#if GESTURE_STREAMING_ACTIVE
+    return Measure(KERNEL_STREAM, 0, [&] { return stream_matcher.finish(); }) == STREAM_ACCEPT;
+#else
+    Key_Match_Result match;
+    return Measure(KERNEL_MATCH, record.size(), [&] { return key_store.match(record, match); });
+#endif
+}
+
+/*******************************************************************************
+ * Input
+ * ****************************************************************************/
+
+// Split a capture into recordings wherever the stream paused
+static void Split(const Recording &capture, uint32_t gap_us, Role role, std::vector<Replay_Item> &items)
+{
+    for (size_t i = 0; i < capture.size(); i++)
+    {
+        if (i == 0 || capture[i].timestamp_us - capture[i - 1].timestamp_us > gap_us)
+            items.push_back(Replay_Item{role, Recording()});
+        items.back().samples.push_back(capture[i]);
+    }
+}
+
+static bool LoadCsv(const char *path, Recording &capture)
+{
+    FILE *file = fopen(path, "r");
+    if (file == nullptr)
+    {
+        fprintf(stderr, "replay: cannot open %s\n", path);
+        return false;
+    }
+
+    char line[128];
+    while (fgets(line, sizeof(line), file) != nullptr)
+    {
+        unsigned long timestamp;
+        int x, y, z;
+        if (sscanf(line, "%lu,%d,%d,%d", &timestamp, &x, &y, &z) == 4) // skips the header
+            capture.push_back({(uint32_t)timestamp, {(int16_t)x, (int16_t)y, (int16_t)z}});
+    }
+    fclose(file);
+    return true;
+}
+
+// Sum of sinusoids per axis with silence around it. Genuine attempts add
+// noise, a gain and a small time shift to the shape of the key.
+static Recording Synthesize(std::mt19937 &random, int shape, bool variation)
+{
+    std::normal_distribution<float> noise(0.0f, 150.0f);
+    std::uniform_real_distribution<float> jitter(-1.0f, 1.0f);
+    float gain = variation ? 1.0f + 0.1f * jitter(random) : 1.0f;
+    float shift = variation ? 0.05f * jitter(random) : 0.0f;
+    const float silence = 0.3f, active = 2.0f;
+
+    Recording recording;
+    uint32_t period_us = 1000000 / GYRO_ODR_HZ;
+    size_t count = (size_t)((2 * silence + active) * GYRO_ODR_HZ);
+    for (size_t i = 0; i < count; i++)
+    {
+        float t = (float)i / GYRO_ODR_HZ - silence - shift;
+        int16_t axis[3] = {0, 0, 0};
+        if (t >= 0 && t < active)
+        {
+            for (int a = 0; a < 3; a++)
+            {
+                float f = 0.5f + 0.4f * ((shape * 7 + a * 3) % 5);
+                float v = 6000.0f * sin(2 * M_PI * f * t + shape + a) * sin(M_PI * t / active);
+                axis[a] = (int16_t)(gain * v + (variation ? noise(random) : 0.0f));
+            }
+        }
+        recording.push_back({(uint32_t)(i * period_us), {axis[0], axis[1], axis[2]}});
+    }
+    return recording;
+}
+
+static void Usage()
+{
+    fprintf(stderr,
+            "usage: replay [--enroll FILE] [--genuine FILE] [--impostor FILE]\n"
+            "              [--synthetic N] [--repeat N] [--gap-ms MS]\n"
+            "              [--max-far RATE] [--max-frr RATE]\n");
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<Replay_Item> items;
+    std::vector<std::pair<Role, const char *>> files;
+    int synthetic = 0, repeat = 1;
+    uint32_t gap_us = 100000;
+    float max_far = 1.0f, max_frr = 1.0f;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (value == nullptr)
+        {
+            Usage();
+            return 2;
+        }
+        i++;
+        if (!strcmp(argv[i - 1], "--enroll"))
+            files.push_back({ROLE_ENROLL, value});
+        else if (!strcmp(argv[i - 1], "--genuine"))
+            files.push_back({ROLE_GENUINE, value});
+        else if (!strcmp(argv[i - 1], "--impostor"))
+            files.push_back({ROLE_IMPOSTOR, value});
+        else if (!strcmp(argv[i - 1], "--synthetic"))
+            synthetic = atoi(value);
+        else if (!strcmp(argv[i - 1], "--repeat"))
+            repeat = atoi(value) > 0 ? atoi(value) : 1;
+        else if (!strcmp(argv[i - 1], "--gap-ms"))
+            gap_us = (uint32_t)atoi(value) * 1000;
+        else if (!strcmp(argv[i - 1], "--max-far"))
+            max_far = atof(value);
+        else if (!strcmp(argv[i - 1], "--max-frr"))
+            max_frr = atof(value);
+        else
+        {
+            Usage();
+            return 2;
+        }
+    }
+
+    // Enrollments first, whatever the order on the command line
+    for (Role role : {ROLE_ENROLL, ROLE_GENUINE, ROLE_IMPOSTOR})
+    {
+        for (const auto &file : files)
+        {
+            Recording capture;
+            if (file.first != role)
+                continue;
+            if (!LoadCsv(file.second, capture))
+                return 2;
+            Split(capture, gap_us, role, items);
+        }
+    }
+
+    std::mt19937 random(1234);
+    if (synthetic > 0)
+    {
+        bool enrolled = false;
+        for (const Replay_Item &item : items)
+            enrolled |= item.role == ROLE_ENROLL;
+        if (!enrolled)
+            items.insert(items.begin(), Replay_Item{ROLE_ENROLL, Synthesize(random, 0, false)});
+        for (int i = 0; i < synthetic; i++)
+        {
+            items.push_back(Replay_Item{ROLE_GENUINE, Synthesize(random, 0, true)});
+            items.push_back(Replay_Item{ROLE_IMPOSTOR, Synthesize(random, 1 + i % 4, true)});
+        }
+    }
+    if (items.empty())
+    {
+        Usage();
+        return 2;
+    }
+
+    // The firmware runs at +-500 dps full scale
+    sensitivity = SENSITIVITY_500;
+
+    size_t enrolled = 0;
+    size_t attempts[3] = {0, 0, 0}, accepted[3] = {0, 0, 0};
+    Clock::time_point start = Clock::now();
+    for (int pass = 0; pass < repeat; pass++)
+    {
+        for (const Replay_Item &item : items)
+        {
+            if (item.role == ROLE_ENROLL)
+            {
+                // Enroll once, repeat only the attempts
+                if (pass == 0)
+                {
+                    Replay(item);
+                    enrolled++;
+                }
+                continue;
+            }
+            attempts[item.role]++;
+            accepted[item.role] += Replay(item);
+        }
+    }
+    double elapsed_s = std::chrono::duration<double>(Clock::now() - start).count();
+
+    float frr = attempts[ROLE_GENUINE] ? 1.0f - (float)accepted[ROLE_GENUINE] / attempts[ROLE_GENUINE] : 0.0f;
+    float far = attempts[ROLE_IMPOSTOR] ? (float)accepted[ROLE_IMPOSTOR] / attempts[ROLE_IMPOSTOR] : 0.0f;
+
+    printf("replay: %zu enrolled, %zu attempts, %.2f s of samples in %.1f ms (%.0fx real time)\n",
+           enrolled, attempts[ROLE_GENUINE] + attempts[ROLE_IMPOSTOR], replayed_us / 1e6,
+           elapsed_s * 1e3, elapsed_s > 0 ? replayed_us / 1e6 / elapsed_s : 0.0);
+    printf("genuine:  %zu/%zu accepted, FRR %.1f%%\n", accepted[ROLE_GENUINE], attempts[ROLE_GENUINE], frr * 100);
+    printf("impostor: %zu/%zu accepted, FAR %.1f%%\n", accepted[ROLE_IMPOSTOR], attempts[ROLE_IMPOSTOR], far * 100);
+
+    printf("\n%-8s %10s %10s %12s %14s %8s\n", "kernel", "calls", "samples", "ns/call", "samples/s", "allocs");
+    for (int k = 0; k < KERNEL_COUNT; k++)
+    {
+        const Kernel_Stats &s = kernels[k];
+        if (s.calls == 0)
+            continue;
+        printf("%-8s %10llu %10llu %12.0f %14.0f %8llu\n", kernel_names[k], (unsigned long long)s.calls,
+               (unsigned long long)s.items, (double)s.ns / s.calls, s.ns ? s.items * 1e9 / s.ns : 0.0,
+               (unsigned long long)s.allocations);
+    }
+
+#if GESTURE_MATCHER == GESTURE_MATCHER_CASCADE
+    const Key_Cascade_Stats &c = key_store.cascadeStats();
+    printf("\ncascade: %u matches, features rejected %u, correlation %u (accepted %u, rejected %u), "
+           "borderline %u (bounded %u, DTW %u, accepted %u)\n",
+           (unsigned)c.attempts, (unsigned)c.feature_rejects, (unsigned)c.correlations,
+           (unsigned)c.correlation_accepts, (unsigned)c.correlation_rejects, (unsigned)(c.dtw_bounded + c.dtw_runs),
+           (unsigned)c.dtw_bounded, (unsigned)c.dtw_runs, (unsigned)c.dtw_accepts);
+#endif
+
+    if (far > max_far || frr > max_frr)
+    {
+        printf("\nFAIL: FAR %.3f (max %.3f), FRR %.3f (max %.3f)\n", far, max_far, frr, max_frr);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,314 @@
+/**
+ * @file key_storage.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Persistent binary gesture key storage in the on-board I2C EEPROM
+ * for the embedded sentry project.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "key_storage.h"
+#include "drivers/stm32f429i_discovery_eeprom.h"
+
+#define PAGE_ALIGN(x) (((x) + EEPROM_PAGESIZE - 1) / EEPROM_PAGESIZE * EEPROM_PAGESIZE)
+
+#define KEY_STORAGE_DIRECTORY_BYTES PAGE_ALIGN(sizeof(Key_Storage_Directory))
+#define KEY_STORAGE_SLOT_BYTES PAGE_ALIGN(GESTURE_BUFFER_CAPACITY * 3 * sizeof(int16_t))
+#define CALIBRATION_ADDRESS \
+    (KEY_STORAGE_BASE + KEY_STORAGE_DIRECTORY_BYTES + KEY_STORE_CAPACITY * KEY_STORAGE_SLOT_BYTES)
+
+// Gyroscope calibration record stored behind the template slots
+typedef struct {
+    uint32_t magic;
+    Gyroscope_Calibration calibration;
+    uint16_t crc; // CRC-16/CCITT of everything above
+} Calibration_Record;
+
+static_assert(sizeof(Key_Storage_Slot) == 12, "Key_Storage_Slot layout changed");
+static_assert(KEY_STORE_CAPACITY <= 255, "slot count must fit the directory");
+static_assert(KEY_STORAGE_BASE % EEPROM_PAGESIZE == 0, "key area must be page aligned");
+static_assert(CALIBRATION_ADDRESS + PAGE_ALIGN(sizeof(Calibration_Record)) <= EEPROM_MAX_SIZE,
+              "key area does not fit in the EEPROM");
+
+// One EEPROM operation at a time; sharing I2C3 with the touch controller is
+// arbitrated by the bus manager in the BSP
+static Mutex eeprom_mutex;
+
+static Key_Storage_Directory directory;  // copy of what is in the EEPROM
+static bool eeprom_ready = false;
+static uint8_t body[KEY_STORAGE_SLOT_BYTES];  // one serialized template
+
+static uint16_t Crc16(const void *data, size_t length)
+{
+    MbedCRC<POLY_16BIT_CCITT, 16> crc;
+    uint32_t value = 0;
+    crc.compute(data, length, &value);
+    return (uint16_t)value;
+}
+
+static uint16_t SlotAddress(size_t slot)
+{
+    return KEY_STORAGE_BASE + KEY_STORAGE_DIRECTORY_BYTES + slot * KEY_STORAGE_SLOT_BYTES;
+}
+
+static bool ReadBytes(uint16_t address, void *data, uint16_t length)
+{
+    eeprom_mutex.lock();
+    uint16_t remaining = length;
+    bool ok = BSP_EEPROM_ReadBuffer((uint8_t *)data, address, &remaining) == EEPROM_OK;
+    eeprom_mutex.unlock();
+    return ok;
+}
+
+static bool WriteBytes(uint16_t address, const void *data, uint16_t length)
+{
+    // Regions are page aligned, so the BSP issues whole-page DMA writes
+    eeprom_mutex.lock();
+    bool ok = BSP_EEPROM_WriteBuffer((uint8_t *)data, address, PAGE_ALIGN(length)) == EEPROM_OK;
+    eeprom_mutex.unlock();
+    return ok;
+}
+
+static void ResetDirectory()
+{
+    memset(&directory, 0, sizeof(directory));
+    directory.magic = KEY_STORAGE_MAGIC;
+    directory.version = KEY_STORAGE_VERSION;
+    directory.capacity = KEY_STORE_CAPACITY;
+    directory.max_length = GESTURE_BUFFER_CAPACITY;
+}
+
+static bool WriteDirectory()
+{
+    directory.crc = Crc16(&directory, offsetof(Key_Storage_Directory, crc));
+    return WriteBytes(KEY_STORAGE_BASE, &directory, sizeof(directory));
+}
+
+static size_t DirectoryCount()
+{
+    size_t count = 0;
+    while (count < KEY_STORE_CAPACITY && directory.slots[count].length > 0)
+    {
+        count++;
+    }
+    return count;
+}
+
+// Quantize one normalized template into body[]
+static size_t SerializeSlot(const KeyStore &store, size_t slot)
+{
+    const GestureRecord &record = store.samples(slot);
+    size_t length = record.size();
+    for (size_t j = 0; j < length; j++)
+    {
+        GestureSample s = record[j];
+        for (int i = 0; i < 3; i++)
+        {
+#if GESTURE_FIXED_POINT
+            int16_t q = s[i];
+#else
+            float scaled = s[i] * 32767.0f;
+            int16_t q = scaled >= 32767.0f ? 32767 : scaled <= -32767.0f ? -32767 : (int16_t)lrintf(scaled);
+#endif
+            body[(j * 3 + i) * 2] = (uint8_t)(q & 0xFF);
+            body[(j * 3 + i) * 2 + 1] = (uint8_t)((uint16_t)q >> 8);
+        }
+    }
+    return length * 3 * sizeof(int16_t);
+}
+
+static bool SaveSlot(const KeyStore &store, size_t slot)
+{
+    size_t bytes = SerializeSlot(store, slot);
+    if (!WriteBytes(SlotAddress(slot), body, bytes))
+    {
+        return false;
+    }
+
+    Key_Storage_Slot &entry = directory.slots[slot];
+    entry.sequence = store.sequence(slot);
+    entry.length = store.samples(slot).size();
+    entry.crc = Crc16(body, bytes);
+    entry.user = store.user(slot);
+    return true;
+}
+
+/*******************************************************************************
+ *
+ * @brief Bring up the EEPROM and read the directory only
+ * @return number of templates recorded in a valid directory
+ *
+ * ****************************************************************************/
+size_t KeyStorageInit()
+{
+    eeprom_mutex.lock();
+    eeprom_ready = BSP_EEPROM_Init() == EEPROM_OK;
+    eeprom_mutex.unlock();
+
+    if (!eeprom_ready || !ReadBytes(KEY_STORAGE_BASE, &directory, sizeof(directory)) ||
+        directory.magic != KEY_STORAGE_MAGIC || directory.version != KEY_STORAGE_VERSION ||
+        directory.capacity != KEY_STORE_CAPACITY || directory.max_length != GESTURE_BUFFER_CAPACITY ||
+        directory.crc != Crc16(&directory, offsetof(Key_Storage_Directory, crc)))
+    {
+        ResetDirectory();
+        return 0;
+    }
+    return DirectoryCount();
+}
+
+/*******************************************************************************
+ *
+ * @brief Read, check and restore every stored template into the key store
+ * @param store: empty key store to fill
+ * @return number of templates restored
+ *
+ * ****************************************************************************/
+size_t KeyStorageLoad(KeyStore &store)
+{
+    size_t stored = DirectoryCount();
+    bool dropped = false;
+
+    for (size_t slot = 0; slot < stored; slot++)
+    {
+        const Key_Storage_Slot &entry = directory.slots[slot];
+        size_t bytes = entry.length * 3 * sizeof(int16_t);
+        if (entry.length > GESTURE_BUFFER_CAPACITY || !ReadBytes(SlotAddress(slot), body, bytes) ||
+            Crc16(body, bytes) != entry.crc)
+        {
+            dropped = true;
+            continue;
+        }
+
+        GestureRecord record;
+        for (size_t j = 0; j < entry.length; j++)
+        {
+            GestureSample s;
+            for (int i = 0; i < 3; i++)
+            {
+                int16_t q = (int16_t)(body[(j * 3 + i) * 2] | (body[(j * 3 + i) * 2 + 1] << 8));
+#if GESTURE_FIXED_POINT
+                s[i] = q;
+#else
+                s[i] = q * (1.0f / 32767.0f);
+#endif
+            }
+            record.push_back(s);
+        }
+        store.restore(record, entry.user, entry.sequence);
+    }
+
+    // Keep the EEPROM slot numbers in step with the compacted key store
+    if (dropped)
+    {
+        KeyStorageSaveAll(store);
+    }
+    return store.size();
+}
+
+/*******************************************************************************
+ *
+ * @brief Write one template body and the updated directory
+ * @param store: key store holding the template
+ * @param slot: slot returned by KeyStore::enroll()
+ * @return true on success
+ *
+ * ****************************************************************************/
+bool KeyStorageSave(const KeyStore &store, size_t slot)
+{
+    if (!eeprom_ready || slot >= store.size())
+    {
+        return false;
+    }
+    return SaveSlot(store, slot) && WriteDirectory();
+}
+
+/*******************************************************************************
+ *
+ * @brief Rewrite every template body and the directory
+ * @param store: key store to mirror
+ * @return true on success
+ *
+ * ****************************************************************************/
+bool KeyStorageSaveAll(const KeyStore &store)
+{
+    if (!eeprom_ready)
+    {
+        return false;
+    }
+
+    ResetDirectory();
+    for (size_t slot = 0; slot < store.size(); slot++)
+    {
+        if (!SaveSlot(store, slot))
+        {
+            return false;
+        }
+    }
+    return WriteDirectory();
+}
+
+/*******************************************************************************
+ *
+ * @brief Drop all stored templates by writing an empty directory
+ * @return true on success
+ *
+ * ****************************************************************************/
+bool KeyStorageErase()
+{
+    if (!eeprom_ready)
+    {
+        return false;
+    }
+    ResetDirectory();
+    return WriteDirectory();
+}
+
+/*******************************************************************************
+ *
+ * @brief Read the stored gyroscope calibration
+ * @param calibration: receives the calibration
+ * @return true if a valid record was found
+ *
+ * ****************************************************************************/
+bool KeyStorageLoadCalibration(Gyroscope_Calibration &calibration)
+{
+    Calibration_Record record;
+    if (!eeprom_ready || !ReadBytes(CALIBRATION_ADDRESS, &record, sizeof(record)) ||
+        record.magic != CALIBRATION_MAGIC || !record.calibration.valid ||
+        record.crc != Crc16(&record, offsetof(Calibration_Record, crc)))
+    {
+        return false;
+    }
+    calibration = record.calibration;
+    return true;
+}
+
+/*******************************************************************************
+ *
+ * @brief Store the gyroscope calibration
+ * @param calibration: calibration to save
+ * @return true on success
+ *
+ * ****************************************************************************/
+bool KeyStorageSaveCalibration(const Gyroscope_Calibration &calibration)
+{
+    if (!eeprom_ready)
+    {
+        return false;
+    }
+
+    static uint8_t page[PAGE_ALIGN(sizeof(Calibration_Record))];
+    Calibration_Record record;
+    memset(&record, 0, sizeof(record));
+    record.magic = CALIBRATION_MAGIC;
+    record.calibration = calibration;
+    record.crc = Crc16(&record, offsetof(Calibration_Record, crc));
+    memcpy(page, &record, sizeof(record));
+    return WriteBytes(CALIBRATION_ADDRESS, page, sizeof(record));
+}
@@ -0,0 +1,113 @@
+/**
+ * @file key_storage.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Persistent binary gesture key storage in the on-board I2C EEPROM
+ * for the embedded sentry project.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef KEY_STORAGE_H
+#define KEY_STORAGE_H
+
+#include <mbed.h>
+
+#include "gyro.h"
+#include "key_store.h"
+#include "system_config.h"
+
+/*
+ * EEPROM layout (all fields little endian, every region page aligned):
+ *
+ *   KEY_STORAGE_BASE   directory: magic, version, geometry, one entry per
+ *                      slot (sequence, user, length, body CRC), header CRC
+ *   + directory size   KEY_STORE_CAPACITY bodies of KEY_STORAGE_SLOT_BYTES,
+ *                      each sample stored as three int16 Q15 values
+ *
+ *   after the bodies  gyroscope calibration record with its own CRC
+ *
+ * Only the directory is read at boot; bodies are read by KeyStorageLoad().
+ * A body is written before the directory that describes it, so a reset in
+ * the middle of a save loses at most that one template.
+ */
+#define KEY_STORAGE_MAGIC 0x59454B47u  // "GKEY"
+#define KEY_STORAGE_VERSION 1
+#define CALIBRATION_MAGIC 0x4C414347u  // "GCAL"
+
+// One directory entry
+typedef struct {
+  uint32_t sequence;  // enrollment order
+  uint16_t length;    // samples in the body, 0 = slot unused
+  uint16_t crc;       // CRC-16/CCITT of the body bytes
+  uint8_t user;       // owner tag
+  uint8_t reserved[3];
+} Key_Storage_Slot;
+
+// Directory at the start of the key area
+typedef struct {
+  uint32_t magic;
+  uint8_t version;
+  uint8_t capacity;    // slots in this layout
+  uint16_t max_length; // samples per slot in this layout
+  Key_Storage_Slot slots[KEY_STORE_CAPACITY];
+  uint16_t reserved;
+  uint16_t crc;        // CRC-16/CCITT of everything above
+} Key_Storage_Directory;
+
+/**
+ * @brief Bring up the EEPROM and read the directory only
+ * @return number of templates recorded in a valid directory, 0 if the
+ *         EEPROM is blank, unreadable or holds another format version
+ */
+size_t KeyStorageInit();
+
+/**
+ * @brief Read, check and restore every stored template into the key store.
+ * Templates with a bad CRC are dropped and the directory is rewritten.
+ * @param store: empty key store to fill
+ * @return number of templates restored
+ */
+size_t KeyStorageLoad(KeyStore &store);
+
+/**
+ * @brief Write one template body and the updated directory
+ * @param store: key store holding the template
+ * @param slot: slot returned by KeyStore::enroll()
+ * @return true on success
+ */
+bool KeyStorageSave(const KeyStore &store, size_t slot);
+
+/**
+ * @brief Rewrite every template body and the directory
+ * @param store: key store to mirror
+ * @return true on success
+ */
+bool KeyStorageSaveAll(const KeyStore &store);
+
+/**
+ * @brief Drop all stored templates by writing an empty directory
+ * @return true on success
+ */
+bool KeyStorageErase();
+
+/**
+ * @brief Read the stored gyroscope calibration
+ * @param calibration: receives the calibration
+ * @return true if a valid record was found
+ */
+bool KeyStorageLoadCalibration(Gyroscope_Calibration &calibration);
+
+/**
+ * @brief Store the gyroscope calibration
+ * @param calibration: calibration to save
+ * @return true on success
+ */
+bool KeyStorageSaveCalibration(const Gyroscope_Calibration &calibration);
+
+#endif  // KEY_STORAGE_H
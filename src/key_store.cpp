@@ -0,0 +1,622 @@
+/**
+ * @file key_store.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Multi-template gesture key store with a lower-bound pruning index
+ * for the embedded sentry project.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "key_store.h"
+
+#include <cmath>
+
+#include "trace.h"
+
+static_assert(DTW_BAND <= DTW_MAX_BAND, "DTW_BAND must not exceed DTW_MAX_BAND");
+
+#if GESTURE_FIXED_POINT
+#define SCORE_CORRELATION_THRESHOLD ((GestureScore)CORRELATION_THRESHOLD_Q15)
+#define SCORE_DTW_THRESHOLD ((GestureScore)DTW_THRESHOLD_Q15)
+#define SCORE_BORDER_CORRELATION ((GestureScore)(CASCADE_BORDER_CORRELATION * 32768.0f))
+#define SCORE_XCORR_THRESHOLD ((GestureScore)(XCORR_THRESHOLD * 32768.0f))
+#define FEATURE_SCALE (1.0f / 32768.0f)  // Q15 to unit vector components
+#else
+#define SCORE_CORRELATION_THRESHOLD CORRELATION_THRESHOLD
+#define SCORE_DTW_THRESHOLD DTW_THRESHOLD
+#define SCORE_BORDER_CORRELATION CASCADE_BORDER_CORRELATION
+#define SCORE_XCORR_THRESHOLD XCORR_THRESHOLD
+#define FEATURE_SCALE 1.0f
+#endif
+
+#if KEY_STORE_MOMENTS
+// Prefix moments of the probe being matched, built once per match()
+static GestureMoments probe_moments CCM_DATA;
+#endif
+#if KEY_STORE_PAA
+static Gesture_Paa probe_paa CCM_DATA;
+#endif
+#if GESTURE_MATCHER == GESTURE_MATCHER_CASCADE
+static Gesture_Features probe_features CCM_DATA;
+#endif
+#if GESTURE_MATCHER == GESTURE_MATCHER_XCORR
+static Xcorr_Spectrum probe_spectrum CCM_DATA;
+#endif
+
+/*******************************************************************************
+ *
+ * @brief Enroll a recording, evicting the oldest template when full
+ * @param record: trimmed recording; its samples are moved into the store
+ * @param user: owner tag stored with the template
+ * @return slot the template was stored in
+ *
+ * ****************************************************************************/
+size_t KeyStore::enroll(GestureRecord &record, uint8_t user) {
+  size_t slot = count_;
+  if (full()) {
+    slot = 0;
+    for (size_t i = 1; i < count_; i++) {
+      if (templates_[i].sequence - templates_[slot].sequence > UINT32_MAX / 2) slot = i;
+    }
+  } else {
+    count_++;
+  }
+
+  Template &t = templates_[slot];
+  t.samples.swap(record);
+  record.clear();
+  {
+    TraceSpan span(TRACE_NORMALIZE);
+    normalize(t.samples);
+  }
+  t.sequence = next_sequence_++;
+  t.user = user;
+  buildIndex(t);
+  return slot;
+}
+
+/*******************************************************************************
+ *
+ * @brief Append an already normalized template, keeping its enrollment order
+ * @param record: normalized recording; its samples are moved into the store
+ * @param user: owner tag stored with the template
+ * @param sequence: enrollment sequence number saved with the template
+ * @return slot the template was stored in, or capacity() if full
+ *
+ * ****************************************************************************/
+size_t KeyStore::restore(GestureRecord &record, uint8_t user, uint32_t sequence) {
+  if (full()) return capacity();
+
+  size_t slot = count_++;
+  Template &t = templates_[slot];
+  t.samples.swap(record);
+  record.clear();
+  t.sequence = sequence;
+  t.user = user;
+  buildIndex(t);
+
+  // New enrollments must sort after everything restored so far
+  if (sequence + 1 - next_sequence_ < UINT32_MAX / 2) next_sequence_ = sequence + 1;
+  return slot;
+}
+
+/*******************************************************************************
+ *
+ * @brief Remove a single template, the last live template takes its slot
+ * @param slot: slot to free
+ *
+ * ****************************************************************************/
+void KeyStore::remove(size_t slot) {
+  if (slot >= count_) return;
+  size_t last = count_ - 1;
+  if (slot != last) {
+    Template &dst = templates_[slot];
+    Template &src = templates_[last];
+    dst.samples.swap(src.samples);
+    dst.sequence = src.sequence;
+    dst.user = src.user;
+    buildIndex(dst);
+  }
+  templates_[last].samples.clear();
+  count_--;
+}
+
+/*******************************************************************************
+ *
+ * @brief Precompute what the matcher needs from the template: the per-axis
+ * prefix moments, or for DTW the running min/max over +/- DTW_BAND samples
+ * @param t: template to index
+ *
+ * ****************************************************************************/
+void KeyStore::buildIndex(Template &t) {
+#if KEY_STORE_ENVELOPE
+  size_t m = t.samples.size();
+  for (size_t j = 0; j < m; j++) {
+    size_t lo = j > DTW_BAND ? j - DTW_BAND : 0;
+    size_t hi = j + DTW_BAND < m ? j + DTW_BAND : m - 1;
+    GestureSample upper = t.samples[lo], lower = t.samples[lo];
+    for (size_t k = lo + 1; k <= hi; k++) {
+      GestureSample s = t.samples[k];
+      for (int i = 0; i < 3; i++) {
+        if (s[i] > upper[i]) upper[i] = s[i];
+        if (s[i] < lower[i]) lower[i] = s[i];
+      }
+    }
+    t.upper[j] = upper;
+    t.lower[j] = lower;
+  }
+#endif
+#if KEY_STORE_MOMENTS
+  t.moments.build(t.samples);
+#endif
+#if KEY_STORE_PAA
+  buildPaa(t.samples, t.paa);
+#endif
+#if GESTURE_MATCHER == GESTURE_MATCHER_CASCADE
+  extractFeatures(t.samples, t.features);
+#endif
+#if GESTURE_MATCHER == GESTURE_MATCHER_XCORR
+  buildSpectrum(t.samples, t.spectrum);
+#endif
+}
+
+#if KEY_STORE_PAA
+/*******************************************************************************
+ *
+ * @brief Block summary of a normalized gesture
+ * @param g: normalized gesture
+ * @param p: summary to fill in; blocks past the end of g are left alone
+ *
+ * ****************************************************************************/
+void KeyStore::buildPaa(const GestureRecord &g, Gesture_Paa &p) {
+  for (size_t s = 0; (s + 1) * CORRELATION_PAA_BLOCK <= g.size(); s++) {
+    size_t j0 = s * CORRELATION_PAA_BLOCK;
+    for (int i = 0; i < 3; i++) {
+      float sum = 0.0f;
+      for (size_t j = j0; j < j0 + CORRELATION_PAA_BLOCK; j++) sum += g[j][i];
+      float mean = sum / CORRELATION_PAA_BLOCK;
+      float m2 = 0.0f;
+      for (size_t j = j0; j < j0 + CORRELATION_PAA_BLOCK; j++) m2 += (g[j][i] - mean) * (g[j][i] - mean);
+      p.mean[i][s] = mean;
+      p.root_m2[i][s] = sqrtf(m2);
+    }
+  }
+}
+
+/*******************************************************************************
+ *
+ * @brief Mean and sum of squared deviations of one axis over a prefix
+ * @param m: prefix moments of the gesture
+ * @param axis: 0 = x, 1 = y, 2 = z
+ * @param n: prefix length, at least 1
+ * @param mean: prefix mean
+ * @param m2: prefix sum of squared deviations
+ *
+ * ****************************************************************************/
+static void prefixMean(const GestureMoments &m, int axis, size_t n, float &mean, float &m2) {
+#if GESTURE_FIXED_POINT
+  int64_t sum = m.sum[axis][n - 1];
+  mean = (float)sum / n;
+  m2 = (float)(m.sq_sum[axis][n - 1] * (int64_t)n - sum * sum) / n;  // exact up to the division
+#else
+  mean = m.mean[axis][n - 1];
+  m2 = m.m2[axis][n - 1];
+#endif
+}
+
+/*******************************************************************************
+ *
+ * @brief PAA upper bound on correlate(probe, template)
+ * @param probe: normalized probe, with probe_moments and probe_paa built
+ * @param t: template with its moments and summary
+ * @return a score no less than the weakest axis correlation
+ *
+ * Per axis, the co-moment about the prefix means A and B splits over the
+ * blocks into the co-moment of the block means, which the summaries give
+ * exactly, and the co-moment within each block, which Cauchy-Schwarz bounds
+ * by the product of the blocks' root second moments:
+ * sum((a - A)(b - B)) <= sum_s L (a_s - A)(b_s - B) + sqrt(m2a_s m2b_s).
+ * The partial block at the end is taken straight from the samples.
+ *
+ * ****************************************************************************/
+GestureScore KeyStore::correlationBound(const GestureRecord &probe, const Template &t) const {
+  size_t n = std::min(probe.size(), t.samples.size());
+  size_t blocks = n / CORRELATION_PAA_BLOCK;
+  float weakest = 1.0f;
+  for (int i = 0; n > 0 && i < 3; i++) {
+    float mean_a, m2_a, mean_b, m2_b;
+    prefixMean(probe_moments, i, n, mean_a, m2_a);
+    prefixMean(t.moments, i, n, mean_b, m2_b);
+    float denominator = m2_a * m2_b;
+    if (!(denominator > 0.0f)) {
+      weakest = -1.0f;  // no variation, correlate() never accepts
+      break;
+    }
+
+    float c_ab = 0.0f;
+    for (size_t s = 0; s < blocks; s++) {
+      c_ab += CORRELATION_PAA_BLOCK * (probe_paa.mean[i][s] - mean_a) * (t.paa.mean[i][s] - mean_b) +
+              probe_paa.root_m2[i][s] * t.paa.root_m2[i][s];
+    }
+    for (size_t j = blocks * CORRELATION_PAA_BLOCK; j < n; j++) {
+      c_ab += (probe[j][i] - mean_a) * (t.samples[j][i] - mean_b);
+    }
+    weakest = std::min(weakest, c_ab / sqrtf(denominator));
+  }
+  if (n == 0) weakest = -1.0f;
+
+  // Headroom for the float rounding of the summaries, and in Q15 for the
+  // rounding of the correlation itself
+#if GESTURE_FIXED_POINT
+  return (GestureScore)ceilf(weakest * 32768.0f) + 2;
+#else
+  return weakest + 1e-4f;
+#endif
+}
+#endif
+
+#if GESTURE_MATCHER == GESTURE_MATCHER_XCORR
+/*******************************************************************************
+ *
+ * @brief Per-axis spectra of a normalized gesture
+ * @param g: normalized gesture
+ * @param s: spectra to fill in
+ *
+ * ****************************************************************************/
+void KeyStore::buildSpectrum(const GestureRecord &g, Xcorr_Spectrum &s) {
+  float axis[GESTURE_BUFFER_CAPACITY];
+  size_t n = g.size();
+  s.flat = false;
+  for (int i = 0; i < 3; i++) {
+    for (size_t j = 0; j < n; j++) axis[j] = g[j][i] * FEATURE_SCALE;
+    if (!xcorrAxisSpectrum(axis, n, s.bins[i])) s.flat = true;
+  }
+}
+
+/*******************************************************************************
+ *
+ * @brief Cross-correlation kernel for one template
+ * @param t: template
+ * @param lag: set to the best common shift of the probe, in samples
+ * @return the weakest of the three axis correlations at that shift
+ *
+ * ****************************************************************************/
+GestureScore KeyStore::crossCorrelate(const Template &t, int *lag) const {
+  TraceSpan span(TRACE_CORRELATION);
+  float r = xcorrBestLag(probe_spectrum, t.spectrum, XCORR_MAX_LAG, lag);
+#if GESTURE_FIXED_POINT
+  // NaN (no variation) never passes the threshold
+  if (!(r > -1.0f)) return -Q15_ONE;
+  return r < 1.0f ? (GestureScore)(r * 32768.0f) : Q15_ONE;
+#else
+  return r;
+#endif
+}
+#endif
+
+#if GESTURE_MATCHER == GESTURE_MATCHER_CASCADE
+/*******************************************************************************
+ *
+ * @brief Stage-one summary of a normalized gesture
+ * @param g: normalized gesture
+ * @param f: features to fill in
+ *
+ * ****************************************************************************/
+void KeyStore::extractFeatures(const GestureRecord &g, Gesture_Features &f) {
+  size_t n = g.size();
+  size_t segment_count[CASCADE_PAA_SEGMENTS] = {0};
+  int last_sign[3] = {0, 0, 0};
+  f.samples = n;
+  for (int i = 0; i < 3; i++) {
+    f.energy[i] = f.crossings[i] = 0.0f;
+    for (size_t k = 0; k < CASCADE_PAA_SEGMENTS; k++) f.paa[k][i] = 0.0f;
+  }
+
+  for (size_t j = 0; j < n; j++) {
+    GestureSample s = g[j];
+    size_t k = j * CASCADE_PAA_SEGMENTS / n;
+    segment_count[k]++;
+    for (int i = 0; i < 3; i++) {
+      float v = s[i] * FEATURE_SCALE;
+      f.energy[i] += v * v;
+      f.paa[k][i] += v;
+      if (v != 0.0f) {
+        int sign = v > 0.0f ? 1 : -1;
+        if (last_sign[i] != 0 && sign != last_sign[i]) f.crossings[i]++;
+        last_sign[i] = sign;
+      }
+    }
+  }
+
+  float total = f.energy[0] + f.energy[1] + f.energy[2];
+  for (int i = 0; i < 3; i++) {
+    if (total > 0.0f) f.energy[i] /= total;
+    if (n > 0) f.crossings[i] /= n;
+    for (size_t k = 0; k < CASCADE_PAA_SEGMENTS; k++) {
+      if (segment_count[k] > 0) f.paa[k][i] /= segment_count[k];
+    }
+  }
+}
+
+/*******************************************************************************
+ *
+ * @brief Stage one: could the two gestures be the same at all?
+ * @param a, b: features of the probe and of a template
+ * @return false if any feature is further apart than its CASCADE_MAX_* limit
+ *
+ * ****************************************************************************/
+bool KeyStore::featuresMatch(const Gesture_Features &a, const Gesture_Features &b) {
+  size_t shorter = a.samples < b.samples ? a.samples : b.samples;
+  size_t longer = a.samples < b.samples ? b.samples : a.samples;
+  if (shorter == 0 || longer > CASCADE_MAX_DURATION_RATIO * shorter) return false;
+
+  float energy = 0.0f, paa = 0.0f;
+  for (int i = 0; i < 3; i++) {
+    energy += fabsf(a.energy[i] - b.energy[i]);
+    if (fabsf(a.crossings[i] - b.crossings[i]) > CASCADE_MAX_CROSSING_DIFF) return false;
+    for (size_t k = 0; k < CASCADE_PAA_SEGMENTS; k++) paa += fabsf(a.paa[k][i] - b.paa[k][i]);
+  }
+  if (energy > CASCADE_MAX_ENERGY_DISTANCE) return false;
+  return paa / (3 * CASCADE_PAA_SEGMENTS) <= CASCADE_MAX_PAA_DISTANCE;
+}
+#endif
+
+/*******************************************************************************
+ *
+ * @brief LB_Keogh bound on dtwDistance(probe, template)
+ * @param probe: normalized probe
+ * @param t: template with its envelope
+ * @return a score no greater than the DTW distance
+ *
+ * Every warping path visits each probe row at least once, inside the band
+ * centred on the same column dtwBanded() uses. For unit vectors
+ * 1 - cos = |a - b|^2 / 2, so the squared distance from the probe sample to
+ * the envelope at that column bounds every cell of the row from below.
+ *
+ * ****************************************************************************/
+GestureScore KeyStore::lowerBound(const GestureRecord &probe, const Template &t) const {
+#if KEY_STORE_ENVELOPE
+  size_t n = probe.size(), m = t.samples.size();
+  if (n == 0 || m == 0) return SCORE_DTW_THRESHOLD + 1;
+
+  GestureScore total = 0;
+  for (size_t i = 0; i < n; i++) {
+    size_t centre = n > 1 ? (i * (m - 1) + (n - 1) / 2) / (n - 1) : 0;
+    GestureSample s = probe[i];
+#if GESTURE_FIXED_POINT
+    uint32_t sq = 0;
+    for (int k = 0; k < 3; k++) {
+      int32_t d = 0;
+      if (s[k] > t.upper[centre][k]) d = s[k] - t.upper[centre][k];
+      else if (s[k] < t.lower[centre][k]) d = t.lower[centre][k] - s[k];
+      sq += ((uint32_t)d * (uint32_t)d) >> 16;
+    }
+    // DTW floors each dot product, allow one LSB per row
+    total += sq > 0 ? (GestureScore)sq - 1 : 0;
+#else
+    float sq = 0.0f;
+    for (int k = 0; k < 3; k++) {
+      float d = 0.0f;
+      if (s[k] > t.upper[centre][k]) d = s[k] - t.upper[centre][k];
+      else if (s[k] < t.lower[centre][k]) d = t.lower[centre][k] - s[k];
+      sq += d * d;
+    }
+    total += 0.5f * sq;
+#endif
+  }
+  return total / (GestureScore)(n + m);
+#else
+  (void)probe;
+  (void)t;
+  return 0;
+#endif
+}
+
+/*******************************************************************************
+ *
+ * @brief Correlation kernel for one template
+ * @param probe: normalized probe, with probe_moments built
+ * @param t: template
+ * @return the weakest of the three axis correlations
+ *
+ * ****************************************************************************/
+#if KEY_STORE_MOMENTS
+GestureScore KeyStore::correlate(const GestureRecord &probe, const Template &t) const {
+  TraceSpan span(TRACE_CORRELATION);
+  // Common prefix of read-only views; the template side is all precomputed
+#if GESTURE_FIXED_POINT
+  GestureScore weakest = Q15_ONE;
+  for (int i = 0; i < 3; i++) {
+    GestureScore r = correlationPrefixQ15(probe.axis_view(i), probe_moments, t.samples.axis_view(i),
+                                          t.moments, i);
+    if (r < weakest) weakest = r;
+  }
+#else
+  size_t n = std::min(probe.size(), t.samples.size());
+  array<float, 3> r = correlationMoments(probe_moments, t.moments, n);
+  // NaN (no variation) never passes the threshold
+  GestureScore weakest = 1.0f;
+  for (int i = 0; i < 3; i++) {
+    if (!(r[i] >= weakest)) weakest = r[i];
+  }
+#endif
+  return weakest;
+}
+#endif
+
+/*******************************************************************************
+ *
+ * @brief DTW kernel for one template
+ * @param probe: normalized probe
+ * @param t: template
+ * @param limit: DTW distance at which to abandon
+ * @return DTW distance
+ *
+ * ****************************************************************************/
+#if KEY_STORE_ENVELOPE
+GestureScore KeyStore::warp(const GestureRecord &probe, const Template &t, GestureScore limit) const {
+  TraceSpan span(TRACE_CORRELATION);
+  return dtwDistance(probe, t.samples, DTW_BAND, limit);
+}
+#endif
+
+/*******************************************************************************
+ *
+ * @brief Match a probe against every template
+ * @param probe: trimmed recording, normalized in place
+ * @param result: best match and pruning counters
+ * @return true if some template passed the acceptance threshold
+ *
+ * With DTW the templates are visited in order of their lower bound and the
+ * best distance so far becomes the abandon limit, so the search stops as
+ * soon as the next bound cannot beat it. The correlation matcher does the
+ * same with its PAA upper bound against the best correlation so far. The
+ * cascade rules templates out by their features first, accepts or rejects
+ * clear correlations and leaves only the borderline ones to LB_Keogh and
+ * DTW; the best accepted template is the one with the strongest
+ * correlation. The cross-correlation matcher transforms the probe once and
+ * scores every template at its own best shift.
+ *
+ * ****************************************************************************/
+bool KeyStore::match(GestureRecord &probe, Key_Match_Result &result) const {
+  result.matched = false;
+  result.slot = 0;
+  result.user = 0;
+  result.compared = 0;
+  result.pruned = 0;
+
+  {
+    TraceSpan span(TRACE_NORMALIZE);
+    normalize(probe);
+  }
+
+#if GESTURE_MATCHER == GESTURE_MATCHER_DTW
+  GestureScore bound[KEY_STORE_CAPACITY];
+  size_t order[KEY_STORE_CAPACITY];
+  for (size_t i = 0; i < count_; i++) {
+    bound[i] = lowerBound(probe, templates_[i]);
+
+    // Insertion sort, the store is small
+    size_t k = i;
+    while (k > 0 && bound[order[k - 1]] > bound[i]) {
+      order[k] = order[k - 1];
+      k--;
+    }
+    order[k] = i;
+  }
+
+  GestureScore best = SCORE_DTW_THRESHOLD;
+  result.score = best;
+  for (size_t k = 0; k < count_; k++) {
+    size_t slot = order[k];
+    if (bound[slot] > best) {
+      result.pruned = count_ - k;
+      break;
+    }
+
+    GestureScore distance = warp(probe, templates_[slot], best);
+    result.compared++;
+    if (distance <= best) {
+      best = distance;
+      result.matched = true;
+      result.slot = slot;
+      result.user = templates_[slot].user;
+      result.score = distance;
+    }
+  }
+#elif GESTURE_MATCHER == GESTURE_MATCHER_CASCADE
+  probe_moments.build(probe);
+  extractFeatures(probe, probe_features);
+  cascade_.attempts++;
+  result.score = 0;
+  for (size_t slot = 0; slot < count_; slot++) {
+    const Template &t = templates_[slot];
+    if (!featuresMatch(probe_features, t.features)) {
+      cascade_.feature_rejects++;
+      result.pruned++;
+      continue;
+    }
+
+    GestureScore weakest = correlate(probe, t);
+    cascade_.correlations++;
+    result.compared++;
+    if (weakest > SCORE_CORRELATION_THRESHOLD) {
+      cascade_.correlation_accepts++;
+    } else if (!(weakest >= SCORE_BORDER_CORRELATION)) {
+      cascade_.correlation_rejects++;
+      continue;
+    } else if (lowerBound(probe, t) > SCORE_DTW_THRESHOLD) {
+      cascade_.dtw_bounded++;
+      continue;
+    } else {
+      cascade_.dtw_runs++;
+      if (warp(probe, t, SCORE_DTW_THRESHOLD) > SCORE_DTW_THRESHOLD) continue;
+      cascade_.dtw_accepts++;
+    }
+
+    if (!result.matched || weakest > result.score) {
+      result.matched = true;
+      result.slot = slot;
+      result.user = t.user;
+      result.score = weakest;
+    }
+  }
+#elif GESTURE_MATCHER == GESTURE_MATCHER_XCORR
+  buildSpectrum(probe, probe_spectrum);
+  result.score = SCORE_XCORR_THRESHOLD;
+  result.lag = 0;
+  for (size_t slot = 0; slot < count_; slot++) {
+    int lag;
+    GestureScore weakest = crossCorrelate(templates_[slot], &lag);
+    result.compared++;
+    if (weakest > result.score) {
+      result.matched = true;
+      result.slot = slot;
+      result.user = templates_[slot].user;
+      result.score = weakest;
+      result.lag = lag;
+    }
+  }
+#else
+  probe_moments.build(probe);
+  buildPaa(probe, probe_paa);
+  GestureScore bound[KEY_STORE_CAPACITY];
+  size_t order[KEY_STORE_CAPACITY];
+  for (size_t i = 0; i < count_; i++) {
+    bound[i] = correlationBound(probe, templates_[i]);
+
+    // Insertion sort, highest bound first
+    size_t k = i;
+    while (k > 0 && bound[order[k - 1]] < bound[i]) {
+      order[k] = order[k - 1];
+      k--;
+    }
+    order[k] = i;
+  }
+
+  result.score = SCORE_CORRELATION_THRESHOLD;
+  for (size_t k = 0; k < count_; k++) {
+    size_t slot = order[k];
+    if (!(bound[slot] > result.score)) {
+      result.pruned = count_ - k;
+      break;
+    }
+
+    GestureScore weakest = correlate(probe, templates_[slot]);
+    result.compared++;
+    if (weakest > result.score) {
+      result.matched = true;
+      result.slot = slot;
+      result.user = templates_[slot].user;
+      result.score = weakest;
+    }
+  }
+#endif
+  return result.matched;
+}
@@ -0,0 +1,230 @@
+/**
+ * @file key_store.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Multi-template gesture key store with a lower-bound pruning index
+ * for the embedded sentry project.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef KEY_STORE_H
+#define KEY_STORE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "fixed_point.h"
+#include "gesture_buffer.h"
+#include "system_config.h"
+#include "utilities.h"
+#include "xcorr.h"
+
+// Gesture sample/record types for the selected pipeline. A score is a
+// correlation (higher is better) or a DTW distance (lower is better).
+#if GESTURE_FIXED_POINT
+typedef GestureSampleQ15 GestureSample;
+typedef GestureBufferQ15 GestureRecord;
+typedef PrefixSumsQ15 GestureMoments;
+typedef int32_t GestureScore;
+#else
+typedef std::array<float, 3> GestureSample;
+typedef GestureBuffer GestureRecord;
+typedef PrefixMoments GestureMoments;
+typedef float GestureScore;
+#endif
+
+// Per-template index: prefix moments for the correlation kernel, plus a PAA
+// summary for its upper bound in the correlation matcher; LB_Keogh envelope
+// for DTW, the cascade needs both; the cross-correlation matcher keeps
+// spectra instead
+#define KEY_STORE_MOMENTS \
+  (GESTURE_MATCHER == GESTURE_MATCHER_CORRELATION || GESTURE_MATCHER == GESTURE_MATCHER_CASCADE)
+#define KEY_STORE_PAA (GESTURE_MATCHER == GESTURE_MATCHER_CORRELATION)
+#define KEY_STORE_ENVELOPE \
+  (GESTURE_MATCHER == GESTURE_MATCHER_DTW || GESTURE_MATCHER == GESTURE_MATCHER_CASCADE)
+
+#if KEY_STORE_PAA
+constexpr size_t CORRELATION_PAA_BLOCKS = GESTURE_BUFFER_CAPACITY / CORRELATION_PAA_BLOCK;
+
+// Piecewise aggregate summary of a normalized gesture: per-axis mean and
+// root of the sum of squared deviations of every full block of
+// CORRELATION_PAA_BLOCK samples
+typedef struct {
+  float mean[3][CORRELATION_PAA_BLOCKS];
+  float root_m2[3][CORRELATION_PAA_BLOCKS];
+} Gesture_Paa;
+#endif
+
+#if GESTURE_MATCHER == GESTURE_MATCHER_CASCADE
+// Cascade stage 1 summary of a normalized gesture
+typedef struct {
+  size_t samples;                          // duration at the working rate
+  float energy[3];                         // share of the total energy per axis
+  float crossings[3];                      // sign changes per sample
+  float paa[CASCADE_PAA_SEGMENTS][3];      // piecewise aggregate means
+} Gesture_Features;
+
+// Where the cascade decided, accumulated over match() calls
+typedef struct {
+  uint32_t attempts;             // match() calls
+  uint32_t feature_rejects;      // templates ruled out by stage 1
+  uint32_t correlations;         // templates that reached stage 2
+  uint32_t correlation_accepts;  // accepted by the correlation alone
+  uint32_t correlation_rejects;  // rejected by the correlation alone
+  uint32_t dtw_bounded;          // borderline, rejected by LB_Keogh
+  uint32_t dtw_runs;             // borderline, DTW computed
+  uint32_t dtw_accepts;          // borderline, accepted by DTW
+} Key_Cascade_Stats;
+#endif
+
+// Outcome of matching one probe against the store
+typedef struct {
+  bool matched;           // some template passed the acceptance threshold
+  size_t slot;            // best template, valid when matched
+  uint8_t user;           // owner of the best template, valid when matched
+  GestureScore score;     // score of the best template
+  size_t compared;        // templates that ran the full matching kernel
+  size_t pruned;          // templates rejected by the lower bound alone
+#if GESTURE_MATCHER == GESTURE_MATCHER_XCORR
+  int lag;                // probe shift against the best template, samples
+#endif
+} Key_Match_Result;
+
+/**
+ * @brief Holds up to KEY_STORE_CAPACITY enrolled templates, normalized once
+ * at enrollment and read-only from then on. With the correlation matcher
+ * every template keeps its per-axis prefix moments, so matching a probe of
+ * any length only processes the probe and the cross products, and a PAA
+ * summary whose upper bound on the correlation rejects most templates from
+ * one product per block instead of one per sample. With the DTW
+ * matcher every template keeps an LB_Keogh envelope (per-axis min/max over
+ * the warping band) instead, so a probe is checked against the cheapest
+ * bound first and most templates are rejected without running DTW. The
+ * cascade keeps both plus a small feature vector, and only spends a kernel
+ * on the templates the cheaper stage before it could not decide. The
+ * cross-correlation matcher keeps the padded spectrum of every axis, so a
+ * probe costs three forward transforms and each template three inverse ones.
+ */
+class KeyStore {
+ public:
+#if GESTURE_MATCHER == GESTURE_MATCHER_CASCADE
+  KeyStore() : count_(0), next_sequence_(0), cascade_() {}
+#else
+  KeyStore() : count_(0), next_sequence_(0) {}
+#endif
+
+  KeyStore(const KeyStore &) = delete;
+  KeyStore &operator=(const KeyStore &) = delete;
+
+  /**
+   * @brief Enroll a recording, evicting the oldest template when full
+   * @param record: trimmed recording; its samples are moved into the store
+   * @param user: owner tag stored with the template
+   * @return slot the template was stored in
+   */
+  size_t enroll(GestureRecord &record, uint8_t user);
+
+  /**
+   * @brief Append an already normalized template, e.g. one loaded from
+   * persistent storage, keeping its enrollment order
+   * @param record: normalized recording; its samples are moved into the store
+   * @param user: owner tag stored with the template
+   * @param sequence: enrollment sequence number saved with the template
+   * @return slot the template was stored in, or capacity() if full
+   */
+  size_t restore(GestureRecord &record, uint8_t user, uint32_t sequence);
+
+  /**
+   * @brief Match a probe against every template
+   * @param probe: trimmed recording, normalized in place
+   * @param result: best match and pruning counters
+   * @return true if some template passed the acceptance threshold
+   */
+  bool match(GestureRecord &probe, Key_Match_Result &result) const;
+
+  /**
+   * @brief Remove a single template
+   * @param slot: slot to free
+   */
+  void remove(size_t slot);
+
+  void clear() { count_ = 0; }
+  size_t size() const { return count_; }
+  bool empty() const { return count_ == 0; }
+  bool full() const { return count_ == KEY_STORE_CAPACITY; }
+  static constexpr size_t capacity() { return KEY_STORE_CAPACITY; }
+  // RAM per slot, whether or not it holds a template
+  static constexpr size_t template_bytes() { return sizeof(Template); }
+
+  const GestureRecord &samples(size_t slot) const { return templates_[slot].samples; }
+#if KEY_STORE_MOMENTS
+  const GestureMoments &moments(size_t slot) const { return templates_[slot].moments; }
+#endif
+  uint8_t user(size_t slot) const { return templates_[slot].user; }
+  uint32_t sequence(size_t slot) const { return templates_[slot].sequence; }
+
+#if GESTURE_MATCHER == GESTURE_MATCHER_CASCADE
+  const Key_Cascade_Stats &cascadeStats() const { return cascade_; }
+  void resetCascadeStats() { cascade_ = Key_Cascade_Stats(); }
+#endif
+
+ private:
+  struct Template {
+    GestureRecord samples;  // normalized recording
+#if KEY_STORE_ENVELOPE
+    GestureSample upper[GESTURE_BUFFER_CAPACITY];  // LB_Keogh envelope
+    GestureSample lower[GESTURE_BUFFER_CAPACITY];
+#endif
+#if KEY_STORE_MOMENTS
+    GestureMoments moments;  // per-axis prefix statistics of samples
+#endif
+#if KEY_STORE_PAA
+    Gesture_Paa paa;  // block summary of samples for correlationBound()
+#endif
+#if GESTURE_MATCHER == GESTURE_MATCHER_CASCADE
+    Gesture_Features features;
+#endif
+#if GESTURE_MATCHER == GESTURE_MATCHER_XCORR
+    Xcorr_Spectrum spectrum;  // per-axis spectra of samples
+#endif
+    uint32_t sequence;  // enrollment order, oldest is evicted first
+    uint8_t user;
+  };
+
+  void buildIndex(Template &t);
+  GestureScore lowerBound(const GestureRecord &probe, const Template &t) const;
+#if KEY_STORE_MOMENTS
+  GestureScore correlate(const GestureRecord &probe, const Template &t) const;
+#endif
+#if KEY_STORE_PAA
+  static void buildPaa(const GestureRecord &g, Gesture_Paa &p);
+  GestureScore correlationBound(const GestureRecord &probe, const Template &t) const;
+#endif
+#if KEY_STORE_ENVELOPE
+  GestureScore warp(const GestureRecord &probe, const Template &t, GestureScore limit) const;
+#endif
+#if GESTURE_MATCHER == GESTURE_MATCHER_CASCADE
+  static void extractFeatures(const GestureRecord &g, Gesture_Features &f);
+  static bool featuresMatch(const Gesture_Features &a, const Gesture_Features &b);
+#endif
+#if GESTURE_MATCHER == GESTURE_MATCHER_XCORR
+  static void buildSpectrum(const GestureRecord &g, Xcorr_Spectrum &s);
+  GestureScore crossCorrelate(const Template &t, int *lag) const;
+#endif
+
+  Template templates_[KEY_STORE_CAPACITY];  // live templates are [0, count_)
+  size_t count_;
+  uint32_t next_sequence_;
+#if GESTURE_MATCHER == GESTURE_MATCHER_CASCADE
+  mutable Key_Cascade_Stats cascade_;
+#endif
+};
+
+#endif  // KEY_STORE_H
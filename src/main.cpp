@@ -16,60 +16,145 @@
 #include <vector>                     // For vector usage
 #include <array>                      // For array usage
 #include "utilities.h"                // Utility functions
+#include "key_store.h"                // Enrolled gesture templates
+#include "key_storage.h"              // EEPROM key persistence
+#include "streaming_matcher.h"        // Early unlock decisions
+#include "segmenter.h"                // Motion-triggered recording
 #include "gyro.h"                     // Gyroscope functions
+#include "pipeline.h"                 // Sample filtering and decimation
+#include "acquisition.h"              // Interrupt-driven sample ring
+#include "sampler.h"                  // Deadline-paced per-sample reads
+#include "ui.h"                       // Display thread
+#include "trace.h"                    // Pipeline timing spans
+#include "telemetry.h"                // Binary console stream
+#include "memstats.h"                 // Heap and stack report
+#include "archive.h"                  // Unlock attempt archive
+#include "ccm.h"                      // Core-coupled memory
 #include "system_config.h"            // System configuration
 #include "drivers/LCD_DISCO_F429ZI.h" // LCD driver
 #include "drivers/TS_DISCO_F429ZI.h"  // Touch screen driver
 
 InterruptIn gyroscope_interrupt(PA_2, PullDown);
+#if GYRO_INT1_USED
+InterruptIn motion_interrupt(GYRO_INT1_PIN, PullDown);
+#endif
 InterruptIn user_command_button(USER_BUTTON, PullDown);
+InterruptIn touch_interrupt(TOUCH_INTERRUPT_PIN, PullUp); // STMPE811 INT, active low
 
 DigitalOut led_status_green(LED1);
 DigitalOut led_status_red(LED2);
 
-LCD_DISCO_F429ZI lcd; // LCD object
 TS_DISCO_F429ZI ts;   // Touch screen object
 
 EventFlags flags; // Event flags
 
 Timer timer; // Timer
 
-float movingAverageFilter(float new_value, std::array<float, WINDOW_SIZE>& buffer, size_t& index, float& sum);
-void normalize(vector<array<float, 3>>& data);
-
-// Global variables for moving average filter
-float gyro_buffer_x[WINDOW_SIZE] = {0};  // Buffers for x, y, z data
-float gyro_buffer_y[WINDOW_SIZE] = {0};
-float gyro_buffer_z[WINDOW_SIZE] = {0};
-size_t gyro_index_x = 0, gyro_index_y = 0, gyro_index_z = 0;  // Index for each buffer
-float gyro_sum_x = 0, gyro_sum_y = 0, gyro_sum_z = 0;  // Sum for each axis
+bool recording_done(bool streaming);
+bool recording_settled(uint32_t timestamp_us);
+void keep_sample(const GestureSample &sample, bool streaming);
 
 /*******************************************************************************
  * Function Prototypes of LCD and Touch Screen
  * ****************************************************************************/
-void draw_button(int x, int y, int width, int height, const char *label);
 bool is_touch_inside_button(int touch_x, int touch_y, int button_x, int button_y, int button_width, int button_height);
 
 void gyroscope_thread();
 void touch_screen_thread();
 
+/*******************************************************************************
+ * Idle State
+ * ****************************************************************************/
+enum Wake_Source
+{
+    WAKE_MOTION,
+    WAKE_TOUCH,
+    WAKE_BUTTON
+};
+
+volatile bool idle = false;        // display, console and gyroscope asleep
+volatile bool touch_woke = false;  // the next touch only woke the device
+volatile uint8_t wake_source = WAKE_BUTTON;
+volatile uint32_t wake_time_us = 0; // ticker value of the wake-up interrupt
+
+/*******************************************************************************
+ * Unlock Latency
+ * ****************************************************************************/
+volatile uint32_t touch_time_us = 0; // ticker value of the last touch interrupt
+uint32_t unlock_tap_us = 0;          // the touch that asked for the unlock in progress
+uint32_t unlock_settle_us = 0;       // samples before this are not recorded
+bool unlock_ready_pending = false;   // tap-to-ready not reported yet for this attempt
+bool unlock_fast = false;            // the attempt took the fast unlock path
+
+/*******************************************************************************
+ * Boot Phases
+ * ****************************************************************************/
+// us_ticker times of the start-up phases, reported once the sentry is ready
+uint32_t boot_main_us = 0;    // main() entered, after the static constructors
+uint32_t boot_display_us = 0; // LCD up; with FAST_BOOT the clears still run
+uint32_t boot_keys_us = 0;    // templates loaded from the EEPROM
+uint32_t boot_gyro_us = 0;    // gyroscope configured, calibrated if needed
+
+void report_boot();
+
+#if IDLE_ENABLE
+void idle_until_wake(Gyroscope_Init_Parameters *init_parameters, Gyroscope_RawData *raw_data);
+#endif
+
+// Leave the idle state from an ISR; false if the device was awake already
+bool wake_up(Wake_Source source)
+{
+    if (!idle)
+    {
+        return false;
+    }
+    idle = false;
+    wake_source = source;
+    wake_time_us = us_ticker_read();
+    flags.set(WAKE_FLAG);
+    return true;
+}
+
 /*******************************************************************************
  * ISR Callback Functions
  * ****************************************************************************/
 void button_press() // Callback function for button press
 {
-    flags.set(ERASE_FLAG);
+    if (!wake_up(WAKE_BUTTON))
+    {
+        flags.set(ERASE_FLAG);
+    }
 }
 void onGyroDataReady() // Gyroscope data ready ISR
 {
     flags.set(DATA_READY_FLAG);
 }
+void onTouchInterrupt() // Touch controller ISR
+{
+    touch_time_us = us_ticker_read();
+    if (wake_up(WAKE_TOUCH))
+    {
+        touch_woke = true;
+    }
+    flags.set(TOUCH_FLAG);
+}
+void onMotionWake() // Gyroscope INT1 ISR while idle
+{
+    wake_up(WAKE_MOTION);
+}
 
 /*******************************************************************************
  * @brief Global Variables
  * ****************************************************************************/
-vector<array<float, 3>> gesture_key;      // the gesture key
-vector<array<float, 3>> unlocking_record; // the unlocking record
+KeyStore key_store CCM_DATA;    // enrolled gesture keys
+#if GESTURE_STREAMING_ACTIVE
+StreamingMatcher stream_matcher; // decides unlocks during the recording
+#endif
+#if GESTURE_SEGMENT
+GestureSegmenter segmenter;     // finds the gesture's start and end
+#endif
+GestureRecord unlocking_record CCM_DATA; // the unlocking record
+GestureRecord temp_key CCM_DATA;         // recording in progress
 
 const int button1_x = 60;
 const int button1_y = 80;
@@ -84,8 +169,6 @@ const char *button2_label = "UNLOCK";
 const int message_x = 5;
 const int message_y = 30;
 const char *message = "EMBEDDED SENTRY";
-const int text_x = 5;
-const int text_y = 270;
 const char *text_0 = "NO KEY RECORDED";
 const char *text_1 = "LOCKED";
 
@@ -94,71 +177,576 @@ const char *text_1 = "LOCKED";
  * ****************************************************************************/
 int main()
 {
-    lcd.Clear(LCD_COLOR_BLACK);
+    boot_main_us = us_ticker_read();
+
+    // Console and sample stream on the UART DMA
+    TelemetryInit();
+
+    // Cycle counter first, so the boot-time spans are timed too
+    TraceInit();
+
+    // The UI thread owns the LCD from here on
+    UiInit(LCD_COLOR_BLACK);
+    boot_display_us = us_ticker_read();
+
+    // The LCD driver has brought the SDRAM up
+    ArchiveInit();
 
     // Draw button 1
-    draw_button(button1_x, button1_y, button1_width, button1_height, button1_label);
+    UiButton(UI_REGION_BUTTON_1, button1_x, button1_y, button1_width, button1_height, LCD_COLOR_RED, button1_label);
 
     // Draw button 2
-    draw_button(button2_x, button2_y, button2_width, button2_height, button2_label);
+    UiButton(UI_REGION_BUTTON_2, button2_x, button2_y, button2_width, button2_height, LCD_COLOR_RED, button2_label);
 
     // Display the welcome message
-    lcd.DisplayStringAt(message_x, message_y, (uint8_t *)message, CENTER_MODE);
+    UiText(UI_REGION_TITLE, message_x, message_y, LCD_COLOR_RED, message);
 
     // initialize all interrupts
     user_command_button.rise(&button_press);
+#if GYRO_USE_FIFO && GYRO_SPI_ASYNC
+    AcquisitionInit(gyroscope_interrupt, flags, SAMPLES_READY_FLAG);
+#if GYRO_HW_MOTION
+    AcquisitionGateOnMotion(motion_interrupt);
+#endif
+#elif GYRO_USE_FIFO
     gyroscope_interrupt.rise(&onGyroDataReady);
+#else
+    SamplerInit(gyroscope_interrupt, flags, SAMPLES_READY_FLAG);
+#endif
+
+    // Only the EEPROM directory is read here, the templates follow below
+    size_t stored_keys = KeyStorageInit();
 
-    if (gesture_key.empty())
+    // A stored bias saves calibrating again after every reset
+    Gyroscope_Calibration stored_calibration;
+    if (KeyStorageLoadCalibration(stored_calibration))
+    {
+        SetGyroscopeCalibration(stored_calibration);
+    }
+
+    if (stored_keys == 0)
     {
         led_status_red = 0;
         led_status_green = 1;  // Green LED indicates ready to record
-        lcd.SetTextColor(LCD_COLOR_GREEN);
-        lcd.DisplayStringAt(text_x, text_y, (uint8_t *)text_0, CENTER_MODE);
+        UiStatus(LCD_COLOR_GREEN, "%s", text_0);
     }
     else
     {
         led_status_red = 1;    // Red LED indicates locked
         led_status_green = 0;
-        lcd.SetTextColor(LCD_COLOR_RED);
-        lcd.DisplayStringAt(text_x, text_y, (uint8_t *)text_1, CENTER_MODE);
+        UiStatus(LCD_COLOR_RED, "%s", text_1);
     }
 
-    // Create the gyroscope thread
-    Thread key_saving;
+    // Create the gyroscope thread, its stack in CCM (nothing on it goes to DMA).
+    // It brings the sensor up while the templates load below and takes no
+    // request before BOOT_FLAG.
+    MBED_ALIGN(8) static unsigned char gyro_thread_stack[GYRO_THREAD_STACK_SIZE] CCM_NOINIT;
+    Thread key_saving(osPriorityNormal, GYRO_THREAD_STACK_SIZE, gyro_thread_stack, "gyro");
     key_saving.start(callback(gyroscope_thread));
 
+    // Screen already says LOCKED; the bodies load before any input is read
+    if (stored_keys > 0)
+    {
+        KeyStorageLoad(key_store);
+    }
+    boot_keys_us = us_ticker_read();
+    flags.set(BOOT_FLAG);
+
     // Create the touch screen thread
-    Thread touch_thread;
+    Thread touch_thread(osPriorityNormal, TOUCH_THREAD_STACK_SIZE, nullptr, "touch");
     touch_thread.start(callback(touch_screen_thread));
 
-    // keep main thread alive
+    // The main thread serves trace, memory and archive commands from the console;
+    // getchar() sleeps until a character arrives
     while (1)
     {
-        ThisThread::sleep_for(100ms);
+        int command = getchar();
+        if (command == 't')
+        {
+            TraceDump();
+        }
+        else if (command == 'r')
+        {
+            TraceReset();
+            printf("trace: reset\n");
+        }
+        else if (command == 'm')
+        {
+            MemStatsDump(key_store);
+        }
+        else if (command == 'a')
+        {
+            ArchiveExport();
+        }
+    }
+}
+
+/*******************************************************************************
+ * Controller State Machine
+ *
+ * The gyroscope thread runs the sentry as one state machine. Every request,
+ * sample batch and timeout arrives through a single wait on the event flags,
+ * with the current state's deadline as the timeout, so a request is acted
+ * on at once in every state:
+ *
+ *   IDLE      -> ARMING     on a record or unlock request
+ *   ARMING    -> RECORDING  when the prompts and the countdown are over
+ *   RECORDING -> MATCHING   when recording_done()
+ *   MATCHING  -> RESULT     straight away, enroll or match the recording
+ *   RESULT    -> IDLE       after CONTROLLER_RESULT_MS
+ *
+ * Erase pre-empts any state. The request in progress asked for again
+ * cancels the attempt, the other one replaces it; in RESULT a new request
+ * starts the next attempt without waiting for the timeout.
+ * ****************************************************************************/
+enum Sentry_State
+{
+    STATE_IDLE,      // waiting for a request
+    STATE_ARMING,    // prompts, calibration and countdown
+    STATE_RECORDING, // acquisition running, samples drained as they arrive
+    STATE_MATCHING,  // trimming, then enrolling or matching the recording
+    STATE_RESULT     // outcome on screen
+};
+
+struct Sentry_Controller
+{
+    Sentry_State state;
+    uint32_t request;           // KEY_FLAG or UNLOCK_FLAG of the attempt in progress
+    bool has_deadline;
+    uint32_t deadline_us;       // timeout of the current state or arming step
+    int countdown;              // countdown prompts still to show
+    bool calibrate_pending;     // calibrate once the tap has settled (first arming step)
+    bool streaming;             // unlock matched while it is recorded
+    bool archiving;             // unlock trace kept in the archive
+    size_t decimation_count;
+    Gyroscope_Init_Parameters *init_parameters;
+    Gyroscope_RawData *raw_data;
+};
+
+// Samples to drain while recording
+#if GYRO_USE_FIFO && !GYRO_SPI_ASYNC
+#define RECORD_EVENT_FLAG DATA_READY_FLAG    // FIFO watermark, read on this thread
+#else
+#define RECORD_EVENT_FLAG SAMPLES_READY_FLAG // batch waiting in gyro_ring
+#endif
+
+static const char *const state_names[] = {"idle", "arming", "recording", "matching", "result"};
+
+static void controller_enter(Sentry_Controller &c, Sentry_State state, uint32_t timeout_ms)
+{
+    c.state = state;
+    c.has_deadline = timeout_ms > 0;
+    c.deadline_us = us_ticker_read() + timeout_ms * 1000;
+}
+
+static void controller_idle(Sentry_Controller &c)
+{
+    controller_enter(c, STATE_IDLE, IDLE_ENABLE ? IDLE_TIMEOUT_MS : 0);
+}
+
+// Re-calibrate only if the cached bias is stale
+static void controller_calibrate(Sentry_Controller &c)
+{
+    if (GyroscopeNeedsCalibration())
+    {
+        UiStatus(LCD_COLOR_LIGHTGRAY, "Calibrating...");
+    }
+    if (InitiateGyroscope(c.init_parameters, c.raw_data))
+    {
+        KeyStorageSaveCalibration(GetGyroscopeCalibration());
+    }
+}
+
+// Start the acquisition; the samples are drained as their events arrive
+static void controller_record(Sentry_Controller &c)
+{
+    temp_key.clear();
+
+    // Unlock attempts are matched while they are being recorded
+    c.streaming = c.request == UNLOCK_FLAG && !key_store.empty() && GESTURE_STREAMING_ACTIVE;
+#if GESTURE_STREAMING_ACTIVE
+    if (c.streaming)
+    {
+        stream_matcher.begin(key_store);
+    }
+#endif
+
+    if (!unlock_fast)
+    {
+        UiStatus(LCD_COLOR_GREEN, GESTURE_SEGMENT ? "Move now..." : "Recording...");
+    }
+
+    c.decimation_count = 0;
+    filter_reset();
+#if GYRO_USE_FIFO && GYRO_SPI_ASYNC
+    // The watermark ISR and SPI completion, or the sampler's paced reads,
+    // fill gyro_ring on their own; this thread only drains it in batches, so
+    // a slow LCD update delays processing instead of losing samples or
+    // stretching the sample period
+    AcquisitionStart(); // drop samples buffered while arming
+#elif GYRO_USE_FIFO
+    FlushFifo(); // drop samples buffered while arming
+#else
+    SamplerStart();
+#endif
+    // Unlock attempts keep their full-rate trace for threshold tuning. The
+    // synchronous FIFO reads carry no timestamps and are not archived.
+    c.archiving = c.request == UNLOCK_FLAG && !(GYRO_USE_FIFO && !GYRO_SPI_ASYNC);
+    if (c.archiving)
+    {
+        ArchiveBegin();
+    }
+    unlock_ready_pending = c.request == UNLOCK_FLAG;
+    unlock_settle_us = unlock_fast ? unlock_tap_us + FAST_UNLOCK_SETTLE_MS * 1000 : us_ticker_read();
+    timer.start();
+
+    // Bounded wait: with GYRO_HW_MOTION nothing arrives while the board is
+    // still, and the segmenter's start timeout needs checking anyway
+    controller_enter(c, STATE_RECORDING, CONTROLLER_POLL_MS);
+}
+
+// Set up a record or unlock attempt; prompts and countdown steps become
+// deadlines instead of sleeps
+static void controller_arm(Sentry_Controller &c, uint32_t request)
+{
+    c.request = request;
+
+    // Fast unlock: the sensor is still configured from boot, the last
+    // attempt or the idle wake, so with a valid bias there is nothing to set
+    // up before arming
+    unlock_fast = FAST_UNLOCK && request == UNLOCK_FLAG && GetGyroscopeCalibration().valid;
+    if (unlock_fast)
+    {
+        UiStatus(LCD_COLOR_GREEN, GESTURE_SEGMENT ? "Move now..." : "Get ready...");
+        if (GyroscopeNeedsCalibration())
+        {
+            printf("unlock: reusing a stale bias\n");
+        }
+#if GESTURE_SEGMENT
+        segmenter.reset();
+#endif
+        controller_record(c);
+        return;
+    }
+
+#if GESTURE_SEGMENT
+    // No countdown: recording starts when the board starts moving. The tap
+    // on the screen is not part of the gesture, and a calibration waits for
+    // it to die down too.
+    segmenter.reset();
+    c.countdown = 0;
+    c.calibrate_pending = true;
+    controller_enter(c, STATE_ARMING, SEGMENT_ARM_MS);
+#else
+    UiStatus(LCD_COLOR_ORANGE, "Hold On");
+    c.countdown = 3;
+    c.calibrate_pending = true;
+    controller_enter(c, STATE_ARMING, 1000);
+#endif
+}
+
+// Arming deadline: next countdown step, or start recording
+static void controller_arm_step(Sentry_Controller &c)
+{
+    if (c.calibrate_pending)
+    {
+        c.calibrate_pending = false;
+        controller_calibrate(c);
+    }
+    if (c.countdown > 0)
+    {
+        UiStatus(LCD_COLOR_ORANGE, "Recording in %d...", c.countdown);
+        c.countdown--;
+        controller_enter(c, STATE_ARMING, 1000);
+        return;
+    }
+    controller_record(c);
+}
+
+// Stop the acquisition of the attempt in progress
+static void controller_stop_acquisition(Sentry_Controller &c)
+{
+#if GYRO_USE_FIFO && GYRO_SPI_ASYNC
+    AcquisitionStop();
+#elif !GYRO_USE_FIFO
+    SamplerStop();
+#endif
+    timer.stop();
+    timer.reset();
+    unlock_ready_pending = false;
+}
+
+// Drop the attempt in progress, if any
+static void controller_abort(Sentry_Controller &c)
+{
+    if (c.state == STATE_RECORDING)
+    {
+        controller_stop_acquisition(c);
+        if (c.archiving)
+        {
+            ArchiveEnd(false, NAN);
+        }
+    }
+    if (c.state == STATE_ARMING || c.state == STATE_RECORDING)
+    {
+        printf("controller: %s cancelled while %s\n", c.request == KEY_FLAG ? "record" : "unlock",
+               state_names[c.state]);
+    }
+    temp_key.clear();
+}
+
+static void controller_result(Sentry_Controller &c)
+{
+    controller_enter(c, STATE_RESULT, CONTROLLER_RESULT_MS);
+}
+
+// Save the recording as a key, replacing the oldest when the store is full
+static void controller_enroll()
+{
+    bool replacing = key_store.full();
+    UiStatus(LCD_COLOR_LIGHTGREEN, replacing ? "Replacing old key..." : "Saving Key...");
+
+    size_t slot = key_store.enroll(temp_key, KEY_STORE_DEFAULT_USER);
+    if (!KeyStorageSave(key_store, slot))
+    {
+        printf("key %u not persisted\n", (unsigned)slot);
+    }
+
+    led_status_red = 1;
+    led_status_green = 0;
+
+    if (replacing)
+    {
+        UiStatus(LCD_COLOR_LIGHTGREEN, "New key saved.");
+    }
+    else
+    {
+        UiStatus(LCD_COLOR_LIGHTGREEN, "Key %u/%u saved.", (unsigned)key_store.size(),
+                 (unsigned)key_store.capacity());
+    }
+}
+
+// Match the recording against the enrolled keys
+static void controller_unlock(Sentry_Controller &c)
+{
+    UiStatus(LCD_COLOR_LIGHTGRAY, "Unlocking...");
+
+    unlocking_record.swap(temp_key);
+    temp_key.clear();
+
+    if (key_store.empty())
+    {
+        UiStatus(LCD_COLOR_RED, "NO KEY SAVED.");
+        ArchiveEnd(false, NAN);
+
+        unlocking_record.clear();
+        led_status_green = 1;
+        led_status_red = 0;
+        return;
+    }
+
+#if GESTURE_STREAMING_ACTIVE
+    // Already decided, or decidable from the running sums
+    bool unlocked = stream_matcher.finish() == STREAM_ACCEPT;
+    printf("unlock: decided after %u samples\n", (unsigned)stream_matcher.samples());
+    float score = stream_matcher.score();
+#else
+    // Best match over all enrolled templates
+    Key_Match_Result match;
+    bool unlocked = key_store.match(unlocking_record, match);
+    printf("unlock: %u templates, %u compared, %u pruned\n",
+           (unsigned)key_store.size(), (unsigned)match.compared, (unsigned)match.pruned);
+    float score = GESTURE_FIXED_POINT ? match.score / 32768.0f : match.score;
+#if GESTURE_MATCHER == GESTURE_MATCHER_CASCADE
+    const Key_Cascade_Stats &cascade = key_store.cascadeStats();
+    printf("cascade: %lu features rejected, %lu/%lu correlation accepted/rejected, %lu/%lu DTW runs/accepted\n",
+           (unsigned long)cascade.feature_rejects, (unsigned long)cascade.correlation_accepts,
+           (unsigned long)cascade.correlation_rejects, (unsigned long)cascade.dtw_runs,
+           (unsigned long)cascade.dtw_accepts);
+#elif GESTURE_MATCHER == GESTURE_MATCHER_XCORR
+    if (unlocked)
+    {
+        printf("xcorr: best shift %d samples\n", match.lag);
+    }
+#endif
+#endif
+
+    ArchiveEnd(unlocked, score);
+
+    // Update the display and LED status based on unlock result
+    if (unlocked)
+    {
+        UiStatus(LCD_COLOR_GREEN, "UNLOCK: SUCCESS");
+
+        led_status_green = 1;
+        led_status_red = 0;
+    }
+    else
+    {
+        UiStatus(LCD_COLOR_RED, "UNLOCK: FAILED");
+
+        led_status_green = 0;
+        led_status_red = 1;
+    }
+
+    unlocking_record.clear();
+}
+
+// The recording is over: trim it, then enroll or match it
+static void controller_match(Sentry_Controller &c)
+{
+    auto recording_time = timer.elapsed_time();
+    controller_stop_acquisition(c);
+#if GYRO_USE_FIFO && GYRO_SPI_ASYNC
+    Acquisition_Stats stats = GetAcquisitionStats();
+    printf("acquisition: %lu samples, %lu overruns, %lu missed bursts, ring peak %lu/%u, %lu motion events\n",
+           (unsigned long)stats.samples, (unsigned long)stats.overruns,
+           (unsigned long)stats.missed_bursts, (unsigned long)stats.high_water,
+           (unsigned)SAMPLE_RING_SIZE, (unsigned long)stats.motion_events);
+#elif !GYRO_USE_FIFO
+    SamplerPrintStats();
+#endif
+    printf("recording: %lld ms, %u samples\n",
+           (long long)std::chrono::duration_cast<std::chrono::milliseconds>(recording_time).count(),
+           (unsigned)temp_key.size());
+
+    c.state = STATE_MATCHING;
+#if GESTURE_SEGMENT
+    // Nothing to enroll or match
+    if (!segmenter.started())
+    {
+        UiStatus(LCD_COLOR_ORANGE, "No motion.");
+        if (c.archiving)
+        {
+            ArchiveEnd(false, NAN);
+        }
+        controller_result(c);
+        return;
+    }
+#endif
+
+    // Trim leading/trailing zero data
+    {
+        TraceSpan span(TRACE_TRIM);
+        trim_gyro_data(temp_key);
+    }
+
+    UiStatus(LCD_COLOR_GREEN, "Finished...");
+
+    if (c.request == KEY_FLAG)
+    {
+        controller_enroll();
+    }
+    else
+    {
+        controller_unlock(c);
     }
+    controller_result(c);
+}
+
+#if GYRO_USE_FIFO && !GYRO_SPI_ASYNC
+// One wake-up per watermark, then drain the whole FIFO at once
+static void controller_drain(Sentry_Controller &c, Gyroscope_RawData *fifo_samples)
+{
+    size_t count = GetCalibratedFifoData(fifo_samples, FIFO_DEPTH);
+    for (size_t i = 0; i < count; i++)
+    {
+        GestureSample decimated;
+        if (decimate_sample(fifo_samples[i], c.decimation_count, decimated) &&
+            recording_settled(us_ticker_read()))
+        {
+            keep_sample(decimated, c.streaming);
+        }
+    }
+
+    // The watermark line stays high if the FIFO refilled during the drain
+    if (gyroscope_interrupt.read() == 1)
+    {
+        flags.set(DATA_READY_FLAG);
+    }
+}
+#else
+// Move every sample waiting in gyro_ring into the recording
+static void controller_drain(Sentry_Controller &c, Gyroscope_Sample *sample_batch)
+{
+    size_t count;
+    while ((count = gyro_ring.pop_batch(sample_batch, SAMPLE_BATCH_SIZE)) > 0)
+    {
+        // Full-rate trace for the host, before any decimation
+        TelemetrySamples(sample_batch, count);
+        if (c.archiving)
+        {
+            ArchiveSamples(sample_batch, count);
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            GestureSample decimated;
+            if (decimate_sample(sample_batch[i].data, c.decimation_count, decimated) &&
+                recording_settled(sample_batch[i].timestamp_us))
+            {
+                keep_sample(decimated, c.streaming);
+            }
+        }
+    }
+}
+#endif
+
+// The current state's deadline has passed
+static bool controller_expired(const Sentry_Controller &c)
+{
+    return c.has_deadline && (int32_t)(us_ticker_read() - c.deadline_us) >= 0;
 }
 
 /*******************************************************************************
  * @brief Gyroscope Gesture Key Saving Thread
  *
- * This thread handles the initialization, recording, saving, and unlocking of
- * gesture keys using the gyroscope. It also handles the LCD display updates and
- * LED status indicators during the process.
+ * This thread brings the gyroscope up and runs the controller state machine
+ * that records, saves and unlocks gesture keys. It also posts status line
+ * updates to the UI thread and drives the LED status indicators.
  *
  * ****************************************************************************/
 void gyroscope_thread()
 {
     // Initialize gyroscope configuration parameters
+#if GYRO_USE_FIFO
+    Gyroscope_Init_Parameters init_parameters = {
+            GYRO_ODR_CONFIG,                                       // Output data rate
+            INT2_WTM,                                              // Interrupt configuration
+            FULL_SCALE_500,                                        // Full-scale selection
+            FIFO_ENABLE,                                           // FIFO enable
+            FIFO_MODE_STREAM | (GYRO_FIFO_WATERMARK & FIFO_WTM_MASK) // Stream mode, watermark
+    };
+#if GYRO_SPI_ASYNC
+    Gyroscope_Sample sample_batch[SAMPLE_BATCH_SIZE]; // samples taken from the ring
+#else
+    Gyroscope_RawData fifo_samples[FIFO_DEPTH]; // one drained FIFO burst
+#endif
+#else
     Gyroscope_Init_Parameters init_parameters = {
-            ODR_200_CUTOFF_50, // Output data rate
+            GYRO_ODR_CONFIG,   // Output data rate
             INT2_DRDY,         // Interrupt configuration
-            FULL_SCALE_500     // Full-scale selection
+            FULL_SCALE_500,    // Full-scale selection
+            0,                 // FIFO disabled
+            FIFO_MODE_BYPASS   // FIFO mode
     };
+    Gyroscope_Sample sample_batch[SAMPLE_BATCH_SIZE]; // samples taken from the ring
+#endif
 
     // Set up gyroscope's raw data
     Gyroscope_RawData raw_data;
-    char display_buffer[50];
+
+    // Bring the sensor up once at boot, while main() loads the templates;
+    // this is the only time it calibrates unless temperature or bias drift
+    // call for it
+    if (InitiateGyroscope(&init_parameters, &raw_data))
+    {
+        KeyStorageSaveCalibration(GetGyroscopeCalibration());
+    }
+    boot_gyro_us = us_ticker_read();
+
+    // Requests wait in the flags until the key store is complete
+    flags.wait_all(BOOT_FLAG);
+    report_boot();
 
     // Ensure the data-ready flag is set if the gyroscope interrupt is triggered
     if (!(flags.get() & DATA_READY_FLAG) && (gyroscope_interrupt.read() == 1))
@@ -166,229 +754,125 @@ void gyroscope_thread()
         flags.set(DATA_READY_FLAG);
     }
 
+    Sentry_Controller c = {};
+#if GYRO_USE_FIFO && !GYRO_SPI_ASYNC
+    Gyroscope_RawData *batch = fifo_samples;
+#else
+    Gyroscope_Sample *batch = sample_batch;
+#endif
+    c.init_parameters = &init_parameters;
+    c.raw_data = &raw_data;
+    controller_idle(c);
+
     while (1)
     {
-        vector<array<float, 3>> temp_key; // Temporary key to store recorded gyroscope data
-
-        // Wait for a flag indicating recording, unlocking, or erasing actions
-        auto flag_check = flags.wait_any(KEY_FLAG | UNLOCK_FLAG | ERASE_FLAG);
+        // One wait for every event: requests in any state, samples while
+        // recording, and the state's deadline as the timeout
+        uint32_t mask = KEY_FLAG | UNLOCK_FLAG | ERASE_FLAG;
+        if (c.state == STATE_RECORDING)
+        {
+            mask |= RECORD_EVENT_FLAG;
+        }
+        uint32_t events;
+        if (c.has_deadline)
+        {
+            int32_t remaining_us = (int32_t)(c.deadline_us - us_ticker_read());
+            uint32_t remaining_ms = remaining_us > 0 ? ((uint32_t)remaining_us + 999) / 1000 : 0;
+            events = flags.wait_any_for(mask, std::chrono::milliseconds(remaining_ms));
+        }
+        else
+        {
+            events = flags.wait_any_for(mask, Kernel::wait_for_u32_forever);
+        }
+        if (events & osFlagsError)
+        {
+            events = 0; // timed out
+        }
 
-        // Handle key erasing action
-        if (flag_check & ERASE_FLAG)
+        // Erase pre-empts whatever is in progress
+        if (events & ERASE_FLAG)
         {
-            sprintf(display_buffer, "Erasing....");
-            lcd.SetTextColor(LCD_COLOR_BLACK);
-            lcd.FillRect(0, text_y, lcd.GetXSize(), FONT_SIZE);
-            lcd.SetTextColor(LCD_COLOR_YELLOW);
-            lcd.DisplayStringAt(text_x, text_y, (uint8_t *)display_buffer, CENTER_MODE);
+            controller_abort(c);
+            UiStatus(LCD_COLOR_YELLOW, "Erasing....");
 
             // Clear gesture key and unlocking record
-            gesture_key.clear();
+            key_store.clear();
             unlocking_record.clear();
+            KeyStorageErase();
 
-            sprintf(display_buffer, "Key Erased.");
-            lcd.SetTextColor(LCD_COLOR_BLACK);
-            lcd.FillRect(0, text_y, lcd.GetXSize(), FONT_SIZE);
-            lcd.SetTextColor(LCD_COLOR_YELLOW);
-            lcd.DisplayStringAt(text_x, text_y, (uint8_t *)display_buffer, CENTER_MODE);
+            UiStatus(LCD_COLOR_YELLOW, "Key Erased.");
 
             led_status_green = 1;
             led_status_red = 0;
+            controller_result(c);
+            continue;
         }
 
-        // Handle key recording or unlocking actions
-        if (flag_check & (KEY_FLAG | UNLOCK_FLAG))
+        // The request in progress asked for again cancels it, the other one
+        // replaces it; otherwise a request starts the next attempt at once
+        uint32_t request = (events & KEY_FLAG) ? KEY_FLAG : (events & UNLOCK_FLAG);
+        if (request)
         {
-            sprintf(display_buffer, "Hold On");
-            lcd.SetTextColor(LCD_COLOR_BLACK);
-            lcd.FillRect(0, text_y, lcd.GetXSize(), FONT_SIZE);
-            lcd.SetTextColor(LCD_COLOR_ORANGE);
-            lcd.DisplayStringAt(text_x, text_y, (uint8_t *)display_buffer, CENTER_MODE);
-
-            ThisThread::sleep_for(1s);
-
-            // Calibrate gyroscope
-            sprintf(display_buffer, "Calibrating...");
-            lcd.SetTextColor(LCD_COLOR_BLACK);
-            lcd.FillRect(0, text_y, lcd.GetXSize(), FONT_SIZE);
-            lcd.SetTextColor(LCD_COLOR_LIGHTGRAY);
-            lcd.DisplayStringAt(text_x, text_y, (uint8_t *)display_buffer, CENTER_MODE);
-
-            // Initialize the gyroscope
-            InitiateGyroscope(&init_parameters, &raw_data);
-
-            // Start recording gesture with countdown
-            for (int i = 3; i > 0; --i)
+            if (c.state == STATE_ARMING || c.state == STATE_RECORDING)
             {
-                sprintf(display_buffer, "Recording in %d...", i);
-                lcd.SetTextColor(LCD_COLOR_BLACK);
-                lcd.FillRect(0, text_y, lcd.GetXSize(), FONT_SIZE);
-                lcd.SetTextColor(LCD_COLOR_ORANGE);
-                lcd.DisplayStringAt(text_x, text_y, (uint8_t *)display_buffer, CENTER_MODE);
-                ThisThread::sleep_for(1s);
-            }
-
-            sprintf(display_buffer, "Recording...");
-            lcd.SetTextColor(LCD_COLOR_BLACK);
-            lcd.FillRect(0, text_y, lcd.GetXSize(), FONT_SIZE);
-            lcd.SetTextColor(LCD_COLOR_GREEN);
-            lcd.DisplayStringAt(text_x, text_y, (uint8_t *)display_buffer, CENTER_MODE);
-
-            // Gyro data recording loop (3 seconds at 20 Hz)
-            timer.start();
-            while (timer.elapsed_time() < 3s)
-            {
-                flags.wait_all(DATA_READY_FLAG);
-                GetCalibratedRawData();
-
-                // Apply the moving average filter to smooth gyroscope data
-                float smoothed_x = movingAverageFilter(ConvertToDPS(raw_data.x_raw),
-                                                 reinterpret_cast<array<float, 5> &>(gyro_buffer_x), gyro_index_x, gyro_sum_x);
-                float smoothed_y = movingAverageFilter(ConvertToDPS(raw_data.y_raw),
-                                                 reinterpret_cast<array<float, 5> &>(gyro_buffer_y), gyro_index_y, gyro_sum_y);
-                float smoothed_z = movingAverageFilter(ConvertToDPS(raw_data.z_raw),
-                                                 reinterpret_cast<array<float, 5> &>(gyro_buffer_z), gyro_index_z, gyro_sum_z);
-
-                temp_key.push_back({smoothed_x, smoothed_y, smoothed_z});
-                ThisThread::sleep_for(50ms); // 20 Hz sampling
+                bool cancel = request == c.request;
+                controller_abort(c);
+                if (cancel)
+                {
+                    UiStatus(LCD_COLOR_ORANGE, "Cancelled.");
+                    controller_result(c);
+                    continue;
+                }
             }
-            timer.stop();
-            timer.reset();
-
-            // Trim leading/trailing zero data
-            trim_gyro_data(temp_key);
-
-            sprintf(display_buffer, "Finished...");
-            lcd.SetTextColor(LCD_COLOR_BLACK);
-            lcd.FillRect(0, text_y, lcd.GetXSize(), FONT_SIZE);
-            lcd.SetTextColor(LCD_COLOR_GREEN);
-            lcd.DisplayStringAt(text_x, text_y, (uint8_t *)display_buffer, CENTER_MODE);
+            controller_arm(c, request);
+            continue;
         }
 
-        // Handle saving or replacing gesture keys
-        if (flag_check & KEY_FLAG)
-        {
-            if (gesture_key.empty())
-            {
-                sprintf(display_buffer, "Saving Key...");
-                lcd.SetTextColor(LCD_COLOR_BLACK);
-                lcd.FillRect(0, text_y, lcd.GetXSize(), FONT_SIZE);
-                lcd.SetTextColor(LCD_COLOR_LIGHTGREEN);
-                lcd.DisplayStringAt(text_x, text_y, (uint8_t *)display_buffer, CENTER_MODE);
-
-                gesture_key = temp_key;
-                temp_key.clear();
-
-                led_status_red = 1;
-                led_status_green = 0;
-
-                sprintf(display_buffer, "Key saved.");
-                lcd.SetTextColor(LCD_COLOR_BLACK);
-                lcd.FillRect(0, text_y, lcd.GetXSize(), FONT_SIZE);
-                lcd.SetTextColor(LCD_COLOR_LIGHTGREEN);
-                lcd.DisplayStringAt(text_x, text_y, (uint8_t *)display_buffer, CENTER_MODE);
-            }
-            else
-            {
-                sprintf(display_buffer, "Removing old key...");
-                lcd.SetTextColor(LCD_COLOR_BLACK);
-                lcd.FillRect(0, text_y, lcd.GetXSize(), FONT_SIZE);
-                lcd.SetTextColor(LCD_COLOR_ORANGE);
-                lcd.DisplayStringAt(text_x, text_y, (uint8_t *)display_buffer, CENTER_MODE);
-
-                ThisThread::sleep_for(1s);
-
-                gesture_key.clear();
-                gesture_key = temp_key;
-                temp_key.clear();
-
-                sprintf(display_buffer, "New key saved.");
-                lcd.SetTextColor(LCD_COLOR_BLACK);
-                lcd.FillRect(0, text_y, lcd.GetXSize(), FONT_SIZE);
-                lcd.SetTextColor(LCD_COLOR_LIGHTGREEN);
-                lcd.DisplayStringAt(text_x, text_y, (uint8_t *)display_buffer, CENTER_MODE);
-
-                led_status_red = 1;
-                led_status_green = 0;
-            }
-        }
-        else if (flag_check & UNLOCK_FLAG)
+        switch (c.state)
         {
-            flags.clear(UNLOCK_FLAG);
-            sprintf(display_buffer, "Unlocking...");
-            lcd.SetTextColor(LCD_COLOR_BLACK);
-            lcd.FillRect(0, text_y, lcd.GetXSize(), FONT_SIZE);
-            lcd.SetTextColor(LCD_COLOR_LIGHTGRAY);
-            lcd.DisplayStringAt(text_x, text_y, (uint8_t *)display_buffer, CENTER_MODE);
-
-            unlocking_record = temp_key;
-            temp_key.clear();
-
-            if (gesture_key.empty())
-            {
-                sprintf(display_buffer, "NO KEY SAVED.");
-                lcd.SetTextColor(LCD_COLOR_BLACK);
-                lcd.FillRect(0, text_y, lcd.GetXSize(), FONT_SIZE);
-                lcd.SetTextColor(LCD_COLOR_RED);
-                lcd.DisplayStringAt(text_x, text_y, (uint8_t *)display_buffer, CENTER_MODE);
-
-                unlocking_record.clear();
-                led_status_green = 1;
-                led_status_red = 0;
-            }
-            else
-            {
-                int unlock_count = 0; // number of axes exceeding the correlation threshold
-
-                // Align both recordings to the same length
-                size_t target_size = std::min(gesture_key.size(), unlocking_record.size());
-                gesture_key.resize(target_size);
-                unlocking_record.resize(target_size);
-
-                // Normalize both gesture and unlocking records
-                normalize(gesture_key);
-                normalize(unlocking_record);
-
-                array<float, 3> correlationResult = calculateCorrelationVectors(gesture_key, unlocking_record);
+            case STATE_IDLE:
+#if IDLE_ENABLE
+                // Nothing asked for in a while: sleep until motion, a touch or the button
+                if (controller_expired(c))
+                {
+                    idle_until_wake(&init_parameters, &raw_data);
+                    controller_idle(c);
+                }
+#endif
+                break;
 
-                // Check if all three axes exceed the correlation threshold
-                for (size_t i = 0; i < correlationResult.size(); i++)
+            case STATE_ARMING:
+                if (controller_expired(c))
                 {
-                    if (correlationResult[i] > CORRELATION_THRESHOLD)
-                    {
-                        unlock_count++;
-                    }
+                    controller_arm_step(c);
                 }
+                break;
 
-                // Update the display and LED status based on unlock result
-                if (unlock_count == 3)  // All three axes must match
+            case STATE_RECORDING:
+                if (events & RECORD_EVENT_FLAG)
+                {
+                    controller_drain(c, batch);
+                }
+                if (recording_done(c.streaming))
                 {
-                    sprintf(display_buffer, "UNLOCK: SUCCESS");
-                    lcd.SetTextColor(LCD_COLOR_BLACK);
-                    lcd.FillRect(0, text_y, lcd.GetXSize(), FONT_SIZE);
-                    lcd.SetTextColor(LCD_COLOR_GREEN);
-                    lcd.DisplayStringAt(text_x, text_y, (uint8_t *)display_buffer, CENTER_MODE);
-
-                    led_status_green = 1;
-                    led_status_red = 0;
+                    controller_match(c);
                 }
                 else
                 {
-                    sprintf(display_buffer, "UNLOCK: FAILED");
-                    lcd.SetTextColor(LCD_COLOR_BLACK);
-                    lcd.FillRect(0, text_y, lcd.GetXSize(), FONT_SIZE);
-                    lcd.SetTextColor(LCD_COLOR_RED);
-                    lcd.DisplayStringAt(text_x, text_y, (uint8_t *)display_buffer, CENTER_MODE);
-
-                    led_status_green = 0;
-                    led_status_red = 1;
+                    controller_enter(c, STATE_RECORDING, CONTROLLER_POLL_MS);
                 }
+                break;
 
-                unlocking_record.clear();
-            }
-        }
+            case STATE_MATCHING:
+                break; // left within controller_match()
 
-        ThisThread::sleep_for(50ms);
+            case STATE_RESULT:
+                if (controller_expired(c))
+                {
+                    controller_idle(c);
+                }
+                break;
+        }
     }
 }
 
@@ -400,18 +884,54 @@ void gyroscope_thread()
 void touch_screen_thread()
 {
     TS_StateTypeDef ts_state;
+    uint32_t last_touch_us = 0; // ticker value of the last report with a touch
 
-    if (ts.Init(lcd.GetXSize(), lcd.GetYSize()) != TS_OK)
+    uint8_t ts_status = ts.Init(UiWidth(), UiHeight());
+    if (ts_status == TS_OK)
+    {
+        ts_status = ts.ITConfigFifo(TOUCH_FIFO_THRESHOLD);
+    }
+    if (ts_status != TS_OK)
     {
         return;
     }
-
-    char display_buffer[50];
+    touch_interrupt.fall(&onTouchInterrupt);
 
     while (1)
     {
-        ts.GetState(&ts_state);
-        if (ts_state.TouchDetected)
+        // Sleep until the controller has something to report
+        flags.wait_all(TOUCH_FLAG);
+
+        // Touch transfers are served ahead of EEPROM traffic on I2C3
+        ts.ReadFifo(&ts_state);
+        ts.ITClear();
+
+        // The INT line is level triggered; if it is still asserted a new
+        // event arrived while draining and no further edge will come
+        if (touch_interrupt.read() == 0)
+        {
+            flags.set(TOUCH_FLAG);
+        }
+
+        // A touch on the dark screen only wakes it
+        if (touch_woke)
+        {
+            touch_woke = false;
+            last_touch_us = us_ticker_read();
+            continue;
+        }
+
+        // A held finger keeps reporting; only a touch after a gap is a new
+        // tap, so holding a button does not cancel the attempt it started
+        if (!ts_state.TouchDetected)
+        {
+            continue;
+        }
+        uint32_t now_us = us_ticker_read();
+        bool new_tap = now_us - last_touch_us > TOUCH_TAP_GAP_MS * 1000UL;
+        last_touch_us = now_us;
+
+        if (new_tap)
         {
             int touch_x = ts_state.X;
             int touch_y = ts_state.Y;
@@ -419,47 +939,77 @@ void touch_screen_thread()
             // Check if the touch is inside record button
             if (is_touch_inside_button(touch_x, touch_y, button1_x, button1_y, button1_width, button1_height))
             {
-                sprintf(display_buffer, "Recording Initiated...");
-                lcd.SetTextColor(LCD_COLOR_BLACK);
-                lcd.FillRect(0, text_y, lcd.GetXSize(), FONT_SIZE);
-                lcd.SetTextColor(LCD_COLOR_BLUE);
-                lcd.DisplayStringAt(text_x, text_y, (uint8_t *)display_buffer, CENTER_MODE);
-                ThisThread::sleep_for(1s);
+                UiStatus(LCD_COLOR_BLUE, "Recording Initiated...");
                 flags.set(KEY_FLAG);
             }
 
             // Check if the touch is inside unlock button
             if (is_touch_inside_button(touch_x, touch_y, button2_x, button2_y, button2_width, button2_height))
             {
-                sprintf(display_buffer, "Unlocking Initiated...");
-                lcd.SetTextColor(LCD_COLOR_BLACK);
-                lcd.FillRect(0, text_y, lcd.GetXSize(), FONT_SIZE);
-                lcd.SetTextColor(LCD_COLOR_BLUE);
-                lcd.DisplayStringAt(text_x, text_y, (uint8_t *)display_buffer, CENTER_MODE);
-                ThisThread::sleep_for(1s);
+                unlock_tap_us = touch_time_us;
+#if FAST_UNLOCK
+                // The gyroscope thread puts up the only prompt
+#else
+                UiStatus(LCD_COLOR_BLUE, "Unlocking Initiated...");
+#endif
                 flags.set(UNLOCK_FLAG);
             }
         }
-        ThisThread::sleep_for(10ms);
     }
 }
 
+#if IDLE_ENABLE
 /*******************************************************************************
  *
- * @brief draw button
- * @param x: x coordinate of the button
- * @param y: y coordinate of the button
- * @param width: width of the button
- * @param height: height of the button
- * @param label: label of the button
+ * @brief Idle state
+ *
+ * Puts the gyroscope, the display and the console to sleep so the MCU can
+ * stay in Stop mode, blocks until motion, a touch or the user button, then
+ * brings everything back and reports the wake-to-ready latency. Runs on the
+ * gyroscope thread, so no acquisition is active.
  *
  * ****************************************************************************/
-void draw_button(int x, int y, int width, int height, const char *label)
+void idle_until_wake(Gyroscope_Init_Parameters *init_parameters, Gyroscope_RawData *raw_data)
 {
-    lcd.SetTextColor(LCD_COLOR_RED);
-    lcd.FillRect(x, y, width, height);
-    lcd.DisplayStringAt(x + width / 2 - strlen(label) * 19, y + height / 2 - 8, (uint8_t *)label, CENTER_MODE);
+    static const char *const source_names[] = {"motion", "touch", "button"};
+    int green = led_status_green;
+    int red = led_status_red;
+
+    flags.clear(WAKE_FLAG);
+    idle = true;
+
+#if IDLE_WAKE_ON_MOTION
+    motion_interrupt.rise(&onMotionWake);
+#endif
+    GyroscopeWakeOnMotion();
+    UiDisplay(false);
+    led_status_green = 0;
+    led_status_red = 0;
+    TelemetrySleep();
+
+    flags.wait_all(WAKE_FLAG);
+
+    TelemetryWake();
+    UiDisplay(true);
+    // After a motion wake the board is moving by definition: restore the
+    // registers only, a stale bias is refreshed by the next settled arm
+    if (InitiateGyroscope(init_parameters, raw_data, wake_source != WAKE_MOTION))
+    {
+        KeyStorageSaveCalibration(GetGyroscopeCalibration());
+    }
+#if GYRO_HW_MOTION
+    AcquisitionGateOnMotion(motion_interrupt);
+#elif IDLE_WAKE_ON_MOTION
+    motion_interrupt.rise(nullptr);
+#endif
+    led_status_green = green;
+    led_status_red = red;
+
+    uint32_t latency_us = us_ticker_read() - wake_time_us;
+    printf("idle: woke on %s, ready in %lu us%s\n", source_names[wake_source], (unsigned long)latency_us,
+           latency_us > IDLE_WAKE_BUDGET_MS * 1000UL ? " (over budget)" : "");
 }
+#endif
 
 /*******************************************************************************
  *
@@ -478,21 +1028,76 @@ bool is_touch_inside_button(int touch_x, int touch_y, int button_x, int button_y
             touch_y >= button_y && touch_y <= button_y + button_height);
 }
 
-float movingAverageFilter(float new_value, std::array<float, WINDOW_SIZE>& buffer, size_t& index, float& sum) {
-    sum -= buffer[index];
-    buffer[index] = new_value;
-    sum += new_value;
-    index = (index + 1) % WINDOW_SIZE;
-    return sum / WINDOW_SIZE;
+// The window is over, or the streaming matcher no longer needs samples. With
+// GESTURE_SEGMENT the segmenter ends the recording, or nobody moved in time;
+// a gesture is bounded by the recording buffer instead of the timer.
+bool recording_done(bool streaming) {
+#if GESTURE_SEGMENT
+    if (segmenter.done()) {
+        return true;
+    }
+    if (!segmenter.started() && timer.elapsed_time() >= std::chrono::milliseconds(SEGMENT_START_TIMEOUT_MS)) {
+        return true;
+    }
+#else
+    if (timer.elapsed_time() >= std::chrono::milliseconds(GESTURE_RECORD_WINDOW_MS)) {
+        return true;
+    }
+#endif
+#if GESTURE_STREAMING_ACTIVE
+    return streaming && stream_matcher.decided();
+#else
+    return false;
+#endif
+}
+
+// Unlock attempts only record samples taken from unlock_settle_us on; the
+// earlier ones still pass the filters, so those are warm by then. The first
+// recorded sample restarts the window and reports the tap-to-ready latency.
+bool recording_settled(uint32_t timestamp_us) {
+    if (!unlock_ready_pending) {
+        return true;
+    }
+    if ((int32_t)(timestamp_us - unlock_settle_us) < 0) {
+        return false;
+    }
+    unlock_ready_pending = false;
+    timer.reset();
+    if (unlock_fast && !GESTURE_SEGMENT) {
+        UiStatus(LCD_COLOR_GREEN, "Recording...");
+    }
+
+    uint32_t latency_us = timestamp_us - unlock_tap_us;
+    printf("unlock: %s path, tap to ready in %lu us%s\n", unlock_fast ? "fast" : "full",
+           (unsigned long)latency_us, latency_us > FAST_UNLOCK_BUDGET_MS * 1000UL ? " (over budget)" : "");
+    return true;
+}
+
+// Start-up phases on the microsecond ticker, which starts with the mbed boot
+// code. Screen is when the first frame appeared (0 if it has not yet), ready
+// when the controller started taking requests.
+void report_boot() {
+    uint32_t ready_us = us_ticker_read();
+    printf("boot: main %lu us, display %lu us, keys %lu us, gyro %lu us, screen %lu us, ready %lu us\n",
+           (unsigned long)boot_main_us, (unsigned long)boot_display_us, (unsigned long)boot_keys_us,
+           (unsigned long)boot_gyro_us, (unsigned long)UiShownAt(), (unsigned long)ready_us);
 }
 
-void normalize(vector<array<float, 3>>& data) {
-    for (auto& point : data) {
-        float magnitude = sqrt(point[0] * point[0] + point[1] * point[1] + point[2] * point[2]);
-        if (magnitude > 0) {
-            point[0] /= magnitude;
-            point[1] /= magnitude;
-            point[2] /= magnitude;
+// Append one working-rate sample to the recording, through the segmenter
+void keep_sample(const GestureSample &sample, bool streaming) {
+#if GESTURE_SEGMENT
+    size_t appended = segmenter.add(temp_key, sample);
+    if (appended > 0 && appended == temp_key.size()) {
+        UiStatus(LCD_COLOR_GREEN, "Recording...");
+    }
+#else
+    size_t appended = temp_key.push_back(sample) ? 1 : 0;
+#endif
+#if GESTURE_STREAMING_ACTIVE
+    if (streaming) {
+        for (size_t i = temp_key.size() - appended; i < temp_key.size(); i++) {
+            stream_matcher.add(temp_key[i]);
         }
     }
+#endif
 }
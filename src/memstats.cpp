@@ -0,0 +1,111 @@
+/**
+ * @file memstats.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Heap, thread stack and key store memory report for the embedded
+ * sentry project.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "memstats.h"
+
+#if MEMSTATS_ENABLE
+#include <mbed.h>
+#include <cstdlib>
+
+#include "ccm.h"
+
+#if !defined(MBED_HEAP_STATS_ENABLED) || !defined(MBED_STACK_STATS_ENABLED) || !defined(MBED_THREAD_STATS_ENABLED)
+#warning "memstats: enable platform.heap/stack/thread-stats-enabled in mbed_app.json, or set MEMSTATS_ENABLE 0"
+#endif
+
+// Largest block malloc() hands out, by bisection between 0 and limit
+static size_t LargestFreeBlock(size_t limit)
+{
+    size_t lo = 0, hi = limit;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo + 1) / 2;
+        void *block = malloc(mid);
+        if (block)
+        {
+            free(block);
+            lo = mid;
+        }
+        else
+        {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+Mem_Heap_Stats MemStatsHeap()
+{
+    mbed_stats_heap_t heap;
+    mbed_stats_heap_get(&heap);
+
+    Mem_Heap_Stats stats;
+    stats.current = heap.current_size;
+    stats.peak = heap.max_size;
+    stats.reserved = heap.reserved_size;
+    uint32_t used = heap.current_size + heap.overhead_size;
+    stats.free = heap.reserved_size > used ? heap.reserved_size - used : 0;
+    stats.allocations = heap.alloc_cnt;
+    stats.failures = heap.alloc_fail_cnt;
+
+    // Trial allocations are taken after the snapshot, so they do not show
+    // up in the counters above
+    stats.largest_free = LargestFreeBlock(stats.free);
+    return stats;
+}
+
+void MemStatsDump(const KeyStore &store)
+{
+    Mem_Heap_Stats heap = MemStatsHeap();
+    unsigned fragmentation = heap.free ? 100 - (unsigned)((uint64_t)heap.largest_free * 100 / heap.free) : 0;
+    printf("heap: %lu now, %lu peak, %lu free of %lu, largest block %lu (%u%% fragmented), %lu allocs, %lu failed\n",
+           (unsigned long)heap.current, (unsigned long)heap.peak, (unsigned long)heap.free,
+           (unsigned long)heap.reserved, (unsigned long)heap.largest_free, fragmentation,
+           (unsigned long)heap.allocations, (unsigned long)heap.failures);
+
+    // Stack statistics carry only the thread id, the thread statistics the name
+    mbed_stats_stack_t stacks[MEMSTATS_MAX_THREADS];
+    mbed_stats_thread_t threads[MEMSTATS_MAX_THREADS];
+    size_t stack_count = mbed_stats_stack_get_each(stacks, MEMSTATS_MAX_THREADS);
+    size_t thread_count = mbed_stats_thread_get_each(threads, MEMSTATS_MAX_THREADS);
+    for (size_t i = 0; i < stack_count; i++)
+    {
+        const char *name = "?";
+        for (size_t j = 0; j < thread_count; j++)
+        {
+            if (threads[j].id == stacks[i].thread_id && threads[j].name)
+            {
+                name = threads[j].name;
+            }
+        }
+        printf("stack: %s %lu of %lu used, %lu spare\n", name, (unsigned long)stacks[i].max_size,
+               (unsigned long)stacks[i].reserved_size,
+               (unsigned long)(stacks[i].reserved_size - stacks[i].max_size));
+    }
+
+    // Templates live in the store's fixed slots, not on the heap
+    size_t used = 0;
+    for (size_t slot = 0; slot < store.size(); slot++)
+    {
+        used += store.samples(slot).size() * sizeof(GestureSample);
+    }
+    printf("key store: %u/%u templates, %u bytes per slot (%u total), %u bytes of samples in use\n",
+           (unsigned)store.size(), (unsigned)KeyStore::capacity(), (unsigned)KeyStore::template_bytes(),
+           (unsigned)sizeof(KeyStore), (unsigned)used);
+
+    // Stacks and hot buffers placed there (scripts/ccm.ld)
+    printf("ccm: %u of %u bytes\n", (unsigned)CcmUsed(), (unsigned)CCM_SIZE);
+}
+#endif
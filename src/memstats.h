@@ -0,0 +1,53 @@
+/**
+ * @file memstats.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Heap, thread stack and key store memory report for the embedded
+ * sentry project.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef MEMSTATS_H
+#define MEMSTATS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "key_store.h"
+#include "system_config.h"
+
+// Heap usage; sizes in bytes
+typedef struct {
+  uint32_t current;        // allocated now
+  uint32_t peak;           // most ever allocated at once
+  uint32_t reserved;       // size of the heap region
+  uint32_t free;           // reserved minus allocated and allocator overhead
+  uint32_t largest_free;   // biggest block malloc() can return right now
+  uint32_t allocations;    // malloc() calls since boot
+  uint32_t failures;       // malloc() calls that returned NULL
+} Mem_Heap_Stats;
+
+#if MEMSTATS_ENABLE
+/**
+ * @brief Heap statistics. The largest free block is found by trial
+ * allocations, which are not counted in allocations.
+ */
+Mem_Heap_Stats MemStatsHeap();
+
+/**
+ * @brief Print the heap, every thread's stack size and high-water mark, and
+ * the bytes held per key store template
+ * @param store: key store to account for
+ */
+void MemStatsDump(const KeyStore &store);
+#else
+inline void MemStatsDump(const KeyStore &) {}
+#endif
+
+#endif  // MEMSTATS_H
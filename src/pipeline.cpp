@@ -0,0 +1,202 @@
+/**
+ * @file pipeline.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Per-sample gesture processing (DPS conversion, smoothing and
+ * decimation) shared by the firmware and the host replay harness in the
+ * embedded sentry project.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "pipeline.h"
+#include "filters.h"
+#include "trace.h"
+
+float sensitivity = 0.0f;
+
+#if GESTURE_FIXED_POINT
+typedef q15_t filter_value_t;  // bias-removed counts
+#else
+typedef float filter_value_t;  // degrees per second
+#endif
+
+#if !GESTURE_CIC_DECIMATION
+// Smoothing ahead of the plain decimation on every acquisition path. Any
+// stages from filters.h can be listed here, e.g. a Median<filter_value_t, 3>
+// ahead of the average to drop SPI glitches.
+typedef FilterChain<MovingAverage<filter_value_t, SMOOTHING_WINDOW>> SmoothingFilter;
+
+static SmoothingFilter smoothing CCM_DATA;
+#endif
+
+#if GESTURE_CIC_DECIMATION
+#define DECIMATOR_PHASES GYRO_FIFO_DECIMATION
+#define DECIMATOR_TAPS_PER_PHASE GYRO_DECIMATOR_ORDER
+#define DECIMATOR_TAPS (DECIMATOR_PHASES * DECIMATOR_TAPS_PER_PHASE)
+
+static_assert(GYRO_ODR_HZ / GYRO_FIFO_DECIMATION <= GESTURE_SAMPLE_RATE_HZ,
+              "working rate above the gesture buffer sizing");
+
+#if GESTURE_FIXED_POINT
+typedef int16_t decimator_coeff_t;  // Q15, non-negative, sum to exactly 32768
+typedef int32_t decimator_acc_t;    // at most 32768 * |x|, no overflow
+#else
+typedef float decimator_coeff_t;
+typedef float decimator_acc_t;
+#endif
+
+// Decimating low-pass filter in polyphase form. Output m is
+//   y[m] = sum_j h[j] x[m * M + M - 1 - j], j < N = K * M,
+// so each input x[n] belongs to exactly K pending outputs. It is multiplied
+// into them as it arrives: no input history, K multiply-adds per axis per
+// input, and an output is complete after every M-th input.
+//
+// h is the CIC (cascaded moving average) response. Unlike a windowed sinc it
+// has no negative lobes: the near-zero samples at the start and end of a
+// gesture keep the sign of the motion, and normalize() scales those up to
+// full unit vectors.
+struct Decimator {
+  // taps[r][k] = h[k * M + M - 1 - r], the taps an input at phase r feeds
+  decimator_coeff_t taps[DECIMATOR_PHASES][DECIMATOR_TAPS_PER_PHASE];
+  // pending[axis][k] is the partial sum of the k-th next output
+  decimator_acc_t pending[3][DECIMATOR_TAPS_PER_PHASE];
+
+  Decimator() {
+    design();
+    reset();
+  }
+
+  void design() {
+    // Convolve GYRO_DECIMATOR_ORDER boxcars of length M: each stage is a
+    // running sum, done as a prefix sum minus itself M taps back
+    float h[DECIMATOR_TAPS] = {0};
+    float gain = DECIMATOR_PHASES;
+    for (size_t j = 0; j < DECIMATOR_PHASES; j++) h[j] = 1.0f;
+    for (int stage = 1; stage < GYRO_DECIMATOR_ORDER; stage++) {
+      for (size_t j = 1; j < DECIMATOR_TAPS; j++) h[j] += h[j - 1];
+      for (size_t j = DECIMATOR_TAPS - 1; j >= DECIMATOR_PHASES; j--) h[j] -= h[j - DECIMATOR_PHASES];
+      gain *= DECIMATOR_PHASES;
+    }
+
+#if GESTURE_FIXED_POINT
+    int32_t total = 0;
+#endif
+    for (size_t r = 0; r < DECIMATOR_PHASES; r++) {
+      for (size_t k = 0; k < DECIMATOR_TAPS_PER_PHASE; k++) {
+        float tap = h[k * DECIMATOR_PHASES + DECIMATOR_PHASES - 1 - r] / gain;
+#if GESTURE_FIXED_POINT
+        taps[r][k] = (decimator_coeff_t)lroundf(tap * 32768.0f);
+        total += taps[r][k];
+#else
+        taps[r][k] = tap;
+#endif
+      }
+    }
+
+#if GESTURE_FIXED_POINT
+    // Rounding leaves the Q15 taps a few LSB off unity; the centre tap takes
+    // the difference so a constant rate passes through unchanged
+    const size_t centre = GYRO_DECIMATOR_ORDER * (DECIMATOR_PHASES - 1) / 2;
+    taps[DECIMATOR_PHASES - 1 - centre % DECIMATOR_PHASES][centre / DECIMATOR_PHASES] += 32768 - total;
+#endif
+  }
+
+  void reset() {
+    for (size_t axis = 0; axis < 3; axis++) {
+      for (size_t k = 0; k < DECIMATOR_TAPS_PER_PHASE; k++) pending[axis][k] = 0;
+    }
+  }
+
+  void accumulate(const decimator_acc_t (&value)[3], size_t phase) {
+    const decimator_coeff_t *h = taps[phase];
+    for (size_t axis = 0; axis < 3; axis++) {
+      decimator_acc_t *acc = pending[axis];
+      for (size_t k = 0; k < DECIMATOR_TAPS_PER_PHASE; k++) acc[k] += h[k] * value[axis];
+    }
+  }
+
+  // Take the completed output and open a new one at the far end
+  GestureSample output() {
+    GestureSample out;
+    for (size_t axis = 0; axis < 3; axis++) {
+      decimator_acc_t *acc = pending[axis];
+#if GESTURE_FIXED_POINT
+      out[axis] = (q15_t)((acc[0] + (1 << 14)) >> 15);
+#else
+      out[axis] = acc[0];
+#endif
+      for (size_t k = 1; k < DECIMATOR_TAPS_PER_PHASE; k++) acc[k - 1] = acc[k];
+      acc[DECIMATOR_TAPS_PER_PHASE - 1] = 0;
+    }
+    return out;
+  }
+};
+
+static Decimator decimator CCM_DATA;
+#endif
+
+// Convert raw ADC value to degrees per second
+float ConvertToDPS(int16_t axis_data) {
+  return axis_data * sensitivity;
+}
+
+#if !GESTURE_CIC_DECIMATION
+GestureSample filter_sample(const Gyroscope_RawData &raw) {
+  TraceSpan span(TRACE_FILTER);
+#if GESTURE_FIXED_POINT
+  // Bias-removed counts go straight into the Q15 filter; the DPS scale
+  // cancels out in normalize() and the correlation
+  return smoothing.update({raw.x_raw, raw.y_raw, raw.z_raw});
+#else
+  return smoothing.update({ConvertToDPS(raw.x_raw), ConvertToDPS(raw.y_raw), ConvertToDPS(raw.z_raw)});
+#endif
+}
+#endif
+
+void filter_reset() {
+#if GESTURE_CIC_DECIMATION
+  decimator.reset();
+#else
+  smoothing.reset();
+#endif
+}
+
+#if GESTURE_CIC_DECIMATION
+bool decimate_sample(const Gyroscope_RawData &raw, size_t &decimation_count, GestureSample &decimated) {
+  {
+    TraceSpan span(TRACE_FILTER);
+#if GESTURE_FIXED_POINT
+    const decimator_acc_t value[3] = {raw.x_raw, raw.y_raw, raw.z_raw};
+#else
+    const decimator_acc_t value[3] = {ConvertToDPS(raw.x_raw), ConvertToDPS(raw.y_raw),
+                                      ConvertToDPS(raw.z_raw)};
+#endif
+    decimator.accumulate(value, decimation_count);
+    if (++decimation_count < GYRO_FIFO_DECIMATION) return false;
+    decimation_count = 0;
+    decimated = decimator.output();
+  }
+  return true;
+}
+#else
+bool decimate_sample(const Gyroscope_RawData &raw, size_t &decimation_count, GestureSample &decimated) {
+  GestureSample smoothed = filter_sample(raw);
+  if (++decimation_count == GYRO_FIFO_DECIMATION) {
+    decimation_count = 0;
+    decimated = smoothed;
+    return true;
+  }
+  return false;
+}
+#endif
+
+bool record_sample(GestureRecord &key, const Gyroscope_RawData &raw, size_t &decimation_count) {
+  GestureSample decimated;
+  return decimate_sample(raw, decimation_count, decimated) && key.push_back(decimated);
+}
@@ -0,0 +1,74 @@
+/**
+ * @file pipeline.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Per-sample gesture processing (DPS conversion, smoothing and
+ * decimation) shared by the firmware and the host replay harness in the
+ * embedded sentry project.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "gyro_sample.h"
+#include "key_store.h"
+#include "system_config.h"
+
+// Degrees per second per count, set by InitiateGyroscope() from the full scale
+extern float sensitivity;
+
+/**
+ * @brief Data conversion: raw -> degrees per second
+ */
+float ConvertToDPS(int16_t axis_data);
+
+#if !GESTURE_CIC_DECIMATION
+/**
+ * @brief Run one calibrated sample through the smoothing filter chain
+ * @param raw: calibrated sample
+ * @return the smoothed sample
+ */
+GestureSample filter_sample(const Gyroscope_RawData &raw);
+#endif
+
+/**
+ * @brief Clear the filter state, so a new recording does not start with the
+ * tail of the previous one
+ */
+void filter_reset();
+
+/**
+ * @brief Low-pass every sample at the full ODR (CIC decimation filter, or the
+ * moving average with GESTURE_CIC_DECIMATION 0) and return every
+ * GYRO_FIFO_DECIMATION-th output
+ * @param raw: calibrated sample
+ * @param decimation_count: samples since the last kept one, 0 after
+ * filter_reset()
+ * @param decimated: set to the working-rate sample when one is due
+ * @return true if decimated was set
+ */
+bool decimate_sample(const Gyroscope_RawData &raw, size_t &decimation_count, GestureSample &decimated);
+
+/**
+ * @brief Low-pass every sample at the full ODR (CIC decimation filter, or the
+ * moving average with GESTURE_CIC_DECIMATION 0) and append every
+ * GYRO_FIFO_DECIMATION-th output to the key
+ * @param key: recording the kept samples are appended to
+ * @param raw: calibrated sample
+ * @param decimation_count: samples since the last kept one, 0 after
+ * filter_reset()
+ * @return true if a sample was appended to key
+ */
+bool record_sample(GestureRecord &key, const Gyroscope_RawData &raw, size_t &decimation_count);
+
+#endif  // PIPELINE_H
@@ -0,0 +1,127 @@
+/**
+ * @file sample_ring.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Lock-free single-producer/single-consumer ring buffer used to hand
+ * gyroscope samples from interrupt context to the processing thread.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef SAMPLE_RING_H
+#define SAMPLE_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Fixed-size SPSC ring. push() may only be called from one producer
+ * (an ISR), pop()/pop_batch() only from one consumer thread. Head and tail
+ * are free-running 32-bit counters, so no slot is wasted and no lock or
+ * critical section is needed on a Cortex-M. When the ring is full the new
+ * item is dropped and counted as an overrun.
+ */
+template <typename T, size_t Capacity>
+class SampleRing {
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                "SampleRing capacity must be a power of two");
+
+ public:
+  /**
+   * @brief Append one item (producer side)
+   * @param item: the item to store
+   * @return false if the ring was full and the item was dropped
+   */
+  bool push(const T &item) {
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    uint32_t tail = tail_.load(std::memory_order_acquire);
+    if (head - tail >= Capacity) {
+      overruns_.store(overruns_.load(std::memory_order_relaxed) + 1,
+                      std::memory_order_relaxed);
+      return false;
+    }
+
+    buffer_[head & kMask] = item;
+    head_.store(head + 1, std::memory_order_release);
+
+    uint32_t level = head + 1 - tail;
+    if (level > high_water_.load(std::memory_order_relaxed)) {
+      high_water_.store(level, std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  /**
+   * @brief Move up to max_items of the oldest items into out (consumer side)
+   * @param out: destination array
+   * @param max_items: capacity of out
+   * @return number of items copied
+   */
+  size_t pop_batch(T *out, size_t max_items) {
+    uint32_t tail = tail_.load(std::memory_order_relaxed);
+    uint32_t head = head_.load(std::memory_order_acquire);
+    size_t count = head - tail;
+    if (count > max_items) count = max_items;
+
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = buffer_[(tail + i) & kMask];
+    }
+    tail_.store(tail + count, std::memory_order_release);
+    return count;
+  }
+
+  /**
+   * @brief Remove the oldest item (consumer side)
+   * @param out: receives the item
+   * @return false if the ring was empty
+   */
+  bool pop(T &out) { return pop_batch(&out, 1) == 1; }
+
+  /** @brief Number of items waiting to be consumed */
+  size_t size() const {
+    return head_.load(std::memory_order_acquire) -
+           tail_.load(std::memory_order_acquire);
+  }
+
+  bool empty() const { return size() == 0; }
+
+  static constexpr size_t capacity() { return Capacity; }
+
+  /** @brief Items dropped because the consumer fell behind */
+  uint32_t overruns() const {
+    return overruns_.load(std::memory_order_relaxed);
+  }
+
+  /** @brief Highest fill level seen since the last reset */
+  uint32_t high_water() const {
+    return high_water_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Discard all items and clear the statistics. Only safe while the
+   * producer is stopped.
+   */
+  void reset() {
+    tail_.store(head_.load(std::memory_order_relaxed),
+                std::memory_order_relaxed);
+    overruns_.store(0, std::memory_order_relaxed);
+    high_water_.store(0, std::memory_order_relaxed);
+  }
+
+ private:
+  static constexpr uint32_t kMask = Capacity - 1;
+
+  T buffer_[Capacity];
+  std::atomic<uint32_t> head_{0};  // written by the producer only
+  std::atomic<uint32_t> tail_{0};  // written by the consumer only
+  std::atomic<uint32_t> overruns_{0};
+  std::atomic<uint32_t> high_water_{0};
+};
+
+#endif  // SAMPLE_RING_H
@@ -0,0 +1,192 @@
+/**
+ * @file sampler.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Drift-free per-sample gyroscope reads with period and latency
+ * histograms for the embedded sentry project.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "sampler.h"
+
+static InterruptIn *drdy_pin = nullptr;
+static EventFlags *ready_flags = nullptr;
+static uint32_t ready_mask = 0;
+static EventQueue *read_queue = nullptr; // high-priority thread that does the SPI reads
+
+#if SAMPLER_PACING == SAMPLER_PACE_TIMER
+static Ticker pace_ticker;               // reschedules itself from the last deadline, never from "now"
+static uint32_t next_deadline_us = 0;
+#endif
+
+static volatile bool running = false;
+static volatile bool pending = false;     // a read is queued and has not started yet
+static volatile uint32_t event_us = 0;    // ticker value at the newest event
+static volatile uint32_t deadline_us = 0; // its timestamp, the deadline for SAMPLER_PACE_TIMER
+
+static uint32_t last_event_us = 0;
+static bool have_last_event = false;
+static Sampler_Stats stats;
+
+static const uint32_t sample_period_us = 1000000 / GYRO_ODR_HZ;
+
+static void ReadSample();
+
+// Count offset_us into its histogram bin; out of range goes to the outer bins
+static void Bin(uint32_t *histogram, int32_t offset_us)
+{
+    int32_t bin = offset_us < 0 ? 0 : offset_us / SAMPLER_HIST_BIN_US;
+    if (bin >= SAMPLER_HIST_BINS)
+        bin = SAMPLER_HIST_BINS - 1;
+    histogram[bin]++;
+}
+
+// DRDY edge or Ticker deadline (interrupt context). A read still queued
+// just picks up the newer sample; the gap shows up in the period.
+static void OnEvent()
+{
+    if (!running)
+        return;
+    event_us = us_ticker_read();
+#if SAMPLER_PACING == SAMPLER_PACE_TIMER
+    deadline_us = next_deadline_us;
+    next_deadline_us += sample_period_us;
+#else
+    deadline_us = event_us;
+#endif
+    if (!pending)
+    {
+        pending = true;
+        read_queue->call(ReadSample);
+    }
+}
+
+// Runs on the high-priority event thread
+static void ReadSample()
+{
+    core_util_critical_section_enter();
+    pending = false;
+    uint32_t event = event_us;
+    uint32_t timestamp = deadline_us;
+    core_util_critical_section_exit();
+    if (!running)
+        return;
+
+    uint32_t latency = us_ticker_read() - event;
+    Gyroscope_Sample sample = {timestamp, {0, 0, 0}};
+    GetCalibratedSample(&sample.data);
+    gyro_ring.push(sample);
+    ready_flags->set(ready_mask);
+
+    if (have_last_event)
+    {
+        uint32_t period = event - last_event_us;
+        if (period < stats.period_min_us)
+            stats.period_min_us = period;
+        if (period > stats.period_max_us)
+            stats.period_max_us = period;
+        Bin(stats.period_hist, (int32_t)(period - sample_period_us) + SAMPLER_HIST_BINS / 2 * SAMPLER_HIST_BIN_US);
+
+        // Events that came and went while this thread was busy
+        uint32_t periods = (period + sample_period_us / 2) / sample_period_us;
+        if (periods > 1)
+            stats.missed += periods - 1;
+    }
+    last_event_us = event;
+    have_last_event = true;
+
+    if (latency > stats.latency_max_us)
+        stats.latency_max_us = latency;
+    Bin(stats.latency_hist, (int32_t)latency);
+    stats.samples++;
+
+#if SAMPLER_PACING == SAMPLER_PACE_DRDY
+    // DRDY rose again during the read: no new edge will come until the data
+    // is read, so read it now instead of stalling
+    if (running && drdy_pin->read() == 1)
+    {
+        core_util_critical_section_enter();
+        OnEvent();
+        core_util_critical_section_exit();
+    }
+#endif
+}
+
+void SamplerInit(InterruptIn &drdy, EventFlags &flags, uint32_t ready_flag)
+{
+    drdy_pin = &drdy;
+    ready_flags = &flags;
+    ready_mask = ready_flag;
+
+    // Created here, in thread context; the shared queue is not ISR-safe to construct
+    read_queue = mbed_highprio_event_queue();
+#if SAMPLER_PACING == SAMPLER_PACE_DRDY
+    drdy.rise(callback(OnEvent));
+#endif
+}
+
+void SamplerStart()
+{
+    running = false;
+    gyro_ring.reset();
+    memset(&stats, 0, sizeof(stats));
+    stats.period_us = sample_period_us;
+    stats.period_min_us = UINT32_MAX;
+    have_last_event = false;
+
+    running = true;
+#if SAMPLER_PACING == SAMPLER_PACE_TIMER
+    next_deadline_us = us_ticker_read() + sample_period_us;
+    pace_ticker.attach(callback(OnEvent), std::chrono::microseconds(sample_period_us));
+#else
+    // DRDY may already be high from a sample nobody read
+    if (drdy_pin->read() == 1)
+    {
+        core_util_critical_section_enter();
+        OnEvent();
+        core_util_critical_section_exit();
+    }
+#endif
+}
+
+void SamplerStop()
+{
+    running = false;
+#if SAMPLER_PACING == SAMPLER_PACE_TIMER
+    pace_ticker.detach();
+#endif
+}
+
+Sampler_Stats GetSamplerStats()
+{
+    // Only the event thread writes the statistics, and it outranks every
+    // caller, so no update is half done while the caller runs
+    core_util_critical_section_enter();
+    Sampler_Stats snapshot = stats;
+    core_util_critical_section_exit();
+    return snapshot;
+}
+
+void SamplerPrintStats()
+{
+    Sampler_Stats s = GetSamplerStats();
+    printf("sampler: %lu samples, %lu missed, period %lu/%lu/%lu us (min/nominal/max), latency max %lu us\n",
+           (unsigned long)s.samples, (unsigned long)s.missed, (unsigned long)(s.samples > 1 ? s.period_min_us : 0),
+           (unsigned long)s.period_us, (unsigned long)s.period_max_us, (unsigned long)s.latency_max_us);
+
+    // Minimal printf has no field widths, so bins are separated by spaces
+    printf("sampler: period - nominal, %d us per bin from %d us:", SAMPLER_HIST_BIN_US,
+           -SAMPLER_HIST_BINS / 2 * SAMPLER_HIST_BIN_US);
+    for (int i = 0; i < SAMPLER_HIST_BINS; i++)
+        printf(" %lu", (unsigned long)s.period_hist[i]);
+    printf("\nsampler: latency, %d us per bin from 0:", SAMPLER_HIST_BIN_US);
+    for (int i = 0; i < SAMPLER_HIST_BINS; i++)
+        printf(" %lu", (unsigned long)s.latency_hist[i]);
+    printf("\n");
+}
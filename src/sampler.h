@@ -0,0 +1,72 @@
+/**
+ * @file sampler.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Drift-free per-sample gyroscope reads with period and latency
+ * histograms for the embedded sentry project.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <mbed.h>
+
+#include "acquisition.h"
+#include "system_config.h"
+
+// Timing of the per-sample reads, cumulative since the last SamplerStart().
+// An event is a DRDY edge or a Ticker deadline; its time is the sample's
+// timestamp in gyro_ring.
+typedef struct {
+  uint32_t samples;         // samples pushed into the ring
+  uint32_t missed;          // events lost because the previous read ran late
+  uint32_t period_us;       // nominal event period, 1 / GYRO_ODR_HZ
+  uint32_t period_min_us;   // shortest and longest time between two events
+  uint32_t period_max_us;
+  uint32_t latency_max_us;  // longest time from an event to its SPI read
+  // Event period minus period_us, SAMPLER_HIST_BIN_US per bin, centred on
+  // bin SAMPLER_HIST_BINS / 2; the outer bins collect everything beyond
+  uint32_t period_hist[SAMPLER_HIST_BINS];
+  // Event to read latency from 0, SAMPLER_HIST_BIN_US per bin
+  uint32_t latency_hist[SAMPLER_HIST_BINS];
+} Sampler_Stats;
+
+/**
+ * @brief Hook the sampler to the gyroscope INT2 line
+ * @param drdy: interrupt pin wired to the L3GD20 INT2/DRDY output, only
+ * used with SAMPLER_PACE_DRDY
+ * @param flags: event flags signalled when a new sample is in gyro_ring
+ * @param ready_flag: flag bit to set
+ */
+void SamplerInit(InterruptIn &drdy, EventFlags &flags, uint32_t ready_flag);
+
+/**
+ * @brief Clear the ring and the statistics, then read every sample into
+ * gyro_ring. The gyroscope must already be initialized with INT2_DRDY and
+ * the FIFO bypassed.
+ */
+void SamplerStart();
+
+/**
+ * @brief Stop reading; a read already queued still completes
+ */
+void SamplerStop();
+
+/**
+ * @brief Snapshot of the timing statistics
+ */
+Sampler_Stats GetSamplerStats();
+
+/**
+ * @brief Print the statistics and both histograms to the console
+ */
+void SamplerPrintStats();
+
+#endif  // SAMPLER_H
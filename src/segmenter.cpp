@@ -0,0 +1,81 @@
+/**
+ * @file segmenter.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Motion-triggered start/stop detection that cuts one gesture out of
+ * the sample stream for the embedded sentry project.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "segmenter.h"
+#include "pipeline.h"
+
+void GestureSegmenter::reset() {
+  ring_count_ = 0;
+  ring_head_ = 0;
+  run_ = 0;
+  state_ = SEGMENT_WAITING;
+}
+
+// Squared rate magnitude in dps^2; the fixed-point pipeline keeps raw counts
+float GestureSegmenter::energy(const GestureSample &sample) {
+  float sum = 0;
+  for (int i = 0; i < 3; i++) {
+#if GESTURE_FIXED_POINT
+    float rate = sample[i] * sensitivity;
+#else
+    float rate = sample[i];
+#endif
+    sum += rate * rate;
+  }
+  return sum;
+}
+
+/*******************************************************************************
+ *
+ * @brief Feed one filtered, decimated sample
+ * @param key: recording the gesture is appended to
+ * @param sample: the sample as record_sample() would store it
+ * @return number of samples appended to key, several on the trigger
+ *
+ * ****************************************************************************/
+size_t GestureSegmenter::add(GestureRecord &key, const GestureSample &sample) {
+  float e = energy(sample);
+
+  if (state_ == SEGMENT_WAITING) {
+    if (ring_count_ < SEGMENT_PRE_TRIGGER) {
+      ring_[(ring_head_ + ring_count_++) % SEGMENT_PRE_TRIGGER] = sample;
+    } else {
+      ring_[ring_head_] = sample;
+      ring_head_ = (ring_head_ + 1) % SEGMENT_PRE_TRIGGER;
+    }
+
+    run_ = e > SEGMENT_START_DPS * SEGMENT_START_DPS ? run_ + 1 : 0;
+    if (run_ < SEGMENT_START_SAMPLES) return 0;
+
+    // Triggered: the onset and the run that triggered go first
+    size_t appended = 0;
+    for (size_t i = 0; i < ring_count_; i++) {
+      if (key.push_back(ring_[(ring_head_ + i) % SEGMENT_PRE_TRIGGER])) appended++;
+    }
+    run_ = 0;
+    state_ = SEGMENT_ACTIVE;
+    return appended;
+  }
+
+  if (state_ == SEGMENT_DONE) return 0;
+
+  if (!key.push_back(sample)) {
+    state_ = SEGMENT_DONE;
+    return 0;
+  }
+  run_ = e < SEGMENT_STOP_DPS * SEGMENT_STOP_DPS ? run_ + 1 : 0;
+  if (run_ >= SEGMENT_STOP_SAMPLES) state_ = SEGMENT_DONE;
+  return 1;
+}
@@ -0,0 +1,72 @@
+/**
+ * @file segmenter.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Motion-triggered start/stop detection that cuts one gesture out of
+ * the sample stream for the embedded sentry project.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef SEGMENTER_H
+#define SEGMENTER_H
+
+#include <cstddef>
+
+#include "key_store.h"
+#include "system_config.h"
+
+static_assert(SEGMENT_PRE_TRIGGER >= SEGMENT_START_SAMPLES,
+              "the pre-trigger ring must hold the samples that trigger");
+static_assert(SEGMENT_STOP_DPS <= SEGMENT_START_DPS, "stop threshold above the start threshold");
+
+typedef enum {
+  SEGMENT_WAITING,  // no motion yet, samples go to the pre-trigger ring
+  SEGMENT_ACTIVE,   // gesture in progress, samples go to the recording
+  SEGMENT_DONE      // motion stopped or the recording is full
+} Segment_State;
+
+/**
+ * @brief Threshold detector with hysteresis on the squared rate magnitude of
+ * the working-rate samples. While waiting, the last SEGMENT_PRE_TRIGGER
+ * samples are kept in a ring; on the trigger they are moved to the
+ * recording ahead of the live samples. The quiet samples before the stop
+ * stay in the recording, trim_gyro_data() removes their exact zeros.
+ */
+class GestureSegmenter {
+ public:
+  GestureSegmenter() { reset(); }
+
+  /**
+   * @brief Forget the previous gesture and wait for motion again
+   */
+  void reset();
+
+  /**
+   * @brief Feed one filtered, decimated sample
+   * @param key: recording the gesture is appended to
+   * @param sample: the sample as record_sample() would store it
+   * @return number of samples appended to key, several on the trigger
+   */
+  size_t add(GestureRecord &key, const GestureSample &sample);
+
+  Segment_State state() const { return state_; }
+  bool started() const { return state_ != SEGMENT_WAITING; }
+  bool done() const { return state_ == SEGMENT_DONE; }
+
+ private:
+  static float energy(const GestureSample &sample);
+
+  GestureSample ring_[SEGMENT_PRE_TRIGGER];
+  size_t ring_count_;  // samples in the ring, oldest at ring_head_
+  size_t ring_head_;
+  size_t run_;         // consecutive samples above start / below stop
+  Segment_State state_;
+};
+
+#endif  // SEGMENTER_H
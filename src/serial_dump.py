@@ -2,26 +2,229 @@
 @file serial_dump.py
 @autho Xhovani Mali (xxm202)
 @brief Python script for dumping serial data in the embedded sentry project.
+Decodes the COBS framed telemetry stream (see telemetry.h): log frames are
+printed, sample frames are written to CSV and/or a numpy .npy file, and
+exported unlock attempts (see archive.h) to one CSV per attempt.
 @version 0.1
 @date 2024-12-15
 
 @group Members:
-- Xhovani Mali 
-- Shruti Pangare 
+- Xhovani Mali
+- Shruti Pangare
 - Temira Koenig
 """
 
+import argparse
+import binascii
+import csv
+import struct
+
+import numpy as np
 import serial
 
-# Connect to serial port
-ser = serial.Serial('COM4', 9600, timeout=1)
+FRAME_LOG = 1
+FRAME_SAMPLES = 2
+FRAME_ARCHIVE_RECORD = 3
+FRAME_ARCHIVE_DATA = 4
+
+ARCHIVE_RECORD = struct.Struct("<IIfBHI")  # sequence, timestamp_us, score, flags, samples, length
+ARCHIVE_DATA = struct.Struct("<II")        # sequence, offset
+ARCHIVE_ACCEPTED = 0x01
+ARCHIVE_TRUNCATED = 0x02
+
+# One sample on the wire, little-endian, calibrated raw counts
+SAMPLE = np.dtype([("timestamp_us", "<u4"), ("x", "<i2"), ("y", "<i2"), ("z", "<i2")])
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            raise ValueError("malformed COBS block")
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def varints(data):
+    """Zigzag LEB128 values."""
+    value = shift = 0
+    for byte in data:
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if byte < 0x80:
+            yield (value >> 1) ^ -(value & 1)
+            value = shift = 0
+
+
+def decode_attempt(timestamp_us, count, coded):
+    """Undo the archive's delta coding; rows as in SAMPLE."""
+    values = varints(coded)
+    rows = []
+    timestamp, delta, axes = timestamp_us, 0, [0, 0, 0]
+    for _ in range(count):
+        delta += next(values)
+        timestamp = (timestamp + delta) & 0xFFFFFFFF
+        axes = [a + next(values) for a in axes]
+        rows.append((timestamp, *axes))
+    return rows
+
+
+class ArchiveWriter:
+    """Collects exported attempts and writes PREFIX_<sequence>.csv for each,
+    plus a PREFIX_index.csv line with its score and outcome."""
+
+    def __init__(self, prefix):
+        self.prefix = prefix
+        self.records = {}
+        self.written = 0
+        self.index_file = open(f"{prefix}_index.csv", "w", newline="")
+        self.index = csv.writer(self.index_file)
+        self.index.writerow(("sequence", "timestamp_us", "score", "accepted", "truncated", "samples"))
+
+    def record(self, body):
+        sequence, timestamp_us, score, flags, samples, length = ARCHIVE_RECORD.unpack_from(body)
+        self.records[sequence] = (timestamp_us, score, flags, samples, bytearray(length), 0)
+        self.complete(sequence)
+
+    def data(self, body):
+        sequence, offset = ARCHIVE_DATA.unpack_from(body)
+        if sequence not in self.records:
+            return
+        timestamp_us, score, flags, samples, coded, received = self.records[sequence]
+        chunk = body[ARCHIVE_DATA.size:]
+        coded[offset:offset + len(chunk)] = chunk
+        self.records[sequence] = (timestamp_us, score, flags, samples, coded, received + len(chunk))
+        self.complete(sequence)
+
+    def complete(self, sequence):
+        timestamp_us, score, flags, samples, coded, received = self.records[sequence]
+        if received < len(coded):
+            return
+        del self.records[sequence]
+        with open(f"{self.prefix}_{sequence}.csv", "w", newline="") as f:
+            writer = csv.writer(f)
+            writer.writerow(SAMPLE.names)
+            writer.writerows(decode_attempt(timestamp_us, samples, coded))
+        self.index.writerow((sequence, timestamp_us, score, int(bool(flags & ARCHIVE_ACCEPTED)),
+                             int(bool(flags & ARCHIVE_TRUNCATED)), samples))
+        self.index_file.flush()
+        self.written += 1
 
-try:
+    def close(self):
+        self.index_file.close()
+
+
+class Decoder:
+    """Splits the byte stream at the 0x00 delimiters and checks each frame."""
+
+    def __init__(self):
+        self.pending = bytearray()
+        self.next_sequence = None
+        self.frames = 0
+        self.lost = 0     # frames missing from the sequence
+        self.corrupt = 0  # frames with a bad COBS block or CRC
+
+    def feed(self, chunk):
+        self.pending += chunk
+        *frames, self.pending = self.pending.split(b"\x00")
+        for encoded in frames:
+            if not encoded:
+                continue
+            try:
+                frame = cobs_decode(encoded)
+            except ValueError:
+                self.corrupt += 1
+                continue
+            if len(frame) < 4 or binascii.crc_hqx(frame[:-2], 0xFFFF) != int.from_bytes(frame[-2:], "little"):
+                self.corrupt += 1
+                continue
+
+            frame_type, sequence = frame[0], frame[1]
+            if self.next_sequence is not None:
+                self.lost += (sequence - self.next_sequence) & 0xFF
+            self.next_sequence = (sequence + 1) & 0xFF
+            self.frames += 1
+            yield frame_type, frame[2:-2]
+
+
+def dump_text(ser):
+    """Plain console, for firmware built with TELEMETRY_ENABLE 0."""
     while True:
-        if ser.in_waiting:
-            line = ser.readline().decode('utf-8').strip()
+        line = ser.readline().decode("utf-8", errors="replace").strip()
+        if line:
             print(line)
-except KeyboardInterrupt:
-    print("\nStopping...")
-finally:
-    ser.close()
+
+
+def dump_frames(ser, csv_writer, blocks, archive):
+    decoder = Decoder()
+    samples = 0
+    try:
+        while True:
+            for frame_type, body in decoder.feed(ser.read(max(1, ser.in_waiting))):
+                if frame_type == FRAME_LOG:
+                    print(body.decode("utf-8", errors="replace").rstrip("\r\n"))
+                elif frame_type == FRAME_SAMPLES and body:
+                    block = np.frombuffer(body, SAMPLE, count=body[0], offset=1)
+                    samples += len(block)
+                    if csv_writer:
+                        csv_writer.writerows(block.tolist())
+                    if blocks is not None:
+                        blocks.append(block)
+                elif frame_type == FRAME_ARCHIVE_RECORD and archive:
+                    archive.record(body)
+                elif frame_type == FRAME_ARCHIVE_DATA and archive:
+                    archive.data(body)
+    finally:
+        print(f"\n{decoder.frames} frames, {samples} samples, "
+              f"{decoder.lost} frames lost, {decoder.corrupt} corrupt")
+        if archive:
+            print(f"{archive.written} archived attempts written, {len(archive.records)} incomplete")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Embedded sentry serial monitor")
+    parser.add_argument("port", nargs="?", default="COM4")
+    parser.add_argument("--baud", type=int, default=921600)
+    parser.add_argument("--csv", help="write samples to this CSV file")
+    parser.add_argument("--npy", help="save samples to this .npy file on exit")
+    parser.add_argument("--archive", metavar="PREFIX",
+                        help="request the unlock attempt archive and write PREFIX_<n>.csv per attempt")
+    parser.add_argument("--text", action="store_true", help="plain text console, no telemetry frames")
+    args = parser.parse_args()
+
+    # Connect to serial port
+    ser = serial.Serial(args.port, args.baud, timeout=0.1)
+    csv_file = open(args.csv, "w", newline="") if args.csv else None
+    blocks = [] if args.npy else None
+    archive = ArchiveWriter(args.archive) if args.archive else None
+
+    try:
+        if args.text:
+            dump_text(ser)
+        else:
+            csv_writer = None
+            if csv_file:
+                csv_writer = csv.writer(csv_file)
+                csv_writer.writerow(SAMPLE.names)
+            if archive:
+                ser.write(b"a")  # console command: export the archive
+            dump_frames(ser, csv_writer, blocks, archive)
+    except KeyboardInterrupt:
+        print("\nStopping...")
+    finally:
+        ser.close()
+        if csv_file:
+            csv_file.close()
+        if archive:
+            archive.close()
+        if blocks:
+            np.save(args.npy, np.concatenate(blocks))
+
+
+if __name__ == "__main__":
+    main()
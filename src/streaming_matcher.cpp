@@ -0,0 +1,196 @@
+/**
+ * @file streaming_matcher.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Incremental correlation matcher that decides an unlock while the
+ * attempt is still being recorded, for the embedded sentry project.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "streaming_matcher.h"
+#include "trace.h"
+
+#if GESTURE_STREAMING_ACTIVE
+
+void StreamingMatcher::reset() {
+  for (int i = 0; i < 3; i++) mean_[i] = m2_[i] = 0.0f;
+  for (size_t slot = 0; slot < KEY_STORE_CAPACITY; slot++) {
+    for (int i = 0; i < 3; i++) c_ab_[slot][i] = 0.0f;
+    state_[slot] = TEMPLATE_OPEN;
+  }
+  consumed_ = 0;
+  started_ = false;
+  decision_ = STREAM_PENDING;
+  slot_ = 0;
+}
+
+/*******************************************************************************
+ *
+ * @brief Start a new attempt against the current templates
+ * @param store: enrolled templates, must not change during the attempt
+ *
+ * ****************************************************************************/
+void StreamingMatcher::begin(const KeyStore &store) {
+  store_ = &store;
+  reset();
+  if (store.empty()) decision_ = STREAM_REJECT;
+}
+
+/*******************************************************************************
+ *
+ * @brief Correlation with one template over the samples paired so far
+ * @param slot: template
+ * @param axis: 0 = x, 1 = y, 2 = z
+ * @return correlation in [-1, 1], or NaN if either side has no variation
+ *
+ * ****************************************************************************/
+float StreamingMatcher::result(size_t slot, int axis) const {
+  size_t n = std::min(consumed_, store_->samples(slot).size());
+  float denominator = n > 0 ? m2_[axis] * store_->moments(slot).m2[axis][n - 1] : 0.0f;
+  if (!(denominator > 0.0f)) return std::numeric_limits<float>::quiet_NaN();
+  return c_ab_[slot][axis] / sqrt(denominator);
+}
+
+/*******************************************************************************
+ *
+ * @brief Weakest-axis correlation of the best template so far
+ * @return correlation, or NaN before any template has variation
+ *
+ * ****************************************************************************/
+float StreamingMatcher::score() const {
+  float best = std::numeric_limits<float>::quiet_NaN();
+  for (size_t slot = 0; slot < store_->size(); slot++) {
+    float weakest = 1.0f;
+    for (int i = 0; i < 3; i++) {
+      float r = result(slot, i);
+      if (!(r >= weakest)) weakest = r;
+    }
+    if (weakest > best || !(best == best)) best = weakest;
+  }
+  return best;
+}
+
+/*******************************************************************************
+ *
+ * @brief Decide one template
+ * @param slot: template to check
+ * @param final: no more samples will be paired with this template
+ * @return new state of the template
+ *
+ * ****************************************************************************/
+StreamingMatcher::Template_State StreamingMatcher::evaluate(size_t slot, bool final) const {
+  if (final) {
+    for (int i = 0; i < 3; i++) {
+      if (!(result(slot, i) > CORRELATION_THRESHOLD)) return TEMPLATE_REJECTED;
+    }
+    return TEMPLATE_ACCEPTED;
+  }
+
+  size_t n = std::min(consumed_, store_->samples(slot).size());
+  if (n < STREAM_MIN_SAMPLES) return TEMPLATE_OPEN;
+
+  // atanh(r) is roughly normal with standard error 1 / sqrt(n - 3)
+  const float z_threshold = atanhf(CORRELATION_THRESHOLD);
+  const float margin = STREAM_CONFIDENCE_Z / sqrtf((float)(n - 3));
+  bool all_above = true;
+  for (int i = 0; i < 3; i++) {
+    float r = result(slot, i);
+    if (!(r == r)) return TEMPLATE_OPEN;  // no variation on this axis yet
+    if (r > 0.9999f) r = 0.9999f;
+    if (r < -0.9999f) r = -0.9999f;
+
+    float z = atanhf(r);
+    if (z + margin < z_threshold) return TEMPLATE_REJECTED;
+    if (z - margin <= z_threshold) all_above = false;
+  }
+  return all_above ? TEMPLATE_ACCEPTED : TEMPLATE_OPEN;
+}
+
+/*******************************************************************************
+ *
+ * @brief Feed one smoothed, not yet normalized sample of the attempt
+ * @param sample: the sample as stored in the recording buffer
+ * @return decision so far
+ *
+ * ****************************************************************************/
+Stream_Decision StreamingMatcher::add(const array<float, 3> &sample) {
+  if (decided()) return decision_;
+
+  // Leading silence, same threshold as trim_gyro_data()
+  const float threshold = 0.00001;
+  if (!started_ && abs(sample[0]) <= threshold && abs(sample[1]) <= threshold &&
+      abs(sample[2]) <= threshold) {
+    return decision_;
+  }
+  started_ = true;
+  TraceSpan span(TRACE_CORRELATION);
+
+  // normalize() is per sample, so it can run ahead of the recording
+  array<float, 3> unit = sample;
+  float magnitude = sqrt(unit[0] * unit[0] + unit[1] * unit[1] + unit[2] * unit[2]);
+  if (magnitude > 0) {
+    for (int i = 0; i < 3; i++) unit[i] /= magnitude;
+  }
+
+  // Welford update of the attempt side, once for all templates
+  size_t j = consumed_++;
+  float delta[3];
+  for (int i = 0; i < 3; i++) {
+    delta[i] = unit[i] - mean_[i];
+    mean_[i] += delta[i] / consumed_;
+    m2_[i] += delta[i] * (unit[i] - mean_[i]);
+  }
+
+  bool open = false;
+  for (size_t slot = 0; slot < store_->size(); slot++) {
+    if (state_[slot] != TEMPLATE_OPEN) continue;
+
+    // Co-moment update against the template's precomputed prefix mean
+    const GestureRecord &key = store_->samples(slot);
+    if (j < key.size()) {
+      const GestureMoments &moments = store_->moments(slot);
+      for (int i = 0; i < 3; i++) c_ab_[slot][i] += delta[i] * (key[j][i] - moments.mean[i][j]);
+    }
+    state_[slot] = evaluate(slot, consumed_ >= key.size());
+
+    if (state_[slot] == TEMPLATE_ACCEPTED) {
+      decision_ = STREAM_ACCEPT;
+      slot_ = slot;
+      return decision_;
+    }
+    if (state_[slot] == TEMPLATE_OPEN) open = true;
+  }
+
+  if (!open) decision_ = STREAM_REJECT;
+  return decision_;
+}
+
+/*******************************************************************************
+ *
+ * @brief Final decision when the recording window ends undecided
+ * @return STREAM_ACCEPT or STREAM_REJECT
+ *
+ * ****************************************************************************/
+Stream_Decision StreamingMatcher::finish() {
+  if (decided()) return decision_;
+
+  for (size_t slot = 0; slot < store_->size(); slot++) {
+    if (state_[slot] != TEMPLATE_OPEN) continue;
+    state_[slot] = evaluate(slot, true);
+    if (state_[slot] == TEMPLATE_ACCEPTED) {
+      decision_ = STREAM_ACCEPT;
+      slot_ = slot;
+      return decision_;
+    }
+  }
+  decision_ = STREAM_REJECT;
+  return decision_;
+}
+
+#endif  // GESTURE_STREAMING_ACTIVE
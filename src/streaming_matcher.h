@@ -0,0 +1,105 @@
+/**
+ * @file streaming_matcher.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Incremental correlation matcher that decides an unlock while the
+ * attempt is still being recorded, for the embedded sentry project.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef STREAMING_MATCHER_H
+#define STREAMING_MATCHER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "key_store.h"
+#include "system_config.h"
+#include "utilities.h"
+
+// Streaming needs the float correlation matcher; other builds match in batch
+#define GESTURE_STREAMING_ACTIVE \
+  (GESTURE_STREAMING_MATCH && !GESTURE_FIXED_POINT && GESTURE_MATCHER == GESTURE_MATCHER_CORRELATION)
+
+#if GESTURE_STREAMING_ACTIVE
+
+typedef enum {
+  STREAM_PENDING,  // keep recording
+  STREAM_ACCEPT,   // some template is confidently above the threshold
+  STREAM_REJECT    // no template can still pass
+} Stream_Decision;
+
+/**
+ * @brief Pairs every new attempt sample with the same-index sample of each
+ * template. The attempt's running moments are shared, the templates' come
+ * precomputed from the store, so each template only adds one co-moment per
+ * axis. Once a template's samples are used up its correlation is exact. Before that, a Fisher-z
+ * interval with STREAM_CONFIDENCE_Z half-width (in standard errors) around
+ * each axis correlation decides early: all three lower bounds above
+ * CORRELATION_THRESHOLD accepts, any upper bound below it rejects.
+ */
+class StreamingMatcher {
+ public:
+  StreamingMatcher() : store_(nullptr) { reset(); }
+
+  /**
+   * @brief Start a new attempt against the current templates
+   * @param store: enrolled templates, must not change during the attempt
+   */
+  void begin(const KeyStore &store);
+
+  /**
+   * @brief Feed one smoothed, not yet normalized sample of the attempt.
+   * Leading silence is skipped, matching trim_gyro_data().
+   * @param sample: the sample as stored in the recording buffer
+   * @return decision so far
+   */
+  Stream_Decision add(const array<float, 3> &sample);
+
+  /**
+   * @brief Final decision when the recording window ends undecided; the
+   * batch matcher would cut every template to the attempt's length too
+   * @return STREAM_ACCEPT or STREAM_REJECT
+   */
+  Stream_Decision finish();
+
+  bool decided() const { return decision_ != STREAM_PENDING; }
+  Stream_Decision decision() const { return decision_; }
+  size_t slot() const { return slot_; }          // accepted template
+  size_t samples() const { return consumed_; }   // attempt samples used
+
+  /**
+   * @brief Weakest-axis correlation of the best template over the samples
+   * paired so far, as the batch matcher would score it
+   * @return correlation, or NaN before any template has variation
+   */
+  float score() const;
+
+ private:
+  typedef enum { TEMPLATE_OPEN, TEMPLATE_REJECTED, TEMPLATE_ACCEPTED } Template_State;
+
+  void reset();
+  Template_State evaluate(size_t slot, bool final) const;
+
+  float result(size_t slot, int axis) const;
+
+  const KeyStore *store_;
+  float mean_[3], m2_[3];                   // attempt moments so far
+  float c_ab_[KEY_STORE_CAPACITY][3];       // co-moments with each template
+  Template_State state_[KEY_STORE_CAPACITY];
+  size_t consumed_;
+  bool started_;
+  Stream_Decision decision_;
+  size_t slot_;
+};
+
+#endif  // GESTURE_STREAMING_ACTIVE
+
+#endif  // STREAMING_MATCHER_H
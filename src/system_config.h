@@ -16,27 +16,96 @@
 #ifndef SYSTEM_CONFIG_H
 #define SYSTEM_CONFIG_H
 
+// The signal processing and matching sources also build on the host for
+// the replay harness (env:native); there is no mbed and no BSP there
+#ifndef GESTURE_HOST_BUILD
+#define GESTURE_HOST_BUILD 0
+#endif
+
+#if !GESTURE_HOST_BUILD
 #include <mbed.h>
+#endif
 #include <array>
 #include <cmath>
 #include <cstdio>
 #include <limits>
 #include <vector>
 
+#if GESTURE_HOST_BUILD
+using namespace std;  // what mbed.h provides on the target
+#else
 #include "drivers/LCD_DISCO_F429ZI.h"
 #include "drivers/TS_DISCO_F429ZI.h"
+#endif
 
 #define CTRL_REG_1 0x20  // control register 1
+#define CTRL_REG_2 0x21  // control register 2 (high-pass filter)
 #define CTRL_REG_3 0x22  // control register 3
 #define CTRL_REG_4 0x23  // control register 4
+#define CTRL_REG_5 0x24  // control register 5
+#define REFERENCE 0x25   // high-pass reference, reading it resets the filter
+
+#define OUT_TEMP 0x26  // temperature, -1 LSB/degC, offset not calibrated
 
 #define OUT_X_L 0x28  // X-axis angular rate data Low
 
-// Output data rate selections and cutoff frequencies
+#define FIFO_CTRL_REG 0x2E  // FIFO control register
+#define FIFO_SRC_REG 0x2F   // FIFO source register
+#define INT1_CFG 0x30       // INT1 generator configuration
+#define INT1_THS_XH 0x32    // INT1 thresholds, XH XL YH YL ZH ZL
+#define INT1_DURATION 0x38  // INT1 minimum event duration in ODR samples
+
+// Output data rate selections and cutoff frequencies (CTRL_REG1 DR1:0 BW1:0)
+#define ODR_100_CUTOFF_25 0x10
 #define ODR_200_CUTOFF_50 0x60
+#define ODR_400_CUTOFF_110 0xB0
+#define ODR_800_CUTOFF_110 0xF0
+
+// Output data rate in Hz: 95, 190, 380 or 760 (the datasheet's 100/200/400/800
+// modes). The sensor's low-pass cutoff is 25 and 50 Hz (about ODR/4) at the two
+// lower rates and 110 Hz at both upper rates (about ODR/3.5 and ODR/7); the
+// decimation filter below takes care of the working rate.
+#ifndef GYRO_ODR_HZ
+#define GYRO_ODR_HZ 190
+#endif
+// GYRO_HPF_CONFIG is the CTRL_REG2 HPCF code for a 0.09 Hz high-pass cutoff,
+// which scales with the ODR
+#if GYRO_ODR_HZ == 95
+#define GYRO_ODR_CONFIG ODR_100_CUTOFF_25
+#define GYRO_HPF_CONFIG 0x06
+#elif GYRO_ODR_HZ == 190
+#define GYRO_ODR_CONFIG ODR_200_CUTOFF_50
+#define GYRO_HPF_CONFIG 0x07
+#elif GYRO_ODR_HZ == 380
+#define GYRO_ODR_CONFIG ODR_400_CUTOFF_110
+#define GYRO_HPF_CONFIG 0x08
+#elif GYRO_ODR_HZ == 760
+#define GYRO_ODR_CONFIG ODR_800_CUTOFF_110
+#define GYRO_HPF_CONFIG 0x09
+#else
+#error "GYRO_ODR_HZ must be 95, 190, 380 or 760"
+#endif
 
 // Interrupt configurations
 #define INT2_DRDY 0x08  // Data ready on DRDY/INT2 pin
+#define INT2_WTM 0x04   // FIFO watermark on DRDY/INT2 pin
+#define INT1_ENABLE 0x80        // CTRL_REG3 I1_Int1: INT1 generator on the INT1 pin
+#define INT1_CFG_HIGH_XYZ 0x2A  // INT1_CFG: X, Y or Z high event, OR-ed, not latched
+
+// High-pass filter (CTRL_REG5)
+#define HPF_ENABLE 0x10    // HPen
+#define INT1_SEL_HPF 0x04  // INT1 generator works on high-pass filtered data
+#define OUT_SEL_HPF 0x01   // output registers and FIFO hold high-pass filtered data
+
+// FIFO configuration
+#define FIFO_ENABLE 0x40       // CTRL_REG5 FIFO_EN bit
+#define FIFO_MODE_BYPASS 0x00  // FIFO_CTRL_REG FM2:0 = 000
+#define FIFO_MODE_STREAM 0x40  // FIFO_CTRL_REG FM2:0 = 010
+#define FIFO_WTM_MASK 0x1F     // FIFO_CTRL_REG watermark level bits
+#define FIFO_SRC_OVRN 0x40     // FIFO_SRC_REG overrun (all 32 slots full)
+#define FIFO_SRC_EMPTY 0x20    // FIFO_SRC_REG empty
+#define FIFO_SRC_FSS_MASK 0x1F // FIFO_SRC_REG stored data level
+#define FIFO_DEPTH 32          // L3GD20 FIFO length in samples
 
 // Fullscale selections
 #define FULL_SCALE_245 0x00       // full scale 245 dps
@@ -55,17 +124,335 @@
 
 #define POWERON 0x0f  // turn gyroscope
 
+// Gyroscope SPI bus
+#define GYRO_SPI_MAX_FREQUENCY 10000000  // L3GD20 SPI clock limit (10 MHz)
+#define GYRO_SPI_FREQUENCY 10000000      // requested SPI clock in Hz
+#define GYRO_SPI_ASYNC 1  // non-blocking (interrupt/DMA) burst reads where supported
+
 // Event flags for event handler ()
 #define KEY_FLAG 1
 #define UNLOCK_FLAG 2
 #define ERASE_FLAG 4
 #define DATA_READY_FLAG 8
+#define SAMPLES_READY_FLAG 16
+#define TOUCH_FLAG 32
+#define WAKE_FLAG 64
+#define BOOT_FLAG 128  // templates loaded, the controller may take requests
+
+// Gyroscope acquisition. In FIFO mode the sensor buffers samples at the full
+// ODR and raises INT2 once per GYRO_FIFO_WATERMARK samples; the whole FIFO is
+// then drained in one burst. Every sample is low-pass filtered at the full
+// ODR and every GYRO_FIFO_DECIMATION-th output is kept, so recordings stay at
+// the ~19 Hz working rate the matcher was tuned for whatever the ODR.
+#define GYRO_USE_FIFO 1          // 0: one DRDY interrupt and SPI read per sample
+#define GYRO_FIFO_WATERMARK 20   // samples per watermark interrupt (< FIFO_DEPTH)
+#define GESTURE_WORKING_RATE_HZ 19
+#define GYRO_FIFO_DECIMATION (GYRO_ODR_HZ / GESTURE_WORKING_RATE_HZ)  // 5, 10, 20 or 40
+
+// Per-sample path (GYRO_USE_FIFO 0): the high-priority event thread reads
+// every sample at the full ODR, paced by the L3GD20's DRDY line or by a
+// hardware Ticker on absolute deadlines, and the pipeline decimates by
+// count, so the working rate does not depend on the system load. The period
+// and read latency are kept as histograms (see sampler.h).
+#define SAMPLER_PACE_DRDY 0   // one read per DRDY edge, timed by the sensor clock
+#define SAMPLER_PACE_TIMER 1  // one read per Ticker deadline, reads the newest output
+#ifndef SAMPLER_PACING
+#define SAMPLER_PACING SAMPLER_PACE_DRDY
+#endif
+#define SAMPLER_HIST_BINS 16     // bins per histogram
+#define SAMPLER_HIST_BIN_US 250  // histogram resolution
+
+// Anti-aliasing ahead of the decimation: 1 = CIC response (GYRO_DECIMATOR_ORDER
+// cascaded GYRO_FIFO_DECIMATION-sample moving averages) run as a polyphase
+// FIR, GYRO_DECIMATOR_ORDER multiply-adds per axis per input at any ODR;
+// 0 = the original SMOOTHING_WINDOW moving average, which barely attenuates
+// what aliases into the working band
+#ifndef GESTURE_CIC_DECIMATION
+#define GESTURE_CIC_DECIMATION 1
+#endif
+// Moving average length of the smoothing chain in pipeline.cpp, used on every
+// path with GESTURE_CIC_DECIMATION 0; powers of two use a mask and a shift
+#define SMOOTHING_WINDOW 5
+#define GYRO_DECIMATOR_ORDER 3  // nulls at multiples of the working rate, -12 dB at its Nyquist
+
+// Zero-rate bias calibration. Taken once (or restored from the EEPROM) and
+// then tracked on stationary samples; a full re-calibration only runs when
+// the die temperature or the tracked bias has moved too far.
+#define GYRO_CALIBRATION_SAMPLES 128  // samples averaged per calibration
+#define GYRO_THRESHOLD_MARGIN 2       // counts added to the peak noise dead-band
+#define GYRO_RECAL_TEMP_DELTA 5       // degC change that forces a re-calibration
+#define GYRO_DRIFT_SHIFT 8            // tracker time constant, 2^N stationary samples
+#define GYRO_DRIFT_LIMIT 20           // counts of tracked drift that force a re-calibration
+
+// Hardware motion gating. The L3GD20 high-pass filter takes the zero-rate
+// bias out of the output data, and its INT1 generator flags rates above
+// GYRO_MOTION_THRESHOLD_DPS on any axis. Samples are only read and processed
+// while INT1 is up, and for GYRO_MOTION_HOLD_MS after it falls; what the
+// FIFO holds when it rises is kept as pre-roll. Replaces the software bias,
+// drift tracking and dead-band. Needs the asynchronous FIFO path.
+#ifndef GYRO_HW_MOTION
+#define GYRO_HW_MOTION 0
+#endif
+#define GYRO_MOTION_THRESHOLD_DPS 10.0f  // INT1 threshold per axis
+#define GYRO_MOTION_DURATION 2           // ODR samples above the threshold before INT1 rises
+#define GYRO_MOTION_HOLD_MS 300          // keep reading this long after INT1 falls
+#define GYRO_INT1_PIN PA_1               // L3GD20 INT1 on the Discovery board
+
+// Gesture recording window; gesture buffers are sized from these at compile time
+#define GESTURE_RECORD_WINDOW_MS 3000  // length of one record / unlock attempt
+#define GESTURE_SAMPLE_RATE_HZ 20      // upper bound on the recording sample rate
+#define GESTURE_BUFFER_MARGIN 4        // spare samples for timer slack
+
+// Automatic segmentation: instead of a countdown and a fixed window the
+// recording starts when the rate magnitude stays above SEGMENT_START_DPS and
+// ends once it has stayed below SEGMENT_STOP_DPS for SEGMENT_STOP_SAMPLES.
+// The samples just before the trigger come from a pre-trigger ring, so the
+// onset is kept. A gesture is still limited to GESTURE_RECORD_WINDOW_MS.
+#ifndef GESTURE_SEGMENT
+#define GESTURE_SEGMENT 1
+#endif
+#define SEGMENT_START_DPS 30.0f       // rate magnitude that starts a gesture
+#define SEGMENT_STOP_DPS 15.0f        // rate magnitude under which it may end (hysteresis)
+#define SEGMENT_START_SAMPLES 2       // working-rate samples above start to trigger
+#define SEGMENT_STOP_SAMPLES 10       // samples below stop to end (~0.5 s)
+#define SEGMENT_PRE_TRIGGER 6         // samples kept from before the trigger, run included
+#define SEGMENT_ARM_MS 300            // settle time after the touch before arming
+#define SEGMENT_START_TIMEOUT_MS 5000 // give up if no motion starts within this
+
+// Fast unlock: the tap goes straight to one short prompt. The sensor stays
+// configured between attempts and a valid cached bias is reused (a stale one
+// is refreshed by the next enrollment or idle wake), the acquisition is armed
+// at once and the samples of the tap itself only warm the filters. Every
+// unlock reports the latency from the tap to its first recorded sample.
+#ifndef FAST_UNLOCK
+#define FAST_UNLOCK 1
+#endif
+#define FAST_UNLOCK_SETTLE_MS 300  // samples this soon after the tap are not recorded, as SEGMENT_ARM_MS
+#define FAST_UNLOCK_BUDGET_MS 500  // tap-to-ready latency above this is reported as over budget
+
+// Controller state machine (main.cpp): how often a recording is checked for
+// its end when no samples arrive, and how long a result stays the current
+// state before the idle timeout starts counting
+#define CONTROLLER_POLL_MS 50
+#define CONTROLLER_RESULT_MS 2000
+
+// Signal-processing backend for normalize(), the correlation kernel and the
+// cross-correlation FFT.
+// 1 uses CMSIS-DSP (needs arm_math.h and ARM_MATH_CM4, see platformio.ini);
+// 0 uses the portable scalar reference code.
+#ifndef GESTURE_USE_CMSIS_DSP
+#define GESTURE_USE_CMSIS_DSP 0
+#endif
+
+// 1 = keep gestures as int16 Q15 from the raw reading to the correlation
+// (no FPU needed, half the memory), 0 = float pipeline
+#ifndef GESTURE_FIXED_POINT
+#define GESTURE_FIXED_POINT 0
+#endif
+
+// Unlock matcher: straight per-axis correlation of the truncated
+// recordings, dynamic time warping which tolerates speed/offset changes, a
+// cascade of a feature gate, the correlation and DTW for borderline cases,
+// or the FFT cross-correlation at the best common shift of the three axes
+#define GESTURE_MATCHER_CORRELATION 0
+#define GESTURE_MATCHER_DTW 1
+#define GESTURE_MATCHER_CASCADE 2
+#define GESTURE_MATCHER_XCORR 3
+#ifndef GESTURE_MATCHER
+#define GESTURE_MATCHER GESTURE_MATCHER_CORRELATION
+#endif
+
+#define DTW_BAND 8        // warping band half-width in samples (0.4 s at 20 Hz)
+#define DTW_MAX_BAND 16   // compile-time limit on DTW_BAND, sizes the row buffers
+// Tuned with the replay harness: no false accepts or rejects from .06 to .15
+#define DTW_THRESHOLD .10f  // max mean (1 - cos) per path step to accept
+
+#define XCORR_MAX_LAG 10        // largest probe/template shift tried, samples (0.5 s at 20 Hz)
+#define XCORR_THRESHOLD .70f    // min weakest axis cross-correlation at the best shift
+
+// Cascade stage 1 rejects a template when any summary differs by more than
+// its limit; stage 2 accepts above CORRELATION_THRESHOLD, rejects below
+// CASCADE_BORDER_CORRELATION and hands the rest to LB_Keogh and DTW.
+#define CASCADE_MAX_DURATION_RATIO 2.0f   // longer / shorter recording
+#define CASCADE_MAX_ENERGY_DISTANCE 0.6f  // L1 distance of the per-axis energy shares
+#define CASCADE_MAX_CROSSING_DIFF 0.2f    // sign changes per sample, any axis
+#define CASCADE_PAA_SEGMENTS 4            // piecewise means per axis
+#define CASCADE_MAX_PAA_DISTANCE 0.6f     // mean |difference| of the piecewise means
+#define CASCADE_BORDER_CORRELATION 0.5f   // weakest axis correlation worth a DTW run
+
+// Decide unlocks while the attempt is recorded (float correlation matcher
+// only). Samples within a gesture are strongly correlated, so the Fisher-z
+// interval is kept wide and needs a second of motion before it can decide.
+#ifndef GESTURE_STREAMING_MATCH
+#define GESTURE_STREAMING_MATCH 1
+#endif
+#define STREAM_MIN_SAMPLES 20      // samples before an early decision (1 s)
+#define STREAM_CONFIDENCE_Z 3.0f   // interval half-width in standard errors
+
+// Key store: enrolled templates (several users, several variants each)
+#define KEY_STORE_CAPACITY 4
+#define CORRELATION_PAA_BLOCK 8   // samples per block of the correlation matcher's upper bound
+#define KEY_STORE_DEFAULT_USER 0  // owner tag for keys recorded from the touch UI
+#define KEY_STORAGE_BASE 0x0000   // EEPROM address of the persistent key area
+
+// Sample ring between the gyro ISR/DMA completion and the processing thread
+#define SAMPLE_RING_SIZE 256   // timestamped samples, power of two (~1.3 s at 190 Hz, ~0.3 s at 760 Hz)
+#define SAMPLE_BATCH_SIZE 32   // samples moved out of the ring per pop
+
 // on board discovery button
 #define USER_BUTTON PA_0
 
 // LCD font size
 #define FONT_SIZE 16
 
+// background layer in RGB565 instead of ARGB8888: half the SDRAM and LTDC
+// scan-out bandwidth, nothing on that layer uses alpha
+#ifndef LCD_RGB565
+#define LCD_RGB565 1
+#endif
+// draw into a back buffer and flip it in at vertical blanking, no flicker
+#ifndef LCD_DOUBLE_BUFFER
+#define LCD_DOUBLE_BUFFER 1
+#endif
+// after a flip copy only the rectangles that changed, not the whole frame
+#ifndef LCD_DAMAGE_COPY
+#define LCD_DAMAGE_COPY 1
+#endif
+
+// staged start-up: no LCD set-up before main(), UiInit() configures layer 0
+// only and clears it on the DMA2D while the templates load and the gyroscope
+// powers up; the console reports the time of each boot phase
+#ifndef FAST_BOOT
+#define FAST_BOOT 1
+#endif
+
+// queue DMA2D fills and glyphs and chain them from its interrupt, so the UI
+// thread sleeps while they run instead of polling each transfer
+#ifndef LCD_DMA2D_ASYNC
+#define LCD_DMA2D_ASYNC 1
+#endif
+
+// UI thread: mailbox depth, frame period (updates to one region within a
+// frame are drawn once), text length and status line position
+#define UI_QUEUE_DEPTH 16
+#define UI_FRAME_MS 20
+#define UI_TEXT_LENGTH 32
+#ifndef UI_THREAD_STACK_SIZE
+#define UI_THREAD_STACK_SIZE 2048
+#endif
+#define UI_STATUS_X 5
+#define UI_STATUS_Y 270
+// status line on its own LTDC layer 1 window with a one-line frame buffer,
+// composited over layer 0 in hardware: an update rewrites 7.5 KB and never
+// the main frame buffer; 0 draws it into layer 0
+#ifndef UI_STATUS_OVERLAY
+#define UI_STATUS_OVERLAY 1
+#endif
+#define UI_POWER_TIMEOUT_MS 200  // wait for the UI thread to switch the display on or off
+
+// Tracing spans on the DWT cycle counter, per pipeline stage (trace.h). Cheap
+// enough to leave on; send 't' on the console to dump them, 'r' to reset.
+#ifndef TRACE_ENABLE
+#define TRACE_ENABLE 1
+#endif
+#define TRACE_BUFFER_SIZE 128  // newest spans kept, power of two
+#define TRACE_DUMP_EVENTS 16   // newest spans printed by a dump
+
+// Memory report (memstats.h): heap peak and fragmentation, per-thread stack
+// high-water marks and the key store footprint; send 'm' on the console.
+// Relies on the platform.*-stats-enabled options in mbed_app.json.
+#ifndef MEMSTATS_ENABLE
+#define MEMSTATS_ENABLE 1
+#endif
+#define MEMSTATS_MAX_THREADS 12  // threads listed by a report
+
+// On-target kernel benchmark (src/bench, env:disco_f429zi_bench*), run in
+// place of the application. Inputs are a fixed synthetic gesture, one
+// recording window captured live at boot and, with BENCH_RECORDED_TRACE,
+// src/bench/recorded.inc.
+#define BENCH_PASSES 20       // runs of every kernel per input
+#define BENCH_SPI_READS 256   // GetGyroValue() / StartGyroReadAsync() calls
+#ifndef BENCH_RECORDED_TRACE
+#define BENCH_RECORDED_TRACE 0
+#endif
+
+// Core-coupled memory: 64 KB at 0x10000000 without wait states, reachable
+// by the CPU only. No DMA or DMA2D master can access it, so no transfer
+// buffer may live there, not even on a thread stack placed there. CCM_DATA
+// moves a hot CPU-only object into it (scripts/ccm.ld, linked in by
+// scripts/ccm.py, which also prints what ended up where); its initial image
+// is copied from flash before the C++ constructors run. CCM_NOINIT is for
+// storage that is written before it is read, such as thread stacks.
+#ifndef CCM_ENABLE
+#define CCM_ENABLE 1
+#endif
+#if CCM_ENABLE && !GESTURE_HOST_BUILD
+#define CCM_DATA __attribute__((section(".ccm_data")))
+#define CCM_NOINIT __attribute__((section(".ccm_noinit")))
+#else
+#define CCM_DATA
+#define CCM_NOINIT
+#endif
+#define CCM_SIZE 0x10000
+
+// Application thread stacks (mbed's default is 4096); shrink them to what
+// the memory report shows plus a margin
+#ifndef GYRO_THREAD_STACK_SIZE
+#define GYRO_THREAD_STACK_SIZE 4096
+#endif
+#ifndef TOUCH_THREAD_STACK_SIZE
+#define TOUCH_THREAD_STACK_SIZE 4096
+#endif
+
+// Binary telemetry (telemetry.h): the console UART carries COBS frames with
+// the log text and every ring sample at the full ODR, sent by DMA. Decode
+// with src/serial_dump.py; with 0 the console is plain text again.
+#ifndef TELEMETRY_ENABLE
+#define TELEMETRY_ENABLE 1
+#endif
+#define TELEMETRY_BAUD 921600
+#define TELEMETRY_TX_BUFFER 4096   // encoded bytes queued for the DMA, power of two
+#define TELEMETRY_RX_BUFFER 64     // console input bytes, power of two
+#define TELEMETRY_LINE_LENGTH 128  // console text per log frame
+
+// Unlock attempt archive (archive.h): every attempt's full-rate trace, delta
+// and varint coded, written by DMA into SDRAM above the LCD buffers (which
+// end below +0x450000), with its score and outcome. Send 'a' on the console
+// to export it as telemetry frames. Lost on reset.
+#ifndef ARCHIVE_ENABLE
+#define ARCHIVE_ENABLE 1
+#endif
+#define ARCHIVE_SDRAM_OFFSET 0x500000   // from the start of SDRAM
+#define ARCHIVE_SDRAM_SIZE 0x300000     // up to the end of its 8 MB
+#define ARCHIVE_MAX_RECORDS 128         // attempts indexed, oldest dropped first
+#define ARCHIVE_MAX_RECORD_BYTES 16384  // coded bytes per attempt, the rest is truncated
+#define ARCHIVE_STAGE_BYTES 512         // SRAM staging per DMA transfer, two of them, multiple of 4
+#define ARCHIVE_EXPORT_CHUNK 192        // coded bytes per export frame
+
+// Touch screen. The STMPE811 INT line (PA15) wakes the touch thread on touch
+// down and whenever TOUCH_FIFO_THRESHOLD samples are buffered; the FIFO is
+// then drained in one I2C burst. Nothing is read while the panel is idle.
+#define TOUCH_INTERRUPT_PIN PA_15
+#define TOUCH_FIFO_THRESHOLD 4  // samples per interrupt (<= TS_FIFO_BURST_MAX)
+#define TOUCH_TAP_GAP_MS 150    // a touch this long after the last report is a new tap
+
+// Idle power state. After IDLE_TIMEOUT_MS without a request the gyroscope
+// is powered down or left watching for motion on INT1, the panel and the
+// LTDC scan-out are switched off with the frame buffers held in SDRAM
+// self-refresh, and the console releases its deep-sleep lock so the MCU can
+// enter Stop mode. INT1 motion, a touch or the user button wake it up; that
+// first touch or press only wakes, it does not act on the buttons.
+#ifndef IDLE_ENABLE
+#define IDLE_ENABLE 1
+#endif
+#define IDLE_TIMEOUT_MS 30000
+#define IDLE_WAKE_ON_MOTION 1    // 1: gyro stays on at 95 Hz (~6 mA) for INT1, 0: power-down (~5 uA)
+#define IDLE_HPF_CONFIG 0x06     // CTRL_REG2 HPCF, 0.09 Hz at the 95 Hz idle ODR
+#define IDLE_WAKE_BUDGET_MS 100  // wake-to-ready latency above this is reported as over budget
+
+// INT1 is wired up for the acquisition gate or for waking from idle
+#define GYRO_INT1_USED (GYRO_HW_MOTION || (IDLE_ENABLE && IDLE_WAKE_ON_MOTION))
+
 // the unlocking threshold, change this to a smaller value if you have trouble
 // unlocking (has to be positive)
 #define CORRELATION_THRESHOLD .70f
@@ -0,0 +1,404 @@
+/**
+ * @file telemetry.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Framed binary telemetry on the console UART, sent by DMA, for the
+ * embedded sentry project.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "telemetry.h"
+#include "sample_ring.h"
+
+static volatile uint32_t frame_count = 0;
+static volatile uint32_t byte_count = 0;
+static volatile uint32_t dropped_count = 0;
+
+#if TELEMETRY_ENABLE
+
+static_assert(TELEMETRY_TX_BUFFER > 0 && (TELEMETRY_TX_BUFFER & (TELEMETRY_TX_BUFFER - 1)) == 0,
+              "TELEMETRY_TX_BUFFER must be a power of two");
+static_assert(sizeof(Gyroscope_RawData) == 6, "sample wire format changed");
+
+#define TX_MASK (TELEMETRY_TX_BUFFER - 1)
+#define COBS_BLOCK 0xFF          // code of a full block, 254 data bytes
+#define SAMPLE_WIRE_BYTES 10     // timestamp_us, x, y, z
+#define RX_READY_FLAG (1UL << 0)
+
+// USART1 on PA9/PA10 is the ST-LINK virtual COM port; its TX request is
+// DMA2 stream 7, channel 4
+static UART_HandleTypeDef uart_handle;
+static DMA_HandleTypeDef dma_handle;
+static bool initialized = false;
+
+// Encoded frames waiting for the DMA. Free-running indices: the producer
+// owns [head, tail + size), the DMA reads [tail, head). Must not be in CCM.
+static uint8_t tx_buffer[TELEMETRY_TX_BUFFER];
+static volatile uint32_t tx_head = 0;
+static volatile uint32_t tx_tail = 0;
+static volatile uint32_t dma_length = 0; // bytes in flight, 0 while idle
+static Mutex tx_mutex;                   // one frame encoder at a time
+static uint8_t sequence = 0;
+static bool sleeping = false;            // deep sleep unlocked by TelemetrySleep()
+
+static MbedCRC<POLY_16BIT_CCITT, 16> frame_crc;
+
+// Console text collected until the end of the line, under tx_mutex
+static char line[TELEMETRY_LINE_LENGTH];
+static size_t line_length = 0;
+
+static SampleRing<uint8_t, TELEMETRY_RX_BUFFER> rx_ring;
+static EventFlags rx_flags;
+
+// COBS encoder writing straight into tx_buffer
+typedef struct
+{
+    uint32_t pos;      // next byte
+    uint32_t code_pos; // code byte of the current block
+    uint8_t code;      // current block length + 1
+    uint32_t crc;
+} Frame_Writer;
+
+// Start the next DMA transfer if the stream is idle. Interrupts must be
+// masked, or this is the DMA interrupt itself.
+static void StartDma()
+{
+    if (dma_length != 0 || tx_head == tx_tail)
+        return;
+
+    // Up to the end of the buffer; the rest follows on completion
+    uint32_t offset = tx_tail & TX_MASK;
+    uint32_t length = min<uint32_t>(tx_head - tx_tail, TELEMETRY_TX_BUFFER - offset);
+    dma_length = length;
+    HAL_DMA_Start_IT(&dma_handle, (uint32_t)&tx_buffer[offset], (uint32_t)&USART1->DR, length);
+}
+
+// DMA transfer complete or failed (interrupt context)
+static void OnDmaDone(DMA_HandleTypeDef *hdma)
+{
+    tx_tail += dma_length;
+    dma_length = 0;
+    StartDma();
+}
+
+static void OnDmaInterrupt()
+{
+    HAL_DMA_IRQHandler(&dma_handle);
+}
+
+// Received byte (interrupt context); reading DR also clears an overrun
+static void OnUartInterrupt()
+{
+    uint32_t status = USART1->SR;
+    if (status & (USART_SR_RXNE | USART_SR_ORE))
+    {
+        uint8_t byte = (uint8_t)USART1->DR;
+        if (status & USART_SR_RXNE)
+        {
+            rx_ring.push(byte);
+            rx_flags.set(RX_READY_FLAG);
+        }
+    }
+}
+
+static void Encode(Frame_Writer &w, const void *data, size_t length)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    for (size_t i = 0; i < length; i++)
+    {
+        if (bytes[i] != 0)
+        {
+            tx_buffer[w.pos++ & TX_MASK] = bytes[i];
+            w.code++;
+        }
+        if (bytes[i] == 0 || w.code == COBS_BLOCK)
+        {
+            tx_buffer[w.code_pos & TX_MASK] = w.code;
+            w.code_pos = w.pos++;
+            w.code = 1;
+        }
+    }
+}
+
+// Encode part of the frame body and add it to the CRC
+static void Put(Frame_Writer &w, const void *data, size_t length)
+{
+    frame_crc.compute_partial(data, length, &w.crc);
+    Encode(w, data, length);
+}
+
+// Room for the worst-case encoding of a frame with this body
+static bool Fits(size_t body_length)
+{
+    size_t payload = 2 + body_length + 2;
+    size_t worst = payload + payload / (COBS_BLOCK - 1) + 2; // code bytes, delimiter
+    return TELEMETRY_TX_BUFFER - (tx_head - tx_tail) >= worst;
+}
+
+// Reserve room for the worst-case encoding of a frame and write its header.
+// Called with tx_mutex held; false if the frame does not fit.
+static bool BeginFrame(Frame_Writer &w, uint8_t type, size_t body_length)
+{
+    uint8_t header[2] = {type, sequence++};
+
+    if (!Fits(body_length))
+    {
+        dropped_count++;
+        return false;
+    }
+
+    w.code_pos = tx_head;
+    w.pos = tx_head + 1;
+    w.code = 1;
+    frame_crc.compute_partial_start(&w.crc);
+    Put(w, header, sizeof(header));
+    return true;
+}
+
+// Append the CRC and the delimiter, then hand the frame to the DMA
+static void EndFrame(Frame_Writer &w)
+{
+    frame_crc.compute_partial_stop(&w.crc);
+    uint8_t crc[2] = {(uint8_t)w.crc, (uint8_t)(w.crc >> 8)};
+    Encode(w, crc, sizeof(crc));
+    tx_buffer[w.code_pos & TX_MASK] = w.code;
+    tx_buffer[w.pos++ & TX_MASK] = 0;
+
+    frame_count++;
+    byte_count += w.pos - tx_head;
+
+    core_util_critical_section_enter();
+    tx_head = w.pos;
+    StartDma();
+    core_util_critical_section_exit();
+}
+
+// Send the collected console text as one log frame, under tx_mutex
+static void FlushLine()
+{
+    Frame_Writer w;
+    if (line_length > 0 && BeginFrame(w, TELEMETRY_FRAME_LOG, line_length))
+    {
+        Put(w, line, line_length);
+        EndFrame(w);
+    }
+    line_length = 0;
+}
+
+void TelemetryInit()
+{
+    core_util_critical_section_enter();
+    bool first = !initialized;
+    initialized = true;
+    core_util_critical_section_exit();
+    if (!first)
+        return;
+
+    __HAL_RCC_GPIOA_CLK_ENABLE();
+    __HAL_RCC_USART1_CLK_ENABLE();
+    __HAL_RCC_DMA2_CLK_ENABLE();
+
+    GPIO_InitTypeDef gpio = {0};
+    gpio.Pin = GPIO_PIN_9 | GPIO_PIN_10;
+    gpio.Mode = GPIO_MODE_AF_PP;
+    gpio.Pull = GPIO_PULLUP;
+    gpio.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+    gpio.Alternate = GPIO_AF7_USART1;
+    HAL_GPIO_Init(GPIOA, &gpio);
+
+    uart_handle.Instance = USART1;
+    uart_handle.Init.BaudRate = TELEMETRY_BAUD;
+    uart_handle.Init.WordLength = UART_WORDLENGTH_8B;
+    uart_handle.Init.StopBits = UART_STOPBITS_1;
+    uart_handle.Init.Parity = UART_PARITY_NONE;
+    uart_handle.Init.Mode = UART_MODE_TX_RX;
+    uart_handle.Init.HwFlowCtl = UART_HWCONTROL_NONE;
+    uart_handle.Init.OverSampling = UART_OVERSAMPLING_16;
+    HAL_UART_Init(&uart_handle);
+
+    dma_handle.Instance = DMA2_Stream7;
+    dma_handle.Init.Channel = DMA_CHANNEL_4;
+    dma_handle.Init.Direction = DMA_MEMORY_TO_PERIPH;
+    dma_handle.Init.PeriphInc = DMA_PINC_DISABLE;
+    dma_handle.Init.MemInc = DMA_MINC_ENABLE;
+    dma_handle.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    dma_handle.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    dma_handle.Init.Mode = DMA_NORMAL;
+    dma_handle.Init.Priority = DMA_PRIORITY_LOW;
+    dma_handle.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    HAL_DMA_Init(&dma_handle);
+    dma_handle.XferCpltCallback = OnDmaDone;
+    dma_handle.XferErrorCallback = OnDmaDone; // skip the bytes, keep streaming
+
+    NVIC_SetVector(DMA2_Stream7_IRQn, (uint32_t)&OnDmaInterrupt);
+    NVIC_EnableIRQ(DMA2_Stream7_IRQn);
+
+    // Transmit through the DMA, receive one byte per interrupt
+    SET_BIT(USART1->CR3, USART_CR3_DMAT);
+    SET_BIT(USART1->CR1, USART_CR1_RXNEIE);
+    NVIC_SetVector(USART1_IRQn, (uint32_t)&OnUartInterrupt);
+    NVIC_EnableIRQ(USART1_IRQn);
+
+    // Stop mode would halt the UART mid-frame and miss console input
+    sleep_manager_lock_deep_sleep();
+}
+
+bool TelemetrySamples(const Gyroscope_Sample *samples, size_t count)
+{
+    if (count == 0)
+        return true;
+    count = min<size_t>(count, UINT8_MAX);
+
+    Frame_Writer w;
+    tx_mutex.lock();
+    bool queued = BeginFrame(w, TELEMETRY_FRAME_SAMPLES, 1 + count * SAMPLE_WIRE_BYTES);
+    if (queued)
+    {
+        uint8_t n = count;
+        Put(w, &n, 1);
+        for (size_t i = 0; i < count; i++)
+        {
+            Put(w, &samples[i].timestamp_us, sizeof(samples[i].timestamp_us));
+            Put(w, &samples[i].data, sizeof(samples[i].data));
+        }
+        EndFrame(w);
+    }
+    tx_mutex.unlock();
+    return queued;
+}
+
+bool TelemetryFrame(Telemetry_Frame_Type type, const void *body, size_t length, bool wait)
+{
+    Frame_Writer w;
+    tx_mutex.lock();
+    // Waiting for room is not a drop, so it does not use up a sequence number
+    while (wait && !Fits(length))
+    {
+        tx_mutex.unlock();
+        ThisThread::sleep_for(2ms);
+        tx_mutex.lock();
+    }
+    bool queued = BeginFrame(w, type, length);
+    if (queued)
+    {
+        Put(w, body, length);
+        EndFrame(w);
+    }
+    tx_mutex.unlock();
+    return queued;
+}
+
+void TelemetrySleep()
+{
+    tx_mutex.lock();
+    FlushLine();
+    tx_mutex.unlock();
+
+    // The DMA finishing is not enough, the last byte is still in the shifter
+    while (tx_head != tx_tail || !(USART1->SR & USART_SR_TC))
+        ThisThread::sleep_for(1ms);
+
+    if (!sleeping)
+    {
+        sleeping = true;
+        sleep_manager_unlock_deep_sleep();
+    }
+}
+
+void TelemetryWake()
+{
+    if (sleeping)
+    {
+        sleeping = false;
+        sleep_manager_lock_deep_sleep();
+    }
+}
+
+// Console on top of the telemetry stream: text goes out as log frames, one
+// per line, input comes from the receive interrupt
+class TelemetryConsole : public FileHandle
+{
+public:
+    ssize_t write(const void *buffer, size_t size) override
+    {
+        // No mutex in interrupts or critical sections; such text is lost
+        if (core_util_is_isr_active() || !core_util_are_interrupts_enabled())
+        {
+            dropped_count++;
+            return size;
+        }
+
+        const char *text = (const char *)buffer;
+        tx_mutex.lock();
+        for (size_t i = 0; i < size; i++)
+        {
+            line[line_length++] = text[i];
+            if (text[i] == '\n' || line_length == TELEMETRY_LINE_LENGTH)
+                FlushLine();
+        }
+        tx_mutex.unlock();
+        return size;
+    }
+
+    ssize_t read(void *buffer, size_t size) override
+    {
+        if (size == 0)
+            return 0;
+
+        size_t count;
+        while ((count = rx_ring.pop_batch((uint8_t *)buffer, size)) == 0)
+        {
+            if (!blocking)
+                return -EAGAIN;
+            rx_flags.wait_any(RX_READY_FLAG);
+        }
+        return count;
+    }
+
+    int sync() override
+    {
+        tx_mutex.lock();
+        FlushLine();
+        tx_mutex.unlock();
+        return 0;
+    }
+
+    off_t seek(off_t offset, int whence) override { return -ESPIPE; }
+    int close() override { return 0; }
+    int isatty() override { return 1; }
+    int set_blocking(bool enabled) override
+    {
+        blocking = enabled;
+        return 0;
+    }
+    bool is_blocking() const override { return blocking; }
+
+private:
+    bool blocking = true;
+};
+
+// Replaces the default serial console
+FileHandle *mbed::mbed_override_console(int fd)
+{
+    static TelemetryConsole console;
+    TelemetryInit();
+    return &console;
+}
+
+#endif // TELEMETRY_ENABLE
+
+Telemetry_Stats GetTelemetryStats()
+{
+    Telemetry_Stats stats = {
+        frame_count,
+        byte_count,
+        dropped_count
+    };
+    return stats;
+}
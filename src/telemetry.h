@@ -0,0 +1,113 @@
+/**
+ * @file telemetry.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Framed binary telemetry on the console UART, sent by DMA, for the
+ * embedded sentry project.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ *
+ * Wire format: every frame is COBS encoded and terminated by a 0x00 byte, so
+ * a receiver can resynchronize at any zero. Decoded, a frame is
+ *
+ *   type (1) | sequence (1) | body | CRC-16/CCITT of type..body (2, LE)
+ *
+ * The sequence counts every frame the firmware produced, including the ones
+ * dropped because the transmit buffer was full, so gaps show up on the host.
+ * Bodies, little-endian:
+ *
+ *   TELEMETRY_FRAME_LOG:     console text, one line or TELEMETRY_LINE_LENGTH
+ *                            bytes per frame
+ *   TELEMETRY_FRAME_SAMPLES: count (1), then count times
+ *                            timestamp_us (4) | x (2) | y (2) | z (2),
+ *                            calibrated raw counts as in Gyroscope_Sample
+ *   TELEMETRY_FRAME_ARCHIVE_RECORD: one archived attempt, see archive.h
+ *   TELEMETRY_FRAME_ARCHIVE_DATA:   a slice of its coded samples
+ *
+ * With TELEMETRY_ENABLE the module takes over the console, so printf() and
+ * getchar() keep working through it. src/serial_dump.py decodes the stream.
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <mbed.h>
+
+#include "gyro.h"
+#include "system_config.h"
+
+typedef enum {
+  TELEMETRY_FRAME_LOG = 1,
+  TELEMETRY_FRAME_SAMPLES = 2,
+  TELEMETRY_FRAME_ARCHIVE_RECORD = 3,
+  TELEMETRY_FRAME_ARCHIVE_DATA = 4
+} Telemetry_Frame_Type;
+
+// Telemetry counters, cumulative since TelemetryInit()
+typedef struct {
+  uint32_t frames;   // frames queued for the DMA
+  uint32_t bytes;    // encoded bytes queued, delimiters included
+  uint32_t dropped;  // frames refused because the transmit buffer was full
+} Telemetry_Stats;
+
+#if TELEMETRY_ENABLE
+
+/**
+ * @brief Set up the UART, its transmit DMA and the receive interrupt. Safe to
+ * call more than once; the console calls it on first use.
+ */
+void TelemetryInit();
+
+/**
+ * @brief Queue one frame of timestamped samples. Never blocks: the samples
+ * are encoded straight into the DMA buffer, or dropped if it is full.
+ * Thread context only.
+ * @param samples: samples as taken out of the sample ring
+ * @param count: number of samples, at most 255
+ * @return false if the frame was dropped
+ */
+bool TelemetrySamples(const Gyroscope_Sample *samples, size_t count);
+
+/**
+ * @brief Queue one frame with a prebuilt body. Thread context only.
+ * @param type: frame type
+ * @param body: frame body
+ * @param length: body bytes, well below TELEMETRY_TX_BUFFER
+ * @param wait: sleep until the transmit buffer has room instead of
+ * dropping the frame, for bulk exports
+ * @return false if the frame was dropped
+ */
+bool TelemetryFrame(Telemetry_Frame_Type type, const void *body, size_t length, bool wait);
+
+/**
+ * @brief Send everything queued, then allow Stop mode until TelemetryWake().
+ * Console input arriving while stopped is lost. Thread context only.
+ */
+void TelemetrySleep();
+
+/**
+ * @brief Keep the UART clocked again after TelemetrySleep()
+ */
+void TelemetryWake();
+
+#else
+
+inline void TelemetryInit() {}
+inline bool TelemetrySamples(const Gyroscope_Sample *, size_t) { return false; }
+inline bool TelemetryFrame(Telemetry_Frame_Type, const void *, size_t, bool) { return false; }
+inline void TelemetrySleep() {}
+inline void TelemetryWake() {}
+
+#endif
+
+/**
+ * @brief Snapshot of the telemetry counters
+ */
+Telemetry_Stats GetTelemetryStats();
+
+#endif  // TELEMETRY_H
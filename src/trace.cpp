@@ -0,0 +1,173 @@
+/**
+ * @file trace.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Cycle-accurate tracing spans on the Cortex-M DWT cycle counter for
+ * the embedded sentry project.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "trace.h"
+
+// Log-linear histogram: values below 4 get a bucket each, every octave above
+// is split into 4 buckets, so a percentile is off by at most 25%
+#define TRACE_SUB_BUCKETS 4
+#define TRACE_HISTOGRAM_BUCKETS 124  // covers the full 32-bit cycle range
+
+static_assert(TRACE_BUFFER_SIZE > 0 && (TRACE_BUFFER_SIZE & (TRACE_BUFFER_SIZE - 1)) == 0,
+              "TRACE_BUFFER_SIZE must be a power of two");
+
+typedef struct
+{
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+    uint32_t histogram[TRACE_HISTOGRAM_BUCKETS];
+} Stage_State;
+
+static Stage_State stages[TRACE_STAGE_COUNT];
+static Trace_Event events[TRACE_BUFFER_SIZE];
+static uint32_t event_head = 0; // free-running, events[head % size] is the next slot
+
+static const char *const stage_names[TRACE_STAGE_COUNT] = {
+    "spi read", "calibration", "filter", "trim", "normalize", "correlation", "lcd draw"
+};
+
+static size_t Bucket(uint32_t cycles)
+{
+    if (cycles < TRACE_SUB_BUCKETS)
+        return cycles;
+    uint32_t octave = 31 - __CLZ(cycles);
+    return (octave - 1) * TRACE_SUB_BUCKETS + ((cycles >> (octave - 2)) & (TRACE_SUB_BUCKETS - 1));
+}
+
+// Largest value that falls into a bucket
+static uint32_t BucketLimit(size_t bucket)
+{
+    if (bucket < TRACE_SUB_BUCKETS)
+        return bucket;
+    uint32_t octave = bucket / TRACE_SUB_BUCKETS + 1;
+    uint32_t width = 1UL << (octave - 2);
+    return (TRACE_SUB_BUCKETS + bucket % TRACE_SUB_BUCKETS) * width + (width - 1);
+}
+
+void TraceInit()
+{
+#if TRACE_ENABLE
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+    TraceReset();
+}
+
+#if TRACE_ENABLE
+void TraceRecord(Trace_Stage stage, uint32_t start)
+{
+    // Unsigned difference survives one counter wrap (~23 s at 180 MHz)
+    uint32_t cycles = DWT->CYCCNT - start;
+    size_t bucket = Bucket(cycles);
+
+    core_util_critical_section_enter();
+    Stage_State &s = stages[stage];
+    if (s.count == 0 || cycles < s.min)
+        s.min = cycles;
+    if (cycles > s.max)
+        s.max = cycles;
+    s.count++;
+    s.total += cycles;
+    s.histogram[bucket]++;
+
+    Trace_Event &e = events[event_head & (TRACE_BUFFER_SIZE - 1)];
+    e.start = start;
+    e.cycles = cycles;
+    e.stage = stage;
+    event_head++;
+    core_util_critical_section_exit();
+}
+#endif
+
+Trace_Stats GetTraceStats(Trace_Stage stage)
+{
+    Trace_Stats stats = {0, 0, 0, 0, 0};
+
+    core_util_critical_section_enter();
+    const Stage_State &s = stages[stage];
+    if (s.count > 0)
+    {
+        stats.count = s.count;
+        stats.min = s.min;
+        stats.max = s.max;
+        stats.avg = (uint32_t)(s.total / s.count);
+
+        // First bucket at or past 99% of the spans
+        uint32_t target = s.count - s.count / 100;
+        uint32_t seen = 0;
+        for (size_t bucket = 0; bucket < TRACE_HISTOGRAM_BUCKETS; bucket++)
+        {
+            seen += s.histogram[bucket];
+            if (seen >= target)
+            {
+                stats.p99 = min(BucketLimit(bucket), s.max);
+                break;
+            }
+        }
+    }
+    core_util_critical_section_exit();
+    return stats;
+}
+
+size_t TraceEvents(Trace_Event *out, size_t max_events)
+{
+    core_util_critical_section_enter();
+    uint32_t head = event_head;
+    size_t count = min<size_t>(min<size_t>(head, TRACE_BUFFER_SIZE), max_events);
+    for (size_t i = 0; i < count; i++)
+    {
+        out[i] = events[(head - count + i) & (TRACE_BUFFER_SIZE - 1)];
+    }
+    core_util_critical_section_exit();
+    return count;
+}
+
+const char *TraceStageName(Trace_Stage stage)
+{
+    return stage < TRACE_STAGE_COUNT ? stage_names[stage] : "?";
+}
+
+void TraceDump()
+{
+    // Plain cycles: the short stages would round to 0 us. No field widths,
+    // minimal-printf ignores them.
+    printf("trace: cycles at %lu MHz\n", (unsigned long)(SystemCoreClock / 1000000));
+    for (size_t i = 0; i < TRACE_STAGE_COUNT; i++)
+    {
+        Trace_Stats s = GetTraceStats((Trace_Stage)i);
+        printf("trace: %s: %lu spans, min %lu, avg %lu, p99 %lu, max %lu\n",
+               TraceStageName((Trace_Stage)i), (unsigned long)s.count, (unsigned long)s.min,
+               (unsigned long)s.avg, (unsigned long)s.p99, (unsigned long)s.max);
+    }
+
+    Trace_Event recent[TRACE_DUMP_EVENTS];
+    size_t count = TraceEvents(recent, TRACE_DUMP_EVENTS);
+    for (size_t i = 0; i < count; i++)
+    {
+        printf("trace: @%lu %s %lu cycles\n", (unsigned long)recent[i].start,
+               TraceStageName((Trace_Stage)recent[i].stage), (unsigned long)recent[i].cycles);
+    }
+}
+
+void TraceReset()
+{
+    core_util_critical_section_enter();
+    memset(stages, 0, sizeof(stages));
+    event_head = 0;
+    core_util_critical_section_exit();
+}
@@ -0,0 +1,125 @@
+/**
+ * @file trace.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Cycle-accurate tracing spans on the Cortex-M DWT cycle counter for
+ * the embedded sentry project.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "system_config.h"  // mbed.h on the target
+
+// Pipeline stages with their own span statistics
+typedef enum {
+  TRACE_SPI_READ,     // gyroscope FIFO / sample read over SPI
+  TRACE_CALIBRATION,  // zero-rate bias calibration
+  TRACE_FILTER,       // moving average on one sample
+  TRACE_TRIM,         // leading / trailing silence removal
+  TRACE_NORMALIZE,    // template or probe normalization
+  TRACE_CORRELATION,  // matching kernel against one template / one sample
+  TRACE_LCD_DRAW,     // one UI frame, draw through flip
+  TRACE_STAGE_COUNT
+} Trace_Stage;
+
+// One finished span in the trace buffer
+typedef struct {
+  uint32_t start;   // CYCCNT when the span began
+  uint32_t cycles;  // span length
+  uint8_t stage;    // Trace_Stage
+} Trace_Event;
+
+// Span statistics of one stage, in CPU cycles, since the last TraceReset()
+typedef struct {
+  uint32_t count;
+  uint32_t min;
+  uint32_t max;
+  uint32_t avg;
+  uint32_t p99;  // upper edge of the histogram bucket holding the 99th percentile
+} Trace_Stats;
+
+/**
+ * @brief Start the DWT cycle counter. Spans recorded before this read zero.
+ */
+void TraceInit();
+
+/**
+ * @brief Current cycle count
+ */
+inline uint32_t TraceNow()
+{
+#if TRACE_ENABLE
+  return DWT->CYCCNT;
+#else
+  return 0;
+#endif
+}
+
+/**
+ * @brief Close a span; safe from threads and interrupts
+ * @param stage: stage the span belongs to
+ * @param start: TraceNow() when the span began
+ */
+#if TRACE_ENABLE
+void TraceRecord(Trace_Stage stage, uint32_t start);
+#else
+inline void TraceRecord(Trace_Stage, uint32_t) {}
+#endif
+
+/**
+ * @brief Span that closes itself at the end of the enclosing scope
+ */
+class TraceSpan {
+ public:
+  explicit TraceSpan(Trace_Stage stage) : stage_(stage), start_(TraceNow()) {}
+  ~TraceSpan() { TraceRecord(stage_, start_); }
+
+  TraceSpan(const TraceSpan &) = delete;
+  TraceSpan &operator=(const TraceSpan &) = delete;
+
+ private:
+  Trace_Stage stage_;
+  uint32_t start_;
+};
+
+/**
+ * @brief Statistics of one stage
+ */
+Trace_Stats GetTraceStats(Trace_Stage stage);
+
+/**
+ * @brief Copy the newest events out of the trace buffer, oldest first
+ * @param out: destination array
+ * @param max_events: capacity of out
+ * @return number of events copied
+ */
+size_t TraceEvents(Trace_Event *out, size_t max_events);
+
+/**
+ * @brief Printable name of a stage
+ */
+const char *TraceStageName(Trace_Stage stage);
+
+/**
+ * @brief Print the per-stage table and the newest TRACE_DUMP_EVENTS events
+ * on the console
+ */
+void TraceDump();
+
+/**
+ * @brief Clear the statistics and the trace buffer
+ */
+void TraceReset();
+
+#endif  // TRACE_H
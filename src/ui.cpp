@@ -0,0 +1,305 @@
+/**
+ * @file ui.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Display thread that owns the LCD and renders queued draw commands
+ * for the embedded sentry project.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "ui.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+#include "drivers/LCD_DISCO_F429ZI.h"
+#include "trace.h"
+
+// Only touched by the UI thread after UiInit(). With FAST_BOOT nothing is
+// set up before main(), UiInit() starts it.
+static LCD_DISCO_F429ZI lcd(LCD_RGB565 ? LTDC_PIXEL_FORMAT_RGB565 : LTDC_PIXEL_FORMAT_ARGB8888, FAST_BOOT != 0);
+
+static Mail<Ui_Command, UI_QUEUE_DEPTH> ui_mail;
+static EventFlags dma2d_flags; // set from the DMA2D interrupt when its queue drains
+static EventFlags power_flags; // set by the UI thread once a power command is done
+static Thread ui_thread(osPriorityBelowNormal, UI_THREAD_STACK_SIZE, nullptr, "ui");
+
+// Latest command per region, waiting for the next frame
+static Ui_Command pending[UI_REGION_COUNT];
+static bool pending_valid[UI_REGION_COUNT];
+
+static bool display_on = true;
+static bool power_pending = false;
+static bool power_target = true;
+
+static volatile uint32_t posted_count = 0;
+static volatile uint32_t dropped_count = 0;
+static volatile uint32_t coalesced_count = 0;
+static volatile uint32_t frame_count = 0;
+static volatile uint32_t shown_us = 0; // first frame on screen, if shown
+static volatile bool shown = false;
+static bool overlay_drawn = false; // status overlay drawn, waiting to be shown
+static bool overlay_shown = false;
+
+#define DMA2D_DONE_FLAG (1UL << 0)
+#define POWER_DONE_FLAG (1UL << 0)
+
+// DMA2D queue empty (interrupt context)
+static void OnDma2dDone()
+{
+    dma2d_flags.set(DMA2D_DONE_FLAG);
+}
+
+// Copy a command into the mailbox; producers never wait for the display
+static bool Post(const Ui_Command &command)
+{
+    Ui_Command *slot = ui_mail.try_alloc();
+    if (slot == nullptr)
+    {
+        dropped_count++;
+        return false;
+    }
+    *slot = command;
+    ui_mail.put(slot);
+    posted_count++;
+    return true;
+}
+
+// Move everything in the mailbox into the per-region table
+static void Collect(Ui_Command *command)
+{
+    while (command != nullptr)
+    {
+        if (command->type == UI_COMMAND_POWER)
+        {
+            power_pending = true;
+            power_target = command->x != 0;
+        }
+        else if (command->region < UI_REGION_COUNT)
+        {
+            if (pending_valid[command->region])
+                coalesced_count++;
+            pending[command->region] = *command;
+            pending_valid[command->region] = true;
+        }
+        ui_mail.free(command);
+        command = ui_mail.try_get();
+    }
+}
+
+static void Draw(const Ui_Command &command)
+{
+    switch (command.type)
+    {
+    case UI_COMMAND_TEXT:
+        lcd.SetTextColor(command.color);
+        lcd.DisplayStringAt(command.x, command.y, (uint8_t *)command.text, CENTER_MODE);
+        break;
+    case UI_COMMAND_BUTTON:
+        lcd.SetTextColor(command.color);
+        lcd.FillRect(command.x, command.y, command.width, command.height);
+        lcd.DisplayStringAt(command.x + command.width / 2 - strlen(command.text) * 19,
+                            command.y + command.height / 2 - 8, (uint8_t *)command.text, CENTER_MODE);
+        break;
+    case UI_COMMAND_STATUS:
+#if UI_STATUS_OVERLAY
+        // Drawn in the layer 1 window (its line 0 is UI_STATUS_Y), which the
+        // LTDC lays over layer 0: the frame buffer below is left alone
+        lcd.SelectLayer(LCD_FOREGROUND_LAYER);
+        lcd.SetTextColor(LCD_COLOR_BLACK);
+        lcd.FillRect(0, 0, lcd.GetXSize(), FONT_SIZE);
+        lcd.SetTextColor(command.color);
+        lcd.DisplayStringAt(UI_STATUS_X, 0, (uint8_t *)command.text, CENTER_MODE);
+        lcd.SelectLayer(LCD_BACKGROUND_LAYER);
+        overlay_drawn = true;
+#else
+        lcd.SetTextColor(LCD_COLOR_BLACK);
+        lcd.FillRect(0, UI_STATUS_Y, lcd.GetXSize(), FONT_SIZE);
+        lcd.SetTextColor(command.color);
+        lcd.DisplayStringAt(UI_STATUS_X, UI_STATUS_Y, (uint8_t *)command.text, CENTER_MODE);
+#endif
+        break;
+    }
+}
+
+// Render whatever is pending and flip it in
+static void RenderFrame()
+{
+    dma2d_flags.clear(DMA2D_DONE_FLAG);
+    uint32_t draw_start = TraceNow();
+
+    for (size_t region = 0; region < UI_REGION_COUNT; region++)
+    {
+        if (pending_valid[region])
+        {
+            pending_valid[region] = false;
+            Draw(pending[region]);
+        }
+    }
+#if LCD_DMA2D_ASYNC
+    // Fills and glyphs run on the DMA2D; sleep instead of spinning so
+    // the sampling and matching threads get the CPU meanwhile
+    while (lcd.Dma2dBusy())
+    {
+        dma2d_flags.wait_any_for(DMA2D_DONE_FLAG, std::chrono::milliseconds(UI_FRAME_MS));
+    }
+#endif
+    lcd.SwapBuffers(LCD_BACKGROUND_LAYER);
+    if (overlay_drawn && !overlay_shown)
+    {
+        // The overlay is single-buffered and starts transparent
+        lcd.SetTransparency(LCD_FOREGROUND_LAYER, 255);
+        overlay_shown = true;
+    }
+    TraceRecord(TRACE_LCD_DRAW, draw_start);
+    frame_count++;
+
+    if (!shown)
+    {
+        // The fast boot keeps layer 0 hidden until there is a frame to show
+        lcd.SetLayerVisible(LCD_BACKGROUND_LAYER, ENABLE);
+        shown_us = us_ticker_read();
+        shown = true;
+    }
+}
+
+// Render once per frame so a burst of updates to one region is drawn once.
+// While the display sleeps nothing is drawn, the latest commands wait.
+static void UiThread()
+{
+#if FAST_BOOT
+    // The glyphs are expanded on the CPU while the DMA2D clears the frame
+    // buffers; then drawing switches to the configured DMA2D mode
+    lcd.StartGlyphAtlas();
+    while (lcd.Dma2dBusy())
+    {
+        dma2d_flags.wait_any_for(DMA2D_DONE_FLAG, std::chrono::milliseconds(UI_FRAME_MS));
+    }
+    lcd.SetDma2dAsync(LCD_DMA2D_ASYNC ? ENABLE : DISABLE);
+#endif
+
+    while (1)
+    {
+        Collect(ui_mail.try_get_for(Kernel::wait_for_u32_forever));
+        Kernel::Clock::time_point frame_start = Kernel::Clock::now();
+
+        if (power_pending && power_target && !display_on)
+        {
+            lcd.Wake();
+            display_on = true;
+        }
+        if (display_on)
+            RenderFrame();
+        if (power_pending && !power_target && display_on)
+        {
+            lcd.Sleep();
+            display_on = false;
+        }
+        if (power_pending)
+        {
+            power_pending = false;
+            power_flags.set(POWER_DONE_FLAG);
+        }
+
+        if (display_on)
+            ThisThread::sleep_until(frame_start + std::chrono::milliseconds(UI_FRAME_MS));
+    }
+}
+
+void UiInit(uint32_t background)
+{
+#if FAST_BOOT
+    // Layer 0 only, hidden. The clear and the back buffer copy are queued on
+    // the DMA2D and run while the caller goes on booting.
+    lcd.StartMinimal();
+    lcd.SetDma2dCallback(OnDma2dDone);
+    lcd.SetDma2dAsync(ENABLE);
+    lcd.Clear(background);
+#endif
+#if LCD_DOUBLE_BUFFER
+    // Layer 0 is drawn off screen and flipped in once per frame
+    lcd.DoubleBufferInit(LCD_BACKGROUND_LAYER, LCD_BACK_BUFFER_LAYER0,
+                         LCD_DAMAGE_COPY ? LCD_SYNC_DAMAGE : LCD_SYNC_FULL);
+#endif
+#if UI_STATUS_OVERLAY
+    lcd.OverlayInit(UI_STATUS_Y, FONT_SIZE);
+#endif
+#if !FAST_BOOT
+    lcd.Clear(background);
+
+#if LCD_DMA2D_ASYNC
+    lcd.SetDma2dCallback(OnDma2dDone);
+    lcd.SetDma2dAsync(ENABLE);
+#endif
+#endif
+
+    ui_thread.start(callback(UiThread));
+}
+
+bool UiText(Ui_Region region, int x, int y, uint32_t color, const char *text)
+{
+    Ui_Command command = {UI_COMMAND_TEXT, (uint8_t)region, (int16_t)x, (int16_t)y, 0, 0, color, {0}};
+    strncpy(command.text, text, UI_TEXT_LENGTH - 1);
+    return Post(command);
+}
+
+bool UiButton(Ui_Region region, int x, int y, int width, int height, uint32_t color, const char *label)
+{
+    Ui_Command command = {UI_COMMAND_BUTTON, (uint8_t)region, (int16_t)x, (int16_t)y,
+                          (int16_t)width, (int16_t)height, color, {0}};
+    strncpy(command.text, label, UI_TEXT_LENGTH - 1);
+    return Post(command);
+}
+
+bool UiStatus(uint32_t color, const char *format, ...)
+{
+    Ui_Command command = {UI_COMMAND_STATUS, UI_REGION_STATUS, UI_STATUS_X, UI_STATUS_Y, 0, FONT_SIZE, color, {0}};
+    va_list args;
+    va_start(args, format);
+    vsnprintf(command.text, UI_TEXT_LENGTH, format, args);
+    va_end(args);
+    return Post(command);
+}
+
+bool UiDisplay(bool on)
+{
+    Ui_Command command = {UI_COMMAND_POWER, UI_REGION_COUNT, (int16_t)on, 0, 0, 0, 0, {0}};
+    power_flags.clear(POWER_DONE_FLAG);
+    if (!Post(command))
+        return false;
+    uint32_t result = power_flags.wait_any_for(POWER_DONE_FLAG, std::chrono::milliseconds(UI_POWER_TIMEOUT_MS));
+    return !(result & osFlagsError);
+}
+
+uint32_t UiWidth()
+{
+    return lcd.GetXSize();
+}
+
+uint32_t UiHeight()
+{
+    return lcd.GetYSize();
+}
+
+uint32_t UiShownAt()
+{
+    return shown ? shown_us : 0;
+}
+
+Ui_Stats GetUiStats()
+{
+    Ui_Stats stats = {
+        posted_count,
+        dropped_count,
+        coalesced_count,
+        frame_count
+    };
+    return stats;
+}
@@ -0,0 +1,118 @@
+/**
+ * @file ui.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Display thread that owns the LCD and renders queued draw commands
+ * for the embedded sentry project.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef UI_H
+#define UI_H
+
+#include <mbed.h>
+
+#include "system_config.h"
+
+// Screen regions; a newer command for a region replaces a pending older one
+typedef enum {
+  UI_REGION_TITLE,
+  UI_REGION_BUTTON_1,
+  UI_REGION_BUTTON_2,
+  UI_REGION_STATUS,
+  UI_REGION_COUNT
+} Ui_Region;
+
+typedef enum {
+  UI_COMMAND_TEXT,    // centred line of text
+  UI_COMMAND_BUTTON,  // filled box with a label
+  UI_COMMAND_STATUS,  // erase the status line and write it again
+  UI_COMMAND_POWER    // display on (x = 1) or off (x = 0), no region
+} Ui_Command_Type;
+
+// One draw request, copied into the UI mailbox
+typedef struct {
+  uint8_t type;    // Ui_Command_Type
+  uint8_t region;  // Ui_Region
+  int16_t x, y;
+  int16_t width, height;
+  uint32_t color;
+  char text[UI_TEXT_LENGTH];
+} Ui_Command;
+
+// UI counters, cumulative since UiInit()
+typedef struct {
+  uint32_t posted;     // commands accepted
+  uint32_t dropped;    // commands refused because the mailbox was full
+  uint32_t coalesced;  // commands replaced by a newer one before being drawn
+  uint32_t frames;     // frames rendered and flipped
+} Ui_Stats;
+
+/**
+ * @brief Clear the screen and start the UI thread. Must be called before any
+ * other Ui* function. With FAST_BOOT this also brings the LCD up and returns
+ * while the clear still runs; the screen stays black until the first frame.
+ * @param background: screen color
+ */
+void UiInit(uint32_t background);
+
+/**
+ * @brief Queue a centred line of text
+ * @param region: region the text belongs to
+ * @param x, y: text position, as for DisplayStringAt(CENTER_MODE)
+ * @param color: text color
+ * @param text: the text, truncated to UI_TEXT_LENGTH - 1 characters
+ * @return false if the mailbox was full and the command was dropped
+ */
+bool UiText(Ui_Region region, int x, int y, uint32_t color, const char *text);
+
+/**
+ * @brief Queue a touch button
+ * @param region: region the button belongs to
+ * @param x, y, width, height: button rectangle
+ * @param color: box and label color
+ * @param label: the label
+ * @return false if the mailbox was full and the command was dropped
+ */
+bool UiButton(Ui_Region region, int x, int y, int width, int height, uint32_t color, const char *label);
+
+/**
+ * @brief Queue a new status line; never blocks the calling thread
+ * @param color: text color
+ * @param format: printf-style format
+ * @return false if the mailbox was full and the command was dropped
+ */
+bool UiStatus(uint32_t color, const char *format, ...);
+
+/**
+ * @brief Switch the display off for Stop mode, or back on. Commands queued
+ * while it is off are kept and drawn on wake. Waits for the UI thread.
+ * @param on: true to wake the display, false to put it to sleep
+ * @return false if the UI thread did not answer within UI_POWER_TIMEOUT_MS
+ */
+bool UiDisplay(bool on);
+
+/**
+ * @brief Screen size in pixels, for touch screen scaling
+ */
+uint32_t UiWidth();
+uint32_t UiHeight();
+
+/**
+ * @brief When the first frame was shown
+ * @return us_ticker time, 0 while the screen is still blank
+ */
+uint32_t UiShownAt();
+
+/**
+ * @brief Snapshot of the UI counters
+ */
+Ui_Stats GetUiStats();
+
+#endif  // UI_H
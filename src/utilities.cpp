@@ -14,32 +14,115 @@
 
 #include <array>
 #include "utilities.h"
+#include "dsp_backend.h"
+#include "dtw.h"
 
-array<float, 3> calculateCorrelationVectors(vector<array<float, 3>> &vec1,
-                                            vector<array<float, 3>> &vec2) {
-  array<float, 3> result;
+#if GESTURE_USE_CMSIS_DSP
+#include "arm_math.h"
+#endif
 
-  // Ensure both vectors are of the same size
-  if (vec1.size() != vec2.size()) {
-    size_t min_size = std::min(vec1.size(), vec2.size());
-    vec1.resize(min_size);
-    vec2.resize(min_size);
+/*******************************************************************************
+ *
+ * @brief Welford state after every prefix of a gesture
+ * @param samples: the gesture
+ *
+ * ****************************************************************************/
+void PrefixMoments::build(const GestureBuffer &samples) {
+  for (int i = 0; i < 3; i++) {
+    float m = 0, s = 0;
+    for (size_t j = 0; j < samples.size(); ++j) {
+      float d = samples[j][i] - m;
+      m += d / (j + 1);
+      s += d * (samples[j][i] - m);
+      mean[i][j] = m;
+      m2[i][j] = s;
+    }
+    centre[i] = m;
+    for (size_t j = 0; j < samples.size(); ++j) centred[i][j] = samples[j][i] - m;
   }
+}
 
-  size_t n = vec1.size();
+/*******************************************************************************
+ *
+ * @brief Per-axis correlation of the first n samples of two gestures
+ * @param a: prefix moments of the first gesture
+ * @param b: prefix moments of the second gesture
+ * @param n: prefix length, at most the length of either gesture
+ * @return per-axis correlation [x, y, z] in [-1, 1], NaN without variation
+ *
+ * The second moments come from the tables, so the only pass over the
+ * samples is the co-moment: one dot product per axis of the axes centred on
+ * their full-length means A and B (arm_dot_prod_f32 with CMSIS-DSP), shifted
+ * to the prefix means, sum((a - A)(b - B)) - n (mean_a - A)(mean_b - B). The
+ * shifts are small, so there is none of the cancellation of the raw sums.
+ *
+ * ****************************************************************************/
+array<float, 3> correlationMoments(const PrefixMoments &a, const PrefixMoments &b, size_t n) {
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  if (n == 0) return {nan, nan, nan};
 
+  array<float, 3> result;
   for (int i = 0; i < 3; i++) {
-    vector<float> a, b;
-    for (size_t j = 0; j < n; ++j) {
-      a.push_back(vec1[j][i]);
-      b.push_back(vec2[j][i]);
-    }
-    result[i] = correlation(a, b);
+    float dot;
+#if GESTURE_USE_CMSIS_DSP
+    arm_dot_prod_f32(a.centred[i], b.centred[i], n, &dot);
+#else
+    dot = 0;
+    for (size_t j = 0; j < n; ++j) dot += a.centred[i][j] * b.centred[i][j];
+#endif
+    float c_ab = dot - n * (a.mean[i][n - 1] - a.centre[i]) * (b.mean[i][n - 1] - b.centre[i]);
+    float denominator = a.m2[i][n - 1] * b.m2[i][n - 1];
+    result[i] = denominator > 0.0f ? c_ab / sqrt(denominator) : nan;
   }
-
   return result;
 }
 
+/*******************************************************************************
+ *
+ * @brief Dynamic time warping distance between two normalized gestures
+ * @param vec1: the first gesture (unit vectors)
+ * @param vec2: the second gesture (unit vectors)
+ * @param band: Sakoe-Chiba band half-width in samples
+ * @param threshold: acceptance threshold, used to abandon hopeless matches
+ * @return mean (1 - cos) per path step, or INFINITY
+ *
+ * The path is normalized by n + m, an upper bound on its length, so the
+ * score does not depend on how much the two recordings were warped.
+ *
+ * ****************************************************************************/
+float dtwDistance(const GestureBuffer &vec1, const GestureBuffer &vec2,
+                  size_t band, float threshold) {
+  size_t steps = vec1.size() + vec2.size();
+  float total = dtwBanded<float>(
+      vec1.size(), vec2.size(), band, threshold * steps, INFINITY,
+      [&](size_t i, size_t j) {
+        const array<float, 3> &a = vec1[i];
+        const array<float, 3> &b = vec2[j];
+        return 1.0f - (a[0] * b[0] + a[1] * b[1] + a[2] * b[2]);
+      });
+  return total / steps;
+}
+
+/*******************************************************************************
+ *
+ * @brief Portable scalar per-axis correlation
+ * @param vec1: the first gesture
+ * @param vec2: the second gesture
+ * @param n: number of leading samples of each gesture to correlate
+ * @return per-axis correlation [x, y, z] in [-1, 1]
+ *
+ * ****************************************************************************/
+array<float, 3> correlationReference(const GestureBuffer &vec1,
+                                     const GestureBuffer &vec2, size_t n) {
+  // Single pass over the interleaved samples, all three axes at once
+  AxisCorrelation acc;
+  for (size_t j = 0; j < n; ++j) {
+    acc.add(vec1[j], vec2[j]);
+  }
+
+  return acc.result();
+}
+
 /*******************************************************************************
  *
  * @brief Calculate the Pearson correlation coefficient between two vectors
@@ -53,58 +136,56 @@ float correlation(const vector<float> &a, const vector<float> &b) {
     return std::numeric_limits<float>::quiet_NaN();
   }
 
-  // Return NaN if all data is zero (no variation to correlate)
-  bool has_variation = false;
-  for (size_t i = 0; i < a.size(); ++i) {
-    if (a[i] != 0.0f || b[i] != 0.0f) {
-      has_variation = true;
-      break;
-    }
-  }
-  if (!has_variation) {
-    return std::numeric_limits<float>::quiet_NaN();
-  }
+  return correlation(a.data(), b.data(), a.size());
+}
 
-  float sum_a = 0, sum_b = 0, sum_ab = 0, sq_sum_a = 0, sq_sum_b = 0;
-
-  // Kahan summation for numerical stability
-  for (size_t i = 0; i < a.size(); ++i) {
-    float delta_a = a[i] - sum_a;
-    float delta_b = b[i] - sum_b;
-    sum_a += delta_a;
-    sum_b += delta_b;
-    sum_ab += delta_a * delta_b;
-    sq_sum_a += a[i] * a[i];
-    sq_sum_b += b[i] * b[i];
+/*******************************************************************************
+ *
+ * @brief Calculate the Pearson correlation coefficient between two arrays
+ * @param a: the first array
+ * @param b: the second array
+ * @param n: number of elements in each array
+ * @return correlation in [-1, 1], or NaN on error
+ *
+ * ****************************************************************************/
+float correlation(const float *a, const float *b, size_t n) {
+  // Welford update: one pass, no separate variation check. All-zero or
+  // constant input leaves a zero second moment and yields NaN below.
+  float mean_a = 0, mean_b = 0, m2_a = 0, m2_b = 0, c_ab = 0;
+  for (size_t i = 0; i < n; ++i) {
+    float inv_n = 1.0f / (i + 1);
+    float da = a[i] - mean_a;
+    float db = b[i] - mean_b;
+    mean_a += da * inv_n;
+    mean_b += db * inv_n;
+    float db_new = b[i] - mean_b;
+    m2_a += da * (a[i] - mean_a);
+    m2_b += db * db_new;
+    c_ab += da * db_new;
   }
 
-  size_t n = a.size();
-
-  float numerator = sum_ab - (sum_a * sum_b / n);
-  float denominator =
-      sqrt((sq_sum_a - sum_a * sum_a / n) *
-           (sq_sum_b - sum_b * sum_b / n));
-
-  if (denominator == 0.0f) {
+  float denominator = sqrt(m2_a * m2_b);
+  if (n == 0 || !(denominator > 0.0f)) {
     return std::numeric_limits<float>::quiet_NaN();
   }
 
-  return numerator / denominator;
+  return c_ab / denominator;
 }
 
+
 /*******************************************************************************
  *
  * @brief Trim leading and trailing near-zero samples from gyro data
  * @param data: the gyro data to trim
  *
  * ****************************************************************************/
-void trim_gyro_data(vector<array<float, 3>> &data) {
+void trim_gyro_data(GestureBuffer &data) {
   float threshold = 0.00001;
   auto ptr = data.begin();
 
   // Find the first sample where any axis exceeds the threshold
-  while (abs((*ptr)[0]) <= threshold && abs((*ptr)[1]) <= threshold &&
-         abs((*ptr)[2]) <= threshold) {
+  while (ptr != data.end() && abs((*ptr)[0]) <= threshold &&
+         abs((*ptr)[1]) <= threshold && abs((*ptr)[2]) <= threshold) {
     ptr++;
   }
   if (ptr == data.end()) return;  // all data below threshold
@@ -132,3 +213,35 @@ void trim_gyro_data(vector<array<float, 3>> &data) {
     data.erase(rptr + 1, data.end());
   }
 }
+
+/*******************************************************************************
+ *
+ * @brief Scale every sample to unit magnitude
+ * @param data: the gyro data to normalize in place
+ *
+ * ****************************************************************************/
+void normalize(GestureBuffer &data) {
+#if GESTURE_USE_CMSIS_DSP
+  normalizeCmsis(data);
+#else
+  normalizeReference(data);
+#endif
+}
+
+/*******************************************************************************
+ *
+ * @brief Portable scalar implementation of normalize()
+ * @param data: the gyro data to normalize in place
+ *
+ * ****************************************************************************/
+void normalizeReference(GestureBuffer &data) {
+  for (auto &point : data) {
+    float magnitude = sqrt(point[0] * point[0] + point[1] * point[1] +
+                           point[2] * point[2]);
+    if (magnitude > 0) {
+      point[0] /= magnitude;
+      point[1] /= magnitude;
+      point[2] /= magnitude;
+    }
+  }
+}
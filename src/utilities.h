@@ -15,18 +15,117 @@
 #ifndef UTILITIES_H
 #define UTILITIES_H
 
+#include "gesture_buffer.h"
 #include "system_config.h"
 
-#define WINDOW_SIZE 5  // Moving average filter window size
+/**
+ * @brief Running per-axis Pearson correlation between two 3-axis streams.
+ * Welford-style update: means, second moments and co-moments of all three
+ * axis pairs (15 accumulators) advance together in one pass, with no
+ * temporary buffers and without the cancellation of the raw-sum formula.
+ */
+struct AxisCorrelation {
+  size_t n;
+  float mean_a[3], mean_b[3];  // running means
+  float m2_a[3], m2_b[3];      // sums of squared deviations
+  float c_ab[3];               // sums of co-deviations
+
+  AxisCorrelation() { reset(); }
+
+  void reset() {
+    n = 0;
+    for (int i = 0; i < 3; i++) {
+      mean_a[i] = mean_b[i] = m2_a[i] = m2_b[i] = c_ab[i] = 0.0f;
+    }
+  }
+
+  /**
+   * @brief Add one aligned pair of samples
+   * @param a: sample from the first stream
+   * @param b: sample from the second stream
+   */
+  void add(const array<float, 3> &a, const array<float, 3> &b) {
+    n++;
+    float inv_n = 1.0f / n;
+    for (int i = 0; i < 3; i++) {
+      float da = a[i] - mean_a[i];
+      float db = b[i] - mean_b[i];
+      mean_a[i] += da * inv_n;
+      mean_b[i] += db * inv_n;
+      float db_new = b[i] - mean_b[i];
+      m2_a[i] += da * (a[i] - mean_a[i]);
+      m2_b[i] += db * db_new;
+      c_ab[i] += da * db_new;
+    }
+  }
+
+  /**
+   * @brief Correlation of one axis so far
+   * @param axis: 0 = x, 1 = y, 2 = z
+   * @return correlation in [-1, 1], or NaN if either stream has no variation
+   */
+  float result(int axis) const {
+    float denominator = m2_a[axis] * m2_b[axis];
+    if (n == 0 || !(denominator > 0.0f)) {
+      return std::numeric_limits<float>::quiet_NaN();
+    }
+    return c_ab[axis] / sqrt(denominator);
+  }
+
+  array<float, 3> result() const { return {result(0), result(1), result(2)}; }
+};
+
+/**
+ * @brief Per-axis Welford state after every prefix of a gesture: mean[i][j]
+ * and m2[i][j] cover samples [0, j]. The variance and energy of any prefix
+ * follow without another pass over the samples, and the centred axes carry
+ * the samples themselves for correlationMoments().
+ */
+struct PrefixMoments {
+  float mean[3][GESTURE_BUFFER_CAPACITY];
+  float m2[3][GESTURE_BUFFER_CAPACITY];  // sums of squared deviations
+  float centre[3];                       // full-length means
+  float centred[3][GESTURE_BUFFER_CAPACITY];  // each axis minus its centre
+
+  void build(const GestureBuffer &samples);
+
+  float variance(int axis, size_t n) const { return m2[axis][n - 1] / n; }
+  float energy(int axis, size_t n) const {
+    return m2[axis][n - 1] + n * mean[axis][n - 1] * mean[axis][n - 1];
+  }
+};
+
+/**
+ * @brief Per-axis correlation of the first n samples of two gestures
+ * @param a: prefix moments of the first gesture
+ * @param b: prefix moments of the second gesture
+ * @param n: prefix length, at most the length of either gesture
+ * @return per-axis correlation [x, y, z] in [-1, 1], NaN without variation
+ */
+array<float, 3> correlationMoments(const PrefixMoments &a, const PrefixMoments &b, size_t n);
+
+/**
+ * @brief Dynamic time warping distance between two normalized gestures
+ * @param vec1: the first gesture (unit vectors)
+ * @param vec2: the second gesture (unit vectors)
+ * @param band: Sakoe-Chiba band half-width in samples
+ * @param threshold: acceptance threshold, used to abandon hopeless matches
+ * @return mean (1 - cos) per path step, or INFINITY once it cannot be
+ *         below threshold
+ */
+float dtwDistance(const GestureBuffer &vec1, const GestureBuffer &vec2,
+                  size_t band, float threshold);
 
 /**
- * @brief Calculate the Pearson correlation for each axis between two gesture vectors
- * @param vec1: the first vector (contains 3D data)
- * @param vec2: the second vector (contains 3D data)
+ * @brief Portable scalar per-axis correlation, the reference the optional
+ * DSP backend is checked against
+ * @param vec1: the first gesture
+ * @param vec2: the second gesture
+ * @param n: number of leading samples of each gesture to correlate
  * @return per-axis correlation [x, y, z] in [-1, 1]
  */
-array<float, 3> calculateCorrelationVectors(vector<array<float, 3>> &vec1,
-                                            vector<array<float, 3>> &vec2);
+array<float, 3> correlationReference(const GestureBuffer &vec1,
+                                     const GestureBuffer &vec2, size_t n);
 
 /**
  * @brief Calculate the Pearson correlation coefficient between two vectors
@@ -36,10 +135,31 @@ array<float, 3> calculateCorrelationVectors(vector<array<float, 3>> &vec1,
  */
 float correlation(const vector<float> &a, const vector<float> &b);
 
+/**
+ * @brief Calculate the Pearson correlation coefficient between two arrays
+ * @param a: the first array
+ * @param b: the second array
+ * @param n: number of elements in each array
+ * @return correlation in [-1, 1], or NaN on error
+ */
+float correlation(const float *a, const float *b, size_t n);
+
 /**
  * @brief Trim leading and trailing near-zero samples from gyro data
  * @param data: the gyro data to trim
  */
-void trim_gyro_data(vector<array<float, 3>> &data);
+void trim_gyro_data(GestureBuffer &data);
+
+/**
+ * @brief Scale every sample to unit magnitude
+ * @param data: the gyro data to normalize in place
+ */
+void normalize(GestureBuffer &data);
+
+/**
+ * @brief Portable scalar implementation of normalize()
+ * @param data: the gyro data to normalize in place
+ */
+void normalizeReference(GestureBuffer &data);
 
 #endif  // UTILITIES_H
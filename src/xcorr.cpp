@@ -0,0 +1,206 @@
+/**
+ * @file xcorr.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief FFT normalized cross-correlation kernel for the shift-tolerant
+ * gesture matcher in the embedded sentry project.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "xcorr.h"
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#if GESTURE_MATCHER == GESTURE_MATCHER_XCORR
+
+// Input copy (the CMSIS transform overwrites its input) and the per-axis
+// correlation over all circular lags. Static so the kernel never touches
+// the heap.
+static float work[XCORR_FFT_SIZE];
+static float lags[3][XCORR_FFT_SIZE];
+
+#if GESTURE_USE_CMSIS_DSP
+#include "arm_math.h"
+
+static arm_rfft_fast_instance_f32 rfft;
+static bool rfft_ready = false;
+
+// Forward (inverse = 0) or inverse real FFT in the packed layout; the
+// inverse includes the 1/N scaling. Overwrites in.
+static void RealFft(float *in, float *out, uint8_t inverse) {
+  if (!rfft_ready) {
+    arm_rfft_fast_init_f32(&rfft, XCORR_FFT_SIZE);
+    rfft_ready = true;
+  }
+  arm_rfft_fast_f32(&rfft, in, out, inverse);
+}
+#else
+// Portable reference: a complex radix-2 transform of the full length with a
+// zero imaginary part, repacked to the arm_rfft_fast_f32 layout
+static float fft_re[XCORR_FFT_SIZE], fft_im[XCORR_FFT_SIZE];
+static float twiddle_cos[XCORR_FFT_SIZE / 2], twiddle_sin[XCORR_FFT_SIZE / 2];
+static bool twiddle_ready = false;
+
+static void ComplexFft(bool inverse) {
+  const size_t n = XCORR_FFT_SIZE;
+  if (!twiddle_ready) {
+    for (size_t k = 0; k < n / 2; k++) {
+      twiddle_cos[k] = cosf(6.28318531f * k / n);
+      twiddle_sin[k] = sinf(6.28318531f * k / n);
+    }
+    twiddle_ready = true;
+  }
+
+  for (size_t i = 1, j = 0; i < n; i++) {
+    size_t bit = n >> 1;
+    for (; j & bit; bit >>= 1) j ^= bit;
+    j ^= bit;
+    if (i < j) {
+      float t = fft_re[i];
+      fft_re[i] = fft_re[j];
+      fft_re[j] = t;
+      t = fft_im[i];
+      fft_im[i] = fft_im[j];
+      fft_im[j] = t;
+    }
+  }
+
+  for (size_t len = 2; len <= n; len <<= 1) {
+    size_t step = n / len;
+    for (size_t i = 0; i < n; i += len) {
+      for (size_t k = 0; k < len / 2; k++) {
+        // e^(-2 pi i k / len) forward, e^(+2 pi i k / len) inverse
+        float wr = twiddle_cos[k * step];
+        float wi = inverse ? twiddle_sin[k * step] : -twiddle_sin[k * step];
+        size_t a = i + k, b = i + k + len / 2;
+        float br = fft_re[b] * wr - fft_im[b] * wi;
+        float bi = fft_re[b] * wi + fft_im[b] * wr;
+        fft_re[b] = fft_re[a] - br;
+        fft_im[b] = fft_im[a] - bi;
+        fft_re[a] += br;
+        fft_im[a] += bi;
+      }
+    }
+  }
+}
+
+static void RealFft(float *in, float *out, uint8_t inverse) {
+  const size_t n = XCORR_FFT_SIZE;
+  if (!inverse) {
+    for (size_t j = 0; j < n; j++) {
+      fft_re[j] = in[j];
+      fft_im[j] = 0.0f;
+    }
+    ComplexFft(false);
+    out[0] = fft_re[0];
+    out[1] = fft_re[n / 2];
+    for (size_t k = 1; k < n / 2; k++) {
+      out[2 * k] = fft_re[k];
+      out[2 * k + 1] = fft_im[k];
+    }
+  } else {
+    // Rebuild the Hermitian spectrum of a real signal
+    fft_re[0] = in[0];
+    fft_im[0] = 0.0f;
+    fft_re[n / 2] = in[1];
+    fft_im[n / 2] = 0.0f;
+    for (size_t k = 1; k < n / 2; k++) {
+      fft_re[k] = fft_re[n - k] = in[2 * k];
+      fft_im[k] = in[2 * k + 1];
+      fft_im[n - k] = -in[2 * k + 1];
+    }
+    ComplexFft(true);
+    for (size_t j = 0; j < n; j++) out[j] = fft_re[j] / n;
+  }
+}
+#endif  // GESTURE_USE_CMSIS_DSP
+
+/*******************************************************************************
+ *
+ * @brief Spectrum of one axis: remove the mean, scale to unit energy,
+ * zero-pad to XCORR_FFT_SIZE and transform
+ * @param x: axis samples
+ * @param n: number of samples, at most GESTURE_BUFFER_CAPACITY
+ * @param bins: packed spectrum of XCORR_FFT_SIZE floats
+ * @return false if the axis has no variation (bins are zeroed)
+ *
+ * ****************************************************************************/
+bool xcorrAxisSpectrum(const float *x, size_t n, float *bins) {
+  float mean = 0.0f;
+  for (size_t j = 0; j < n; j++) mean += x[j];
+  if (n > 0) mean /= n;
+
+  float energy = 0.0f;
+  for (size_t j = 0; j < n; j++) energy += (x[j] - mean) * (x[j] - mean);
+  if (!(energy > 0.0f)) {
+    for (size_t k = 0; k < XCORR_FFT_SIZE; k++) bins[k] = 0.0f;
+    return false;
+  }
+
+  // Unit energy makes every lag of the inverse transform a correlation
+  float scale = 1.0f / sqrtf(energy);
+  for (size_t j = 0; j < XCORR_FFT_SIZE; j++) work[j] = j < n ? (x[j] - mean) * scale : 0.0f;
+  RealFft(work, bins, 0);
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * @brief Best common shift of two gestures
+ * @param probe: spectrum of the probe
+ * @param tmpl: spectrum of the template
+ * @param max_lag: largest shift tried, in samples
+ * @param lag: set to k such that probe[j + k] lines up with tmpl[j]
+ * @return weakest axis correlation at that lag, NaN if either gesture is flat
+ *
+ * Per axis, probe * conj(template) transformed back holds the correlation at
+ * every lag in one O(n log n) pass: lag k >= 0 at index k, lag -k at index
+ * N - k. The lag is shared by all three axes, as one movement shifts all of
+ * them alike. Ties go to the smaller shift.
+ *
+ * ****************************************************************************/
+float xcorrBestLag(const Xcorr_Spectrum &probe, const Xcorr_Spectrum &tmpl, size_t max_lag,
+                   int *lag) {
+  *lag = 0;
+  if (probe.flat || tmpl.flat) return std::numeric_limits<float>::quiet_NaN();
+  if (max_lag > XCORR_MAX_LAG) max_lag = XCORR_MAX_LAG;
+
+  for (int i = 0; i < 3; i++) {
+    const float *a = probe.bins[i];
+    const float *b = tmpl.bins[i];
+    // DC and Nyquist bins are real
+    work[0] = a[0] * b[0];
+    work[1] = a[1] * b[1];
+    for (size_t k = 2; k < XCORR_FFT_SIZE; k += 2) {
+      work[k] = a[k] * b[k] + a[k + 1] * b[k + 1];
+      work[k + 1] = a[k + 1] * b[k] - a[k] * b[k + 1];
+    }
+    RealFft(work, lags[i], 1);
+  }
+
+  float best = -std::numeric_limits<float>::infinity();
+  for (size_t shift = 0; shift <= max_lag; shift++) {
+    for (int sign = 1; sign >= -1; sign -= 2) {
+      if (shift == 0 && sign < 0) continue;
+      size_t index = sign > 0 ? shift : XCORR_FFT_SIZE - shift;
+      float weakest = lags[0][index];
+      if (lags[1][index] < weakest) weakest = lags[1][index];
+      if (lags[2][index] < weakest) weakest = lags[2][index];
+      if (weakest > best) {
+        best = weakest;
+        *lag = sign * (int)shift;
+      }
+    }
+  }
+  return best;
+}
+
+#endif  // GESTURE_MATCHER == GESTURE_MATCHER_XCORR
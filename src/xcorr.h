@@ -0,0 +1,67 @@
+/**
+ * @file xcorr.h
+ * @author Xhovani Mali (xxm202)
+ * @brief FFT normalized cross-correlation kernel for the shift-tolerant
+ * gesture matcher in the embedded sentry project.
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef XCORR_H
+#define XCORR_H
+
+#include <cstddef>
+
+#include "gesture_buffer.h"
+#include "system_config.h"
+
+// Smallest power of two, at least 32 (the shortest arm_rfft_fast_f32
+// length), that is >= n
+constexpr size_t xcorrFftSize(size_t n, size_t size = 32) {
+  return size >= n ? size : xcorrFftSize(n, size * 2);
+}
+
+// Two recordings of up to GESTURE_BUFFER_CAPACITY samples zero-padded to
+// this length correlate without circular wrap-around at any lag
+constexpr size_t XCORR_FFT_SIZE = xcorrFftSize(2 * GESTURE_BUFFER_CAPACITY - 1);
+
+static_assert(XCORR_FFT_SIZE <= 4096, "arm_rfft_fast_f32 supports at most 4096 points");
+static_assert(XCORR_MAX_LAG < XCORR_FFT_SIZE / 2, "XCORR_MAX_LAG must stay below half the FFT length");
+
+// Real spectra of the three centred, unit-energy axes of one gesture, in the
+// arm_rfft_fast_f32 packed layout: [Re X0, Re X(N/2), Re X1, Im X1, ...]
+typedef struct {
+  float bins[3][XCORR_FFT_SIZE];
+  bool flat;  // some axis has no variation, the gesture never matches
+} Xcorr_Spectrum;
+
+/**
+ * @brief Spectrum of one axis: remove the mean, scale to unit energy,
+ * zero-pad to XCORR_FFT_SIZE and transform
+ * @param x: axis samples
+ * @param n: number of samples, at most GESTURE_BUFFER_CAPACITY
+ * @param bins: packed spectrum of XCORR_FFT_SIZE floats
+ * @return false if the axis has no variation (bins are zeroed)
+ */
+bool xcorrAxisSpectrum(const float *x, size_t n, float *bins);
+
+/**
+ * @brief Best common shift of two gestures: the lag in [-max_lag, max_lag]
+ * whose weakest per-axis normalized cross-correlation is the strongest
+ * @param probe: spectrum of the probe
+ * @param tmpl: spectrum of the template
+ * @param max_lag: largest shift tried, in samples
+ * @param lag: set to k such that probe[j + k] lines up with tmpl[j]
+ * @return weakest axis correlation at that lag in [-1, 1], NaN if either
+ * gesture is flat
+ */
+float xcorrBestLag(const Xcorr_Spectrum &probe, const Xcorr_Spectrum &tmpl, size_t max_lag,
+                   int *lag);
+
+#endif  // XCORR_H